@@ -90,7 +90,11 @@ fn copy_to_test_dir(from_path: &str, to_file: &str, game_settings: &GameSettings
     copy(testing_plugins_dir.join(from_path), data_dir.join(to_file)).unwrap();
 }
 
-fn initialise_state(game_settings: &GameSettings, plugins_count: u16, active_plugins_count: u16) {
+fn initialise_state(
+    game_settings: &GameSettings,
+    plugins_count: usize,
+    active_plugins_count: usize,
+) {
     let mut plugins: Vec<String> = Vec::new();
 
     plugins.push(game_settings.master_file().to_string());
@@ -110,7 +114,7 @@ fn initialise_state(game_settings: &GameSettings, plugins_count: u16, active_plu
         write_load_order_file(game_settings, &plugins_as_ref);
     }
     set_timestamps(&game_settings.plugins_directory(), &plugins_as_ref);
-    plugins_as_ref.truncate(active_plugins_count as usize);
+    plugins_as_ref.truncate(active_plugins_count);
     write_active_plugins_file(game_settings, &plugins_as_ref);
 }
 
@@ -121,13 +125,13 @@ fn to_owned(strs: Vec<&str>) -> Vec<String> {
 #[derive(Clone)]
 struct Parameters {
     settings: GameSettings,
-    plugins_count: u16,
-    active_plugins_count: u16,
+    plugins_count: usize,
+    active_plugins_count: usize,
     directory: Rc<TempDir>,
 }
 
 impl Parameters {
-    fn new(game_id: GameId, plugins_count: u16, active_plugins_count: u16) -> Parameters {
+    fn new(game_id: GameId, plugins_count: usize, active_plugins_count: usize) -> Parameters {
         let directory = TempDir::new().unwrap();
         let local_path = directory.path().join("local");
 
@@ -195,7 +199,7 @@ fn readable_load_order_benchmark(c: &mut Criterion) {
             let load_order = parameters.loaded_load_order();
 
             let plugin = load_order
-                .plugin_at(parameters.plugins_count as usize)
+                .plugin_at(parameters.plugins_count)
                 .unwrap();
 
             b.iter(|| load_order.index_of(plugin))
@@ -229,7 +233,7 @@ fn readable_load_order_benchmark(c: &mut Criterion) {
             let load_order = parameters.loaded_load_order();
 
             let plugin = load_order
-                .plugin_at(parameters.plugins_count as usize)
+                .plugin_at(parameters.plugins_count)
                 .unwrap()
                 .to_owned();
 
@@ -0,0 +1,354 @@
+#[macro_use]
+extern crate criterion;
+extern crate loadorder;
+extern crate tempfile;
+
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::fmt;
+use std::fs::{copy, create_dir, File};
+use std::io::Write;
+use std::path::Path;
+use std::rc::Rc;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::time::Duration;
+
+use criterion::Criterion;
+use tempfile::TempDir;
+
+use loadorder::GameId;
+use loadorder::GameSettings;
+use loadorder::WritableLoadOrder;
+
+/// The plugin counts that the load order operations are benchmarked for, up to well beyond the
+/// 4096 light masters and 255 other plugins that can be active at once.
+const PLUGIN_COUNTS: &[usize] = &[1000, 5000, 10000, 20000];
+
+const MAX_ACTIVE_NORMAL_PLUGINS: usize = 255;
+const MAX_ACTIVE_LIGHT_MASTERS: usize = 4096;
+
+/// Counts the bytes allocated on the heap, so that the peak memory used by each operation can be
+/// reported alongside its timings.
+struct CountingAllocator;
+
+static ALLOCATED_BYTES: AtomicUsize = AtomicUsize::new(0);
+static PEAK_ALLOCATED_BYTES: AtomicUsize = AtomicUsize::new(0);
+
+unsafe impl GlobalAlloc for CountingAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        let ptr = System.alloc(layout);
+        if !ptr.is_null() {
+            let allocated = ALLOCATED_BYTES.fetch_add(layout.size(), Ordering::Relaxed);
+            PEAK_ALLOCATED_BYTES.fetch_max(allocated + layout.size(), Ordering::Relaxed);
+        }
+        ptr
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        System.dealloc(ptr, layout);
+        ALLOCATED_BYTES.fetch_sub(layout.size(), Ordering::Relaxed);
+    }
+}
+
+#[global_allocator]
+static ALLOCATOR: CountingAllocator = CountingAllocator;
+
+/// Gets the peak number of bytes allocated while running the given function, beyond those that
+/// were already allocated when it was called.
+fn peak_memory<F: FnOnce()>(f: F) -> usize {
+    let baseline = ALLOCATED_BYTES.load(Ordering::Relaxed);
+    PEAK_ALLOCATED_BYTES.store(baseline, Ordering::Relaxed);
+
+    f();
+
+    PEAK_ALLOCATED_BYTES.load(Ordering::Relaxed) - baseline
+}
+
+/// The kinds of plugin installed, in roughly the proportions that are seen in large modded
+/// Skyrim SE and Fallout 4 installs.
+#[derive(Clone, Copy, Debug, PartialEq)]
+enum PluginKind {
+    Master,
+    LightMaster,
+    Plugin,
+    GhostedPlugin,
+}
+
+impl PluginKind {
+    fn for_index(index: usize) -> PluginKind {
+        match index % 20 {
+            0 => PluginKind::Master,
+            1..=7 => PluginKind::LightMaster,
+            8 | 9 => PluginKind::GhostedPlugin,
+            _ => PluginKind::Plugin,
+        }
+    }
+
+    fn filename(&self, index: usize) -> String {
+        match *self {
+            PluginKind::Master => format!("Master{}.esm", index),
+            PluginKind::LightMaster => format!("Light{}.esl", index),
+            PluginKind::Plugin | PluginKind::GhostedPlugin => format!("Plugin{}.esp", index),
+        }
+    }
+
+    fn source(&self) -> &'static str {
+        match *self {
+            PluginKind::Master => "Blank - Different.esm",
+            PluginKind::LightMaster => "Blank.esl",
+            PluginKind::Plugin | PluginKind::GhostedPlugin => "Blank.esp",
+        }
+    }
+}
+
+/// Installs the game's master file and `plugins_count` other plugins, and writes a plugins file
+/// that lists them all with masters first, activating as many as the game allows. Ghosted plugins
+/// are listed but inactive.
+fn initialise_state(game_settings: &GameSettings, plugins_count: usize) {
+    let source_dir = Path::new("testing-plugins").join("SkyrimSE").join("Data");
+    let data_dir = game_settings.plugins_directory();
+    create_dir(&data_dir).unwrap();
+
+    copy(
+        source_dir.join("Blank.esm"),
+        data_dir.join(game_settings.master_file()),
+    ).unwrap();
+
+    let mut masters = Vec::new();
+    let mut plugins = Vec::new();
+    let mut normal_active_count = 1;
+    let mut light_active_count = 0;
+
+    for index in 0..plugins_count {
+        let kind = PluginKind::for_index(index);
+        let filename = kind.filename(index);
+
+        let installed_filename = if kind == PluginKind::GhostedPlugin {
+            filename.clone() + ".ghost"
+        } else {
+            filename.clone()
+        };
+        copy(source_dir.join(kind.source()), data_dir.join(installed_filename)).unwrap();
+
+        let is_active = match kind {
+            PluginKind::GhostedPlugin => false,
+            PluginKind::LightMaster => {
+                light_active_count += 1;
+                light_active_count <= MAX_ACTIVE_LIGHT_MASTERS
+            }
+            PluginKind::Master | PluginKind::Plugin => {
+                normal_active_count += 1;
+                normal_active_count <= MAX_ACTIVE_NORMAL_PLUGINS
+            }
+        };
+
+        let line = if is_active {
+            format!("*{}", filename)
+        } else {
+            filename
+        };
+
+        match kind {
+            PluginKind::Master | PluginKind::LightMaster => masters.push(line),
+            PluginKind::Plugin | PluginKind::GhostedPlugin => plugins.push(line),
+        }
+    }
+
+    let mut file = File::create(game_settings.active_plugins_file()).unwrap();
+    for line in masters.iter().chain(plugins.iter()) {
+        writeln!(file, "{}", line).unwrap();
+    }
+}
+
+fn to_owned(strs: Vec<&str>) -> Vec<String> {
+    strs.into_iter().map(String::from).collect()
+}
+
+#[derive(Clone)]
+struct Parameters {
+    settings: GameSettings,
+    plugins_count: usize,
+    // Kept so that the plugins are deleted once no benchmark uses them.
+    #[allow(dead_code)]
+    directory: Rc<TempDir>,
+}
+
+impl Parameters {
+    fn new(game_id: GameId, plugins_count: usize) -> Parameters {
+        let directory = TempDir::new().unwrap();
+        let local_path = directory.path().join("local");
+
+        create_dir(&local_path).unwrap();
+
+        let settings =
+            GameSettings::with_local_path(game_id, directory.path(), &local_path).unwrap();
+
+        initialise_state(&settings, plugins_count);
+
+        Parameters {
+            settings,
+            plugins_count,
+            directory: Rc::new(directory),
+        }
+    }
+
+    fn loaded_load_order(&self) -> Box<WritableLoadOrder> {
+        let mut load_order = self.settings.clone().into_load_order();
+        load_order.load().unwrap();
+
+        load_order
+    }
+}
+
+impl fmt::Debug for Parameters {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        write!(f, "({:?}, {} plugins)", self.settings.id(), self.plugins_count)
+    }
+}
+
+/// Swaps the last two plugins each time it is called, so that every save has a change to write.
+fn move_a_plugin(load_order: &mut Box<WritableLoadOrder>) {
+    let last_index = load_order.plugin_names().len() - 1;
+    let plugin_name = load_order.plugin_at(last_index).unwrap().to_string();
+
+    load_order
+        .set_plugin_index(&plugin_name, last_index - 1)
+        .unwrap();
+}
+
+/// Prints the peak memory used by a single call of each benchmarked operation, as criterion only
+/// measures time.
+fn report_peak_memory(load_orders: &[Parameters]) {
+    for parameters in load_orders {
+        let report = |operation: &str, bytes: usize| {
+            println!(
+                "{:?} {}: peak memory {} KiB",
+                parameters,
+                operation,
+                bytes / 1024
+            )
+        };
+
+        let mut load_order = parameters.settings.clone().into_load_order();
+        report("load()", peak_memory(|| load_order.load().unwrap()));
+
+        move_a_plugin(&mut load_order);
+        report("save()", peak_memory(|| load_order.save().unwrap()));
+
+        let active_plugins = to_owned(load_order.active_plugin_names());
+        let active_plugins: Vec<&str> = active_plugins.iter().map(AsRef::as_ref).collect();
+        report(
+            "set_active_plugins()",
+            peak_memory(|| load_order.set_active_plugins(&active_plugins).unwrap()),
+        );
+
+        let plugins = to_owned(load_order.plugin_names());
+        let plugins: Vec<&str> = plugins.iter().map(AsRef::as_ref).collect();
+        report(
+            "set_load_order()",
+            peak_memory(|| load_order.set_load_order(&plugins).unwrap()),
+        );
+
+        let last_plugin = plugins.last().unwrap();
+        report(
+            "index_of()",
+            peak_memory(|| {
+                load_order.index_of(last_plugin);
+            }),
+        );
+        report(
+            "is_self_consistent()",
+            peak_memory(|| {
+                load_order.is_self_consistent().unwrap();
+            }),
+        );
+    }
+}
+
+fn scaling_benchmark(c: &mut Criterion) {
+    let load_orders: Vec<Parameters> = PLUGIN_COUNTS
+        .iter()
+        .map(|&count| Parameters::new(GameId::SkyrimSE, count))
+        .collect();
+
+    report_peak_memory(&load_orders);
+
+    c.bench_function_over_inputs(
+        "Scaling WritableLoadOrder.load()",
+        |b, parameters| {
+            let mut load_order = parameters.settings.clone().into_load_order();
+
+            b.iter(|| load_order.load().unwrap())
+        },
+        load_orders.clone(),
+    );
+
+    c.bench_function_over_inputs(
+        "Scaling WritableLoadOrder.save()",
+        |b, parameters| {
+            let mut load_order = parameters.loaded_load_order();
+
+            b.iter(|| {
+                move_a_plugin(&mut load_order);
+                load_order.save().unwrap()
+            })
+        },
+        load_orders.clone(),
+    );
+
+    c.bench_function_over_inputs(
+        "Scaling WritableLoadOrder.set_active_plugins()",
+        |b, parameters| {
+            let mut load_order = parameters.loaded_load_order();
+
+            let plugins = to_owned(load_order.active_plugin_names());
+            let plugin_refs: Vec<&str> = plugins.iter().map(AsRef::as_ref).collect();
+
+            b.iter(|| load_order.set_active_plugins(&plugin_refs).unwrap())
+        },
+        load_orders.clone(),
+    );
+
+    c.bench_function_over_inputs(
+        "Scaling WritableLoadOrder.set_load_order()",
+        |b, parameters| {
+            let mut load_order = parameters.loaded_load_order();
+
+            let plugins = to_owned(load_order.plugin_names());
+            let plugin_refs: Vec<&str> = plugins.iter().map(AsRef::as_ref).collect();
+
+            b.iter(|| load_order.set_load_order(&plugin_refs).unwrap())
+        },
+        load_orders.clone(),
+    );
+
+    c.bench_function_over_inputs(
+        "Scaling ReadableLoadOrder.index_of()",
+        |b, parameters| {
+            let load_order = parameters.loaded_load_order();
+
+            let plugin = load_order.plugin_names().last().unwrap().to_string();
+
+            b.iter(|| load_order.index_of(&plugin))
+        },
+        load_orders.clone(),
+    );
+
+    c.bench_function_over_inputs(
+        "Scaling WritableLoadOrder.is_self_consistent()",
+        |b, parameters| {
+            let load_order = parameters.loaded_load_order();
+
+            b.iter(|| load_order.is_self_consistent().unwrap())
+        },
+        load_orders.clone(),
+    );
+}
+
+criterion_group!{
+    name = scaling_benches;
+    config = Criterion::default()
+        .warm_up_time(Duration::from_secs(2))
+        .sample_size(10);
+    targets = scaling_benchmark
+}
+criterion_main!(scaling_benches);
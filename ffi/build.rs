@@ -8,6 +8,60 @@ mod ffi_headers {
     use self::cbindgen::Builder;
     use self::cbindgen::Language;
 
+    // Appended to the C++ header to make lo_get_load_order_state() easier to use.
+    const CXX_TRAILER: &str = r#"
+namespace loadorder {
+/// Owns an array output by lo_get_load_order_state(), exposing it as a
+/// contiguous range of plugin states that is freed on destruction.
+class LoadOrderState {
+public:
+  LoadOrderState() : states_(nullptr), size_(0) {}
+  LoadOrderState(const LoadOrderState&) = delete;
+  LoadOrderState& operator=(const LoadOrderState&) = delete;
+  LoadOrderState(LoadOrderState&& other) : states_(other.states_), size_(other.size_) {
+    other.states_ = nullptr;
+    other.size_ = 0;
+  }
+  LoadOrderState& operator=(LoadOrderState&& other) {
+    if (this != &other) {
+      lo_free_load_order_state(states_, size_);
+      states_ = other.states_;
+      size_ = other.size_;
+      other.states_ = nullptr;
+      other.size_ = 0;
+    }
+    return *this;
+  }
+  ~LoadOrderState() { lo_free_load_order_state(states_, size_); }
+
+  /// Replaces the held states with the handle's current load order state,
+  /// returning the code returned by lo_get_load_order_state().
+  unsigned int load(lo_game_handle handle) {
+    lo_plugin_state * states = nullptr;
+    size_t size = 0;
+    unsigned int return_code = lo_get_load_order_state(handle, &states, &size);
+    if (return_code == LIBLO_OK) {
+      lo_free_load_order_state(states_, size_);
+      states_ = states;
+      size_ = size;
+    }
+    return return_code;
+  }
+
+  const lo_plugin_state * data() const { return states_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const lo_plugin_state * begin() const { return states_; }
+  const lo_plugin_state * end() const { return states_ + size_; }
+  const lo_plugin_state& operator[](size_t index) const { return states_[index]; }
+
+private:
+  lo_plugin_state * states_;
+  size_t size_;
+};
+}
+"#;
+
     pub fn generate_headers() {
         let crate_dir = env::var("CARGO_MANIFEST_DIR")
             .expect("could not get value of CARGO_MANIFEST_DIR env var");
@@ -25,6 +79,7 @@ mod ffi_headers {
             .with_crate(&crate_dir)
             .with_language(Language::Cxx)
             .with_std_types(false)
+            .with_trailer(CXX_TRAILER)
             .generate()
             .expect("could not generate C++ header file")
             .write_to_file("include/libloadorder.hpp");
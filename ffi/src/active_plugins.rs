@@ -69,6 +69,51 @@ pub unsafe extern "C" fn lo_get_active_plugins(
     }).unwrap_or(LIBLO_ERROR_PANICKED)
 }
 
+/// Gets the list of currently active plugins without copying it.
+///
+/// This function has the same effect as `lo_get_active_plugins()`, but instead of outputting a
+/// copy of the list that must be freed by the caller, it outputs an array that is owned by the
+/// handle and must not be freed. The array is only rebuilt when it is requested after the handle's
+/// generation has changed (see `lo_get_generation()`), so it is much cheaper to call repeatedly.
+///
+/// The array and its strings remain valid until this function is next called with the same handle,
+/// or the handle is destroyed. They are not freed by other functions, including those that change
+/// the handle's state, or by changes made on other threads.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_get_active_plugins_view(
+    handle: lo_game_handle,
+    plugins: *mut *const *const c_char,
+    num_plugins: *mut size_t,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || plugins.is_null() || num_plugins.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+        let snapshot = match (*handle).read() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+            Ok(h) => h,
+        };
+
+        *plugins = ptr::null();
+        *num_plugins = 0;
+
+        match (*handle).active_plugins_view(&snapshot) {
+            Ok((pointer, size)) => {
+                *plugins = pointer;
+                *num_plugins = size;
+            }
+            Err(x) if x == LIBLO_ERROR_POISONED_THREAD_LOCK => {
+                return error(x, "The active plugins view's lock is poisoned")
+            }
+            Err(x) => return error(x, "A filename contained a null byte"),
+        }
+
+        LIBLO_OK
+    }).unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
 /// Sets the list of currently active plugins.
 ///
 /// Replaces the current active plugins list with the plugins in the given array. The replacement
@@ -101,7 +146,7 @@ pub unsafe extern "C" fn lo_set_active_plugins(
             return handle_error(x);
         }
 
-        if let Err(x) = handle.save() {
+        if let Err(x) = handle.save_unless_in_transaction() {
             return handle_error(x);
         }
 
@@ -149,7 +194,7 @@ pub unsafe extern "C" fn lo_set_plugin_active(
             return handle_error(x);
         }
 
-        if let Err(x) = handle.save() {
+        if let Err(x) = handle.save_unless_in_transaction() {
             return handle_error(x);
         }
 
@@ -21,6 +21,7 @@ use libc::c_uint;
 
 use loadorder::GameId;
 use loadorder::LoadOrderMethod;
+use loadorder::WriteDurability;
 
 /// Success return code.
 #[no_mangle]
@@ -110,6 +111,95 @@ pub static LIBLO_METHOD_TEXTFILE: c_uint = LoadOrderMethod::Textfile as c_uint;
 #[no_mangle]
 pub static LIBLO_METHOD_ASTERISK: c_uint = LoadOrderMethod::Asterisk as c_uint;
 
+/// Leave flushing saved files to disk to the operating system. This is the default.
+#[no_mangle]
+pub static LIBLO_DURABILITY_BUFFERED: c_uint = WriteDurability::Buffered as c_uint;
+
+/// Flush saved files to disk before they replace the files they update.
+#[no_mangle]
+pub static LIBLO_DURABILITY_SYNC_FILE: c_uint = WriteDurability::SyncFile as c_uint;
+
+/// Flush saved files to disk before they replace the files they update, and flush the
+/// replacement to disk afterwards. On Windows, this is equivalent to `LIBLO_DURABILITY_SYNC_FILE`.
+#[no_mangle]
+pub static LIBLO_DURABILITY_SYNC_FILE_AND_DIRECTORY: c_uint =
+    WriteDurability::SyncFileAndDirectory as c_uint;
+
+/// Handle option flag for sharing the plugin header data that a handle reads with all other handles
+/// for the same game in the process that were also created with this flag. See
+/// `lo_create_handle_with_options()`.
+#[no_mangle]
+pub static LIBLO_HANDLE_SHARED_PLUGIN_CACHE: c_uint = 1;
+
+/// Plugin state flag for a plugin that is active. See `lo_get_load_order_state()`.
+#[no_mangle]
+pub static LIBLO_PLUGIN_ACTIVE: c_uint = 1;
+
+/// Plugin state flag for a plugin that is a master file. See `lo_get_load_order_state()`.
+#[no_mangle]
+pub static LIBLO_PLUGIN_MASTER: c_uint = 2;
+
+/// Plugin state flag for a plugin that is a light master file. See `lo_get_load_order_state()`.
+#[no_mangle]
+pub static LIBLO_PLUGIN_LIGHT_MASTER: c_uint = 4;
+
+/// Plugin state flag for a plugin that is ghosted. See `lo_get_load_order_state()`.
+#[no_mangle]
+pub static LIBLO_PLUGIN_GHOSTED: c_uint = 8;
+
+/// Pending change flag for a plugin that has been added to the load order. See
+/// `lo_get_pending_changes()`.
+#[no_mangle]
+pub static LIBLO_CHANGE_ADDED: c_uint = 1;
+
+/// Pending change flag for a plugin that has been removed from the load order. See
+/// `lo_get_pending_changes()`.
+#[no_mangle]
+pub static LIBLO_CHANGE_REMOVED: c_uint = 2;
+
+/// Pending change flag for a plugin that has been moved in the load order. See
+/// `lo_get_pending_changes()`.
+#[no_mangle]
+pub static LIBLO_CHANGE_MOVED: c_uint = 4;
+
+/// Pending change flag for a plugin that has been activated. See `lo_get_pending_changes()`.
+#[no_mangle]
+pub static LIBLO_CHANGE_ACTIVATED: c_uint = 8;
+
+/// Pending change flag for a plugin that has been deactivated. See `lo_get_pending_changes()`.
+#[no_mangle]
+pub static LIBLO_CHANGE_DEACTIVATED: c_uint = 16;
+
+/// Load order violation for a plugin that has the same name as a plugin before it. See
+/// `lo_validate_load_order()`.
+#[no_mangle]
+pub static LIBLO_VIOLATION_DUPLICATE_PLUGIN: c_uint = 1;
+
+/// Load order violation for a plugin that is not in the current load order, and so could not be
+/// checked further. See `lo_validate_load_order()`.
+#[no_mangle]
+pub static LIBLO_VIOLATION_UNKNOWN_PLUGIN: c_uint = 2;
+
+/// Load order violation for a master that loads after a non-master. See
+/// `lo_validate_load_order()`.
+#[no_mangle]
+pub static LIBLO_VIOLATION_NON_MASTER_BEFORE_MASTER: c_uint = 3;
+
+/// Load order violation for the game's main master file not loading first. See
+/// `lo_validate_load_order()`.
+#[no_mangle]
+pub static LIBLO_VIOLATION_GAME_MASTER_NOT_FIRST: c_uint = 4;
+
+/// Load order violation for an implicitly active plugin that does not load in its hardcoded order.
+/// See `lo_validate_load_order()`.
+#[no_mangle]
+pub static LIBLO_VIOLATION_IMPLICITLY_ACTIVE_PLUGIN_OUT_OF_ORDER: c_uint = 5;
+
+/// Load order violation for an active plugin that exceeds the limit on the number of active
+/// plugins of its type. See `lo_validate_load_order()`.
+#[no_mangle]
+pub static LIBLO_VIOLATION_TOO_MANY_ACTIVE_PLUGINS: c_uint = 6;
+
 /// Game code for The Elder Scrolls III: Morrowind.
 #[no_mangle]
 pub static LIBLO_GAME_TES3: c_uint = GameId::Morrowind as c_uint;
@@ -162,4 +252,43 @@ mod tests {
         assert_eq!(8, LIBLO_GAME_FO4VR);
         assert_eq!(9, LIBLO_GAME_TES5VR);
     }
+
+    #[test]
+    fn durability_constants_should_have_expected_integer_values() {
+        assert_eq!(0, LIBLO_DURABILITY_BUFFERED);
+        assert_eq!(1, LIBLO_DURABILITY_SYNC_FILE);
+        assert_eq!(2, LIBLO_DURABILITY_SYNC_FILE_AND_DIRECTORY);
+    }
+
+    #[test]
+    fn handle_option_constants_should_have_expected_integer_values() {
+        assert_eq!(1, LIBLO_HANDLE_SHARED_PLUGIN_CACHE);
+    }
+
+    #[test]
+    fn plugin_state_constants_should_have_expected_integer_values() {
+        assert_eq!(1, LIBLO_PLUGIN_ACTIVE);
+        assert_eq!(2, LIBLO_PLUGIN_MASTER);
+        assert_eq!(4, LIBLO_PLUGIN_LIGHT_MASTER);
+        assert_eq!(8, LIBLO_PLUGIN_GHOSTED);
+    }
+
+    #[test]
+    fn change_constants_should_have_expected_integer_values() {
+        assert_eq!(1, LIBLO_CHANGE_ADDED);
+        assert_eq!(2, LIBLO_CHANGE_REMOVED);
+        assert_eq!(4, LIBLO_CHANGE_MOVED);
+        assert_eq!(8, LIBLO_CHANGE_ACTIVATED);
+        assert_eq!(16, LIBLO_CHANGE_DEACTIVATED);
+    }
+
+    #[test]
+    fn violation_constants_should_have_expected_integer_values() {
+        assert_eq!(1, LIBLO_VIOLATION_DUPLICATE_PLUGIN);
+        assert_eq!(2, LIBLO_VIOLATION_UNKNOWN_PLUGIN);
+        assert_eq!(3, LIBLO_VIOLATION_NON_MASTER_BEFORE_MASTER);
+        assert_eq!(4, LIBLO_VIOLATION_GAME_MASTER_NOT_FIRST);
+        assert_eq!(5, LIBLO_VIOLATION_IMPLICITLY_ACTIVE_PLUGIN_OUT_OF_ORDER);
+        assert_eq!(6, LIBLO_VIOLATION_TOO_MANY_ACTIVE_PLUGINS);
+    }
 }
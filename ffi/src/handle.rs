@@ -20,18 +20,26 @@ extern crate libc;
 extern crate loadorder;
 
 use std::error::Error;
+use std::fs;
+use std::mem;
+use std::ops::{Deref, DerefMut};
 use std::panic::catch_unwind;
 use std::path::Path;
 use std::ptr;
-use std::sync::{LockResult, RwLock, RwLockReadGuard, RwLockWriteGuard};
+use std::sync::{Arc, LockResult, Mutex, MutexGuard, PoisonError, RwLock};
+use std::thread;
 
 use libc::{c_char, c_uint, size_t};
 use loadorder::GameId;
 use loadorder::GameSettings;
 use loadorder::WritableLoadOrder;
+use loadorder::WriteDurability;
 
 use constants::*;
-use helpers::{error, handle_error, to_c_string_array, to_str};
+use helpers::{error, handle_error, to_c_string_array, to_str, StringArrayView};
+use metrics::LockWaitRecorder;
+use watcher::Watcher;
+use worker::Worker;
 
 /// A structure that holds all game-specific data used by libloadorder.
 ///
@@ -41,18 +49,357 @@ use helpers::{error, handle_error, to_c_string_array, to_str};
 #[allow(non_camel_case_types)]
 pub type lo_game_handle = *mut GameHandle;
 
-pub struct GameHandle(RwLock<Box<WritableLoadOrder>>);
+pub struct GameHandle {
+    state: Mutex<HandleState>,
+    published: RwLock<Arc<Snapshot>>,
+    watcher: Mutex<Option<Watcher>>,
+    worker: Mutex<Option<Worker>>,
+    lock_waits: LockWaitRecorder,
+    // The string arrays lent out by the lo_get_*_view() functions, which are held by the handle
+    // rather than a snapshot so that publishing a new snapshot can't free them.
+    load_order_view: Mutex<StringArrayView>,
+    active_plugins_view: Mutex<StringArrayView>,
+}
 
 impl GameHandle {
-    pub fn read(&self) -> LockResult<RwLockReadGuard<Box<WritableLoadOrder>>> {
-        self.0.read()
+    fn new(state: HandleState) -> GameHandle {
+        let snapshot = Snapshot::new(&state);
+        GameHandle {
+            state: Mutex::new(state),
+            published: RwLock::new(Arc::new(snapshot)),
+            watcher: Mutex::default(),
+            worker: Mutex::default(),
+            lock_waits: LockWaitRecorder::default(),
+            load_order_view: Mutex::default(),
+            active_plugins_view: Mutex::default(),
+        }
+    }
+
+    /// Get the most recently published snapshot of the handle's state.
+    ///
+    /// This never waits for a writer to finish, as writers only hold the lock on the published
+    /// snapshot for long enough to replace it.
+    pub fn read(&self) -> LockResult<Arc<Snapshot>> {
+        match self.published.read() {
+            Ok(snapshot) => Ok(Arc::clone(&snapshot)),
+            Err(e) => Err(PoisonError::new(Arc::clone(&e.into_inner()))),
+        }
+    }
+
+    /// Get exclusive access to the handle's state. Any changes are published as a new snapshot
+    /// when the returned guard is dropped.
+    pub fn write(&self) -> LockResult<StateGuard> {
+        match self.lock_waits.time(|| self.state.lock()) {
+            Ok(state) => Ok(StateGuard {
+                handle: self,
+                state,
+            }),
+            Err(e) => Err(PoisonError::new(StateGuard {
+                handle: self,
+                state: e.into_inner(),
+            })),
+        }
+    }
+
+    pub fn lock_waits(&self) -> &LockWaitRecorder {
+        &self.lock_waits
+    }
+
+    pub fn watcher(&self) -> LockResult<MutexGuard<Option<Watcher>>> {
+        self.watcher.lock()
+    }
+
+    pub fn worker(&self) -> LockResult<MutexGuard<Option<Worker>>> {
+        self.worker.lock()
+    }
+
+    /// Get a pointer to and the length of an array of the plugin names in the given snapshot's load
+    /// order. The array is only rebuilt if the snapshot's generation differs from the generation
+    /// it was last built for.
+    pub fn load_order_view(
+        &self,
+        snapshot: &Snapshot,
+    ) -> Result<(*const *const c_char, size_t), u32> {
+        update_view(&self.load_order_view, snapshot.generation(), || {
+            snapshot.plugin_names()
+        })
+    }
+
+    /// Get a pointer to and the length of an array of the active plugin names in the given
+    /// snapshot. The array is only rebuilt if the snapshot's generation differs from the
+    /// generation it was last built for.
+    pub fn active_plugins_view(
+        &self,
+        snapshot: &Snapshot,
+    ) -> Result<(*const *const c_char, size_t), u32> {
+        update_view(&self.active_plugins_view, snapshot.generation(), || {
+            snapshot.active_plugin_names()
+        })
+    }
+
+    /// Stop the handle's background threads, which must be done before the handle is destroyed.
+    ///
+    /// This only needs a shared reference to the handle, so that the references held by the
+    /// threads remain valid until they have stopped.
+    pub fn stop_background_threads(&self) {
+        // The watcher's thread reads the handle's state, and the worker's thread uses the handle
+        // and finishes any queued jobs before stopping. They are stopped outside their locks, as
+        // their callbacks may start a new watcher or more jobs, which must also be stopped.
+        loop {
+            if let Some(watcher) = take_locked(&self.watcher) {
+                drop(watcher);
+            } else if let Some(worker) = take_locked(&self.worker) {
+                drop(worker);
+            } else {
+                break;
+            }
+        }
+    }
+
+    fn publish(&self, state: &HandleState) {
+        let snapshot = Arc::new(Snapshot::new(state));
+
+        // Swap the snapshot in while holding the lock, but drop the old one outside it.
+        let _old = match self.published.write() {
+            Ok(mut published) => mem::replace(&mut *published, snapshot),
+            Err(e) => mem::replace(&mut *e.into_inner(), snapshot),
+        };
+    }
+}
+
+fn take_locked<T>(mutex: &Mutex<Option<T>>) -> Option<T> {
+    match mutex.lock() {
+        Ok(mut value) => value.take(),
+        Err(e) => e.into_inner().take(),
+    }
+}
+
+/// The state held behind a game handle's write lock: its load order, and the load order as it was
+/// when the transaction in progress began, if there is one. Changes made during a transaction are
+/// not saved until it is committed, and aborting it restores the load order it began with.
+///
+/// The state also has a generation, which is incremented whenever the load order is mutably
+/// accessed. The load order is shared with the published snapshot, and is copied the first time it
+/// is mutably accessed after being published, so that readers never see a partially applied
+/// change. The copy shares the load order's plugins until they are changed, and their name index
+/// until plugins are added or removed, so changing settings doesn't copy the plugins, and
+/// activating a plugin doesn't copy the index.
+pub struct HandleState {
+    load_order: Arc<Box<WritableLoadOrder>>,
+    transaction_start: Option<Arc<Box<WritableLoadOrder>>>,
+    generation: u64,
+}
+
+impl HandleState {
+    fn new(load_order: Box<WritableLoadOrder>) -> HandleState {
+        HandleState {
+            load_order: Arc::new(load_order),
+            transaction_start: None,
+            generation: 0,
+        }
+    }
+
+    pub fn in_transaction(&self) -> bool {
+        self.transaction_start.is_some()
+    }
+
+    /// Begin a transaction, keeping the current load order so that it can be restored if the
+    /// transaction is aborted. The load order is shared until it is changed, so this is cheap.
+    pub fn begin_transaction(&mut self) {
+        self.transaction_start = Some(Arc::clone(&self.load_order));
+    }
+
+    /// Save the load order, unless a transaction is in progress.
+    pub fn save_unless_in_transaction(&mut self) -> Result<(), loadorder::Error> {
+        if self.in_transaction() {
+            Ok(())
+        } else {
+            Arc::make_mut(&mut self.load_order).save()
+        }
+    }
+
+    /// Save the load order, ending any transaction in progress.
+    pub fn commit(&mut self) -> Result<(), loadorder::Error> {
+        self.deref_mut().save()?;
+        self.transaction_start = None;
+        Ok(())
+    }
+
+    /// Restore the load order that the transaction in progress began with, ending the
+    /// transaction. Plugins that were unghosted when they were activated during the transaction are
+    /// ghosted again, so that the restored load order's plugin paths exist. If that fails, the
+    /// transaction remains in progress.
+    pub fn abort(&mut self) -> Result<(), loadorder::Error> {
+        let transaction_start = match self.transaction_start {
+            Some(ref x) => Arc::clone(x),
+            None => return Ok(()),
+        };
+
+        reghost_plugins(&**transaction_start, &**self.load_order)?;
+
+        self.load_order = transaction_start;
+        self.transaction_start = None;
+        self.generation = self.generation.wrapping_add(1);
+        Ok(())
+    }
+
+    /// Get the load order shared with the published snapshot, and its generation, so that a copy
+    /// of it can be changed without holding the lock.
+    pub fn shared_load_order(&self) -> (Arc<Box<WritableLoadOrder>>, u64) {
+        (Arc::clone(&self.load_order), self.generation)
+    }
+
+    /// Replace the load order with one that was changed without holding the lock, unless the
+    /// state has changed since the given generation. Returns whether the load order was replaced.
+    pub fn replace_load_order(
+        &mut self,
+        load_order: Box<WritableLoadOrder>,
+        generation: u64,
+    ) -> bool {
+        if self.generation != generation {
+            return false;
+        }
+
+        self.load_order = Arc::new(load_order);
+        self.generation = self.generation.wrapping_add(1);
+        true
+    }
+}
+
+/// Ghost the plugin files that are ghosted in `original` but were unghosted in `changed`.
+fn reghost_plugins(
+    original: &WritableLoadOrder,
+    changed: &WritableLoadOrder,
+) -> Result<(), loadorder::Error> {
+    let plugins_directory = original.game_settings().plugins_directory();
+    let changed_states = changed.plugin_states();
+
+    for state in original.plugin_states().iter().filter(|s| s.is_ghosted) {
+        let is_unghosted = changed
+            .index_of(state.name)
+            .and_then(|i| changed_states.get(i))
+            .map(|s| !s.is_ghosted)
+            .unwrap_or(false);
+        let path = plugins_directory.join(state.name);
+
+        // The file may already have been ghosted by an earlier attempt to abort.
+        if is_unghosted && path.exists() {
+            let mut ghosted_path = path.clone().into_os_string();
+            ghosted_path.push(".ghost");
+            fs::rename(&path, ghosted_path)?;
+        }
+    }
+
+    Ok(())
+}
+
+impl Deref for HandleState {
+    type Target = Box<WritableLoadOrder>;
+
+    fn deref(&self) -> &Box<WritableLoadOrder> {
+        &self.load_order
+    }
+}
+
+impl DerefMut for HandleState {
+    fn deref_mut(&mut self) -> &mut Box<WritableLoadOrder> {
+        self.generation = self.generation.wrapping_add(1);
+        Arc::make_mut(&mut self.load_order)
+    }
+}
+
+/// Exclusive access to a game handle's state, which publishes a new snapshot of the state when
+/// dropped if the state has changed.
+pub struct StateGuard<'a> {
+    handle: &'a GameHandle,
+    state: MutexGuard<'a, HandleState>,
+}
+
+impl<'a> Deref for StateGuard<'a> {
+    type Target = HandleState;
+
+    fn deref(&self) -> &HandleState {
+        &self.state
+    }
+}
+
+impl<'a> DerefMut for StateGuard<'a> {
+    fn deref_mut(&mut self) -> &mut HandleState {
+        &mut self.state
+    }
+}
+
+impl<'a> Drop for StateGuard<'a> {
+    fn drop(&mut self) {
+        // Don't publish state that a panic may have left inconsistent.
+        if thread::panicking() {
+            return;
+        }
+
+        let is_changed = match self.handle.published.read() {
+            Ok(published) => !published.is_snapshot_of(&self.state),
+            Err(_) => true,
+        };
+
+        if is_changed {
+            self.handle.publish(&self.state);
+        }
+    }
+}
+
+/// An immutable snapshot of a game handle's state, which readers hold without blocking writers.
+pub struct Snapshot {
+    load_order: Arc<Box<WritableLoadOrder>>,
+    in_transaction: bool,
+    generation: u64,
+}
+
+impl Snapshot {
+    fn new(state: &HandleState) -> Snapshot {
+        Snapshot {
+            load_order: Arc::clone(&state.load_order),
+            in_transaction: state.in_transaction(),
+            generation: state.generation,
+        }
+    }
+
+    fn is_snapshot_of(&self, state: &HandleState) -> bool {
+        self.generation == state.generation && self.in_transaction == state.in_transaction()
+            && Arc::ptr_eq(&self.load_order, &state.load_order)
+    }
+
+    pub fn in_transaction(&self) -> bool {
+        self.in_transaction
     }
 
-    pub fn write(&self) -> LockResult<RwLockWriteGuard<Box<WritableLoadOrder>>> {
-        self.0.write()
+    pub fn generation(&self) -> u64 {
+        self.generation
     }
 }
 
+impl Deref for Snapshot {
+    type Target = Box<WritableLoadOrder>;
+
+    fn deref(&self) -> &Box<WritableLoadOrder> {
+        &self.load_order
+    }
+}
+
+fn update_view<'a, F>(
+    view: &Mutex<StringArrayView>,
+    generation: u64,
+    get_strings: F,
+) -> Result<(*const *const c_char, size_t), u32>
+where
+    F: FnOnce() -> Vec<&'a str>,
+{
+    let mut view = view.lock().map_err(|_| LIBLO_ERROR_POISONED_THREAD_LOCK)?;
+
+    view.update(generation, get_strings)?;
+
+    Ok((view.as_ptr(), view.len()))
+}
+
 fn map_game_id(game_id: u32) -> Result<GameId, u32> {
     match game_id {
         x if x == LIBLO_GAME_TES3 => Ok(GameId::Morrowind),
@@ -68,6 +415,17 @@ fn map_game_id(game_id: u32) -> Result<GameId, u32> {
     }
 }
 
+fn map_write_durability(durability: u32) -> Result<WriteDurability, u32> {
+    match durability {
+        x if x == LIBLO_DURABILITY_BUFFERED => Ok(WriteDurability::Buffered),
+        x if x == LIBLO_DURABILITY_SYNC_FILE => Ok(WriteDurability::SyncFile),
+        x if x == LIBLO_DURABILITY_SYNC_FILE_AND_DIRECTORY => {
+            Ok(WriteDurability::SyncFileAndDirectory)
+        }
+        _ => Err(LIBLO_ERROR_INVALID_ARGS),
+    }
+}
+
 /// Initialise a new game handle.
 ///
 /// Creates a handle for a game, which is then used by all load order and active plugin functions.
@@ -91,76 +449,116 @@ pub unsafe extern "C" fn lo_create_handle(
     game_path: *const c_char,
     local_path: *const c_char,
 ) -> c_uint {
-    catch_unwind(|| {
-        if handle.is_null() || game_path.is_null() {
-            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer(s) passed");
-        }
+    catch_unwind(|| create_handle(handle, game_id, game_path, local_path, 0))
+        .unwrap_or(LIBLO_ERROR_PANICKED)
+}
 
-        let game_id = match map_game_id(game_id) {
-            Ok(x) => x,
-            Err(x) => return error(x, "Invalid game specified"),
-        };
+/// Initialise a new game handle with the given options.
+///
+/// This function has the same effect as `lo_create_handle()`, except that `options` is a bitwise
+/// OR of `LIBLO_HANDLE_*` flags, or zero for none:
+///
+/// - `LIBLO_HANDLE_SHARED_PLUGIN_CACHE` gives the handle a plugin header cache that is held in
+///   memory and shared with all other handles for the same game that were created with this flag.
+///   Plugins are identified by their canonical path, size and modification time, so handles for
+///   different profiles of the same game install only read each plugin's header once, and share a
+///   single copy of its data. Setting a cache path using `lo_set_cache_path()` replaces the shared
+///   cache.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_create_handle_with_options(
+    handle: *mut lo_game_handle,
+    game_id: c_uint,
+    game_path: *const c_char,
+    local_path: *const c_char,
+    options: c_uint,
+) -> c_uint {
+    catch_unwind(|| create_handle(handle, game_id, game_path, local_path, options))
+        .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+unsafe fn create_handle(
+    handle: *mut lo_game_handle,
+    game_id: c_uint,
+    game_path: *const c_char,
+    local_path: *const c_char,
+    options: c_uint,
+) -> c_uint {
+    if handle.is_null() || game_path.is_null() {
+        return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer(s) passed");
+    }
+
+    let game_id = match map_game_id(game_id) {
+        Ok(x) => x,
+        Err(x) => return error(x, "Invalid game specified"),
+    };
 
-        let game_path = match to_str(game_path) {
+    let game_path = match to_str(game_path) {
+        Ok(x) => Path::new(x),
+        Err(x) => return x,
+    };
+
+    if !game_path.is_dir() {
+        return error(
+            LIBLO_ERROR_INVALID_ARGS,
+            &format!(
+                "Given game path \"{:?}\" is not a valid directory",
+                game_path
+            ),
+        );
+    }
+
+    let mut load_order: Box<WritableLoadOrder>;
+    if local_path.is_null() {
+        #[cfg(not(windows))]
+        return error(
+            LIBLO_ERROR_INVALID_ARGS,
+            "A local data path must be supplied on non-Windows platforms",
+        );
+
+        #[cfg(windows)]
+        match GameSettings::new(game_id, game_path) {
+            Ok(x) => load_order = x.into_load_order(),
+            Err(x) => return handle_error(x),
+        }
+    } else {
+        let local_path = match to_str(local_path) {
             Ok(x) => Path::new(x),
             Err(x) => return x,
         };
 
-        if !game_path.is_dir() {
+        if !local_path.is_dir() {
             return error(
                 LIBLO_ERROR_INVALID_ARGS,
                 &format!(
-                    "Given game path \"{:?}\" is not a valid directory",
-                    game_path
+                    "Given local data path \"{:?}\" is not a valid directory",
+                    local_path
                 ),
             );
         }
 
-        let load_order: Box<WritableLoadOrder>;
-        if local_path.is_null() {
-            #[cfg(not(windows))]
-            return error(
-                LIBLO_ERROR_INVALID_ARGS,
-                "A local data path must be supplied on non-Windows platforms",
-            );
+        match GameSettings::with_local_path(game_id, game_path, local_path) {
+            Ok(x) => load_order = x.into_load_order(),
+            Err(x) => return handle_error(x),
+        }
+    }
 
-            #[cfg(windows)]
-            match GameSettings::new(game_id, game_path) {
-                Ok(x) => load_order = x.into_load_order(),
-                Err(x) => return handle_error(x),
-            }
-        } else {
-            let local_path = match to_str(local_path) {
-                Ok(x) => Path::new(x),
-                Err(x) => return x,
-            };
-
-            if !local_path.is_dir() {
-                return error(
-                    LIBLO_ERROR_INVALID_ARGS,
-                    &format!(
-                        "Given local data path \"{:?}\" is not a valid directory",
-                        local_path
-                    ),
-                );
-            }
+    if options & LIBLO_HANDLE_SHARED_PLUGIN_CACHE != 0 {
+        load_order.game_settings_mut().set_plugin_cache_shared(true);
+    }
 
-            match GameSettings::with_local_path(game_id, game_path, local_path) {
-                Ok(x) => load_order = x.into_load_order(),
-                Err(x) => return handle_error(x),
-            }
-        }
+    let is_self_consistent = load_order.is_self_consistent();
 
-        let is_self_consistent = load_order.is_self_consistent();
+    let state = HandleState::new(load_order);
 
-        *handle = Box::into_raw(Box::new(GameHandle(RwLock::new(load_order))));
+    *handle = Box::into_raw(Box::new(GameHandle::new(state)));
 
-        match is_self_consistent {
-            Ok(true) => LIBLO_OK,
-            Ok(false) => LIBLO_WARN_LO_MISMATCH,
-            Err(x) => handle_error(x),
-        }
-    }).unwrap_or(LIBLO_ERROR_PANICKED)
+    match is_self_consistent {
+        Ok(true) => LIBLO_OK,
+        Ok(false) => LIBLO_WARN_LO_MISMATCH,
+        Err(x) => handle_error(x),
+    }
 }
 
 /// Destroy an existing game handle.
@@ -170,10 +568,173 @@ pub unsafe extern "C" fn lo_create_handle(
 #[no_mangle]
 pub unsafe extern "C" fn lo_destroy_handle(handle: lo_game_handle) {
     if !handle.is_null() {
+        (*handle).stop_background_threads();
         Box::from_raw(handle);
     }
 }
 
+/// Set the path of the plugin cache file.
+///
+/// libloadorder can persist the data it reads from plugin headers in a cache file, so that plugins
+/// whose path, size and modification time have not changed since they were last read do not need
+/// to be parsed again by `lo_load_current_state()` or `lo_fix_plugin_lists()`. The cache is
+/// disabled by default. Passing a null `path` disables it again.
+///
+/// If a file exists at the given path, it is read immediately, and if it is not a valid cache file
+/// its content is ignored. The cache file is written whenever the load order state is loaded.
+/// Setting a cache path replaces any shared plugin cache the handle was created with.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_set_cache_path(handle: lo_game_handle, path: *const c_char) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let path = if path.is_null() {
+            None
+        } else {
+            match to_str(path) {
+                Ok(x) => Some(Path::new(x)),
+                Err(x) => return x,
+            }
+        };
+
+        let mut handle = match (*handle).write() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+            Ok(h) => h,
+        };
+
+        if let Err(x) = handle.game_settings_mut().set_plugin_cache_path(path) {
+            return handle_error(x);
+        }
+
+        LIBLO_OK
+    }).unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Set how durably the load order and active plugins files are written.
+///
+/// libloadorder always saves files by writing a temporary file that then replaces the file being
+/// updated, so that other processes never see a partially written file, and does not write files
+/// whose content would be unchanged. The durability is one of the `LIBLO_DURABILITY_*`
+/// constants, and controls whether saved data is also flushed to disk before functions that save
+/// changes return. The default is `LIBLO_DURABILITY_BUFFERED`.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_set_write_durability(
+    handle: lo_game_handle,
+    durability: c_uint,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let durability = match map_write_durability(durability) {
+            Ok(x) => x,
+            Err(x) => return error(x, "Invalid durability specified"),
+        };
+
+        let mut handle = match (*handle).write() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+            Ok(h) => h,
+        };
+
+        handle.game_settings_mut().set_write_durability(durability);
+
+        LIBLO_OK
+    }).unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Set the maximum number of threads used to unghost plugins.
+///
+/// Functions that activate many plugins at once, such as `lo_set_active_plugins()` and
+/// `lo_load_current_state()`, unghost ghosted plugins concurrently using up to this many threads.
+/// Unghosting is limited by filesystem latency rather than CPU time, so the limit is independent of
+/// the number of CPU cores. The default is 8, and a `concurrency` of zero is treated as one.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_set_io_concurrency(
+    handle: lo_game_handle,
+    concurrency: size_t,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let mut handle = match (*handle).write() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+            Ok(h) => h,
+        };
+
+        handle.game_settings_mut().set_io_concurrency(concurrency);
+
+        LIBLO_OK
+    }).unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Set the number of threads used for CPU-bound work.
+///
+/// Work such as reading plugin headers and checking plugin names is split between threads in a
+/// thread pool. By default, all game handles share a global pool that has a thread for each CPU
+/// core. Setting a non-zero `count` creates a pool with that many threads for the handle, so that
+/// it doesn't compete with other threads in the process, and a `count` of zero uses the global
+/// pool again.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_set_thread_count(handle: lo_game_handle, count: size_t) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let mut handle = match (*handle).write() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+            Ok(h) => h,
+        };
+
+        if let Err(x) = handle.game_settings_mut().set_thread_count(count) {
+            return handle_error(x);
+        }
+
+        LIBLO_OK
+    }).unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Set the number of plugins below which work is not split between threads.
+///
+/// Splitting work between threads has a cost that outweighs its benefit for small load orders, so
+/// work on fewer plugins or plugin names than the threshold is done on the calling thread. The
+/// default is 64, and a `threshold` of zero is treated as one.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_set_sequential_threshold(
+    handle: lo_game_handle,
+    threshold: size_t,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let mut handle = match (*handle).write() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+            Ok(h) => h,
+        };
+
+        handle.game_settings_mut().set_sequential_threshold(threshold);
+
+        LIBLO_OK
+    }).unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
 /// Load the current load order state, discarding any previously held state.
 ///
 /// This function should be called whenever the load order or active state of plugins "on disk"
@@ -197,6 +758,88 @@ pub unsafe extern "C" fn lo_load_current_state(handle: lo_game_handle) -> c_uint
     }).unwrap_or(LIBLO_ERROR_PANICKED)
 }
 
+/// Refresh the load order state, only re-reading plugins that have changed.
+///
+/// This function has the same effect as `lo_load_current_state()`, but plugins that were already
+/// held in the handle's state and whose paths and modification times are unchanged are not read
+/// again, which makes it much cheaper to call when only a few plugins have changed on disk.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_refresh_current_state(handle: lo_game_handle) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+        let mut handle = match (*handle).write() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+            Ok(h) => h,
+        };
+
+        if let Err(x) = handle.refresh() {
+            return handle_error(x);
+        }
+
+        LIBLO_OK
+    }).unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Get the generation of the handle's load order state.
+///
+/// The generation is a number that is incremented whenever a function that may change the
+/// handle's load order state is called, so comparing it with a previously retrieved generation is a
+/// cheap way to check whether the load order or active plugins may have changed since they were
+/// last retrieved. The generation does not reflect any changes made on disk that have not been
+/// loaded.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_get_generation(handle: lo_game_handle, generation: *mut u64) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || generation.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+        let handle = match (*handle).read() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+            Ok(h) => h,
+        };
+
+        *generation = handle.generation();
+
+        LIBLO_OK
+    }).unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Check if the load order state on disk may have changed since it was last loaded.
+///
+/// This only checks the modification times and sizes of the plugins directory, the active plugins
+/// and load order files and any file that implicitly active plugins are read from, and for
+/// timestamp-based load orders, the modification times of the loaded plugins. It is much cheaper
+/// than loading the state again, so can be used to avoid redundant calls to
+/// `lo_load_current_state()`. Changes that libloadorder itself makes to the plugins directory, e.g.
+/// when unghosting plugins, may also be reported as changes.
+///
+/// The output is `true` if the state has not been loaded or may have changed, and `false`
+/// otherwise.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_is_stale(handle: lo_game_handle, result: *mut bool) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || result.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+        let handle = match (*handle).read() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+            Ok(h) => h,
+        };
+
+        *result = handle.is_stale();
+
+        LIBLO_OK
+    }).unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
 /// Fix up the text file(s) used by the load order and active plugins systems.
 ///
 /// This checks that the load order and active plugin lists conform to libloadorder's validity
@@ -229,7 +872,106 @@ pub unsafe extern "C" fn lo_fix_plugin_lists(handle: lo_game_handle) -> c_uint {
             return handle_error(x);
         }
 
-        if let Err(x) = handle.save() {
+        if let Err(x) = handle.save_unless_in_transaction() {
+            return handle_error(x);
+        }
+
+        LIBLO_OK
+    }).unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Begin a transaction.
+///
+/// While a transaction is in progress, functions that change the load order or active plugins
+/// (including `lo_fix_plugin_lists()`) still validate and apply their changes to the handle's
+/// state, but do not write the active plugins, load order or plugin timestamps to disk. All the
+/// changes made during the transaction are then written together by `lo_commit_transaction()`, or
+/// discarded by `lo_abort_transaction()`. This is much faster than saving after every change when
+/// making many changes at once.
+///
+/// Activating a ghosted plugin during a transaction still unghosts its file immediately, as the
+/// plugin must be readable while it is active. Aborting the transaction ghosts the file again.
+///
+/// Other functions called with the handle while a transaction is in progress see its uncommitted
+/// changes. Transactions cannot be nested.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_begin_transaction(handle: lo_game_handle) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+        let mut handle = match (*handle).write() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+            Ok(h) => h,
+        };
+
+        if handle.in_transaction() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "A transaction is already in progress");
+        }
+
+        handle.begin_transaction();
+
+        LIBLO_OK
+    }).unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Commit the transaction in progress.
+///
+/// Writes all the changes made since `lo_begin_transaction()` was called to disk at once, and
+/// ends the transaction. If writing the changes fails, the transaction remains in progress, so
+/// that committing it can be retried or it can be aborted.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_commit_transaction(handle: lo_game_handle) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+        let mut handle = match (*handle).write() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+            Ok(h) => h,
+        };
+
+        if !handle.in_transaction() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "No transaction is in progress");
+        }
+
+        if let Err(x) = handle.commit() {
+            return handle_error(x);
+        }
+
+        LIBLO_OK
+    }).unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Abort the transaction in progress.
+///
+/// Discards all the changes made since `lo_begin_transaction()` was called by restoring the
+/// handle's load order state to what it was then, and ends the transaction. Changes made on disk by
+/// other programs during the transaction are not loaded: use `lo_refresh_current_state()` to load
+/// them. Plugins that were unghosted by activating them during the transaction are ghosted again.
+/// If ghosting them fails, the transaction remains in progress.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_abort_transaction(handle: lo_game_handle) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+        let mut handle = match (*handle).write() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+            Ok(h) => h,
+        };
+
+        if !handle.in_transaction() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "No transaction is in progress");
+        }
+
+        if let Err(x) = handle.abort() {
             return handle_error(x);
         }
 
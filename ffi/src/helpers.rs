@@ -19,13 +19,15 @@
 use std::ffi::{CStr, CString};
 use std::io;
 use std::mem;
+use std::ptr;
 use std::slice;
 
 use libc::{c_char, c_uint, size_t};
-use loadorder::Error;
+use loadorder::{Error, PluginChange, PluginState};
 
 use super::ERROR_MESSAGE;
 use constants::*;
+use load_order::{lo_plugin_change, lo_plugin_state};
 
 pub fn error(code: c_uint, message: &str) -> c_uint {
     ERROR_MESSAGE.with(|f| {
@@ -63,12 +65,16 @@ fn map_error(err: &Error) -> c_uint {
         &PluginNotFound(_) => LIBLO_ERROR_INVALID_ARGS,
         &TooManyActivePlugins => LIBLO_ERROR_INVALID_ARGS,
         &InvalidRegex => LIBLO_ERROR_INTERNAL_LOGIC_ERROR,
+        &ThreadPoolError(_) => LIBLO_ERROR_INTERNAL_LOGIC_ERROR,
         &DuplicatePlugin => LIBLO_ERROR_INVALID_ARGS,
         &NonMasterBeforeMaster => LIBLO_ERROR_INVALID_ARGS,
         &GameMasterMustLoadFirst => LIBLO_ERROR_INVALID_ARGS,
         &InvalidPlugin(_) => LIBLO_ERROR_INVALID_ARGS,
         &ImplicitlyActivePlugin(_) => LIBLO_ERROR_INVALID_ARGS,
         &NoLocalAppData => LIBLO_ERROR_INVALID_ARGS,
+        &ActivationFailed(ref x) => x.first()
+            .map(|&(_, ref e)| map_error(e))
+            .unwrap_or(LIBLO_ERROR_INTERNAL_LOGIC_ERROR),
     }
 }
 
@@ -103,6 +109,185 @@ pub fn to_c_string_array<S: AsRef<str>>(strings: &[S]) -> Result<(*mut *mut c_ch
     Ok((pointer, size))
 }
 
+/// Copy named items into an array of records, storing all their names in a single buffer that is
+/// allocated separately from the array and starts at the first record's name, so that both are
+/// freed by `free_named_record_array()` without any other bookkeeping.
+fn to_named_record_array<I, T, N, F>(
+    items: &[I],
+    name: N,
+    to_record: F,
+) -> Result<(*mut T, size_t), u32>
+where
+    N: Fn(&I) -> &str,
+    F: Fn(&I, *const c_char) -> T,
+{
+    let names_size = items.iter().map(|i| name(i).len() + 1).sum();
+    let mut names: Vec<u8> = Vec::with_capacity(names_size);
+    let mut offsets = Vec::with_capacity(items.len());
+    for item in items {
+        if name(item).as_bytes().contains(&0) {
+            return Err(LIBLO_ERROR_TEXT_ENCODE_FAIL);
+        }
+        offsets.push(names.len());
+        names.extend_from_slice(name(item).as_bytes());
+        names.push(0);
+    }
+
+    let names = Box::into_raw(names.into_boxed_slice()) as *mut c_char;
+
+    let records: Box<[T]> = items
+        .iter()
+        .zip(offsets)
+        .map(|(item, offset)| to_record(item, unsafe { names.offset(offset as isize) }))
+        .collect::<Vec<_>>()
+        .into_boxed_slice();
+
+    let size = records.len();
+
+    Ok((Box::into_raw(records) as *mut T, size))
+}
+
+/// Free an array output by `to_named_record_array()`.
+unsafe fn free_named_record_array<T, N>(array: *mut T, size: size_t, name: N)
+where
+    N: Fn(&T) -> *const c_char,
+{
+    let records = Box::from_raw(slice::from_raw_parts_mut(array, size));
+
+    let names_size = records
+        .iter()
+        .map(|r| CStr::from_ptr(name(r)).to_bytes().len() + 1)
+        .sum();
+    let names = name(&records[0]) as *mut c_char;
+
+    Box::from_raw(slice::from_raw_parts_mut(names, names_size));
+}
+
+/// Copy plugin states into an array of records that is freed by `lo_free_load_order_state()`.
+pub fn to_plugin_state_array(
+    states: &[PluginState],
+) -> Result<(*mut lo_plugin_state, size_t), u32> {
+    to_named_record_array(
+        states,
+        |state| state.name,
+        |state, name| lo_plugin_state {
+            name,
+            flags: to_plugin_state_flags(state),
+        },
+    )
+}
+
+fn to_plugin_state_flags(state: &PluginState) -> c_uint {
+    let mut flags = 0;
+    if state.is_active {
+        flags |= LIBLO_PLUGIN_ACTIVE;
+    }
+    if state.is_master {
+        flags |= LIBLO_PLUGIN_MASTER;
+    }
+    if state.is_light_master {
+        flags |= LIBLO_PLUGIN_LIGHT_MASTER;
+    }
+    if state.is_ghosted {
+        flags |= LIBLO_PLUGIN_GHOSTED;
+    }
+    flags
+}
+
+/// Free an array output by `to_plugin_state_array()`.
+pub unsafe fn free_plugin_state_array(array: *mut lo_plugin_state, size: size_t) {
+    free_named_record_array(array, size, |r| r.name);
+}
+
+/// Copy plugin changes into an array of records that is freed by `lo_free_pending_changes()`.
+pub fn to_plugin_change_array(
+    changes: &[PluginChange],
+) -> Result<(*mut lo_plugin_change, size_t), u32> {
+    to_named_record_array(
+        changes,
+        |change| change.name,
+        |change, name| lo_plugin_change {
+            name,
+            flags: to_plugin_change_flags(change),
+        },
+    )
+}
+
+fn to_plugin_change_flags(change: &PluginChange) -> c_uint {
+    let mut flags = 0;
+    if change.is_added {
+        flags |= LIBLO_CHANGE_ADDED;
+    }
+    if change.is_removed {
+        flags |= LIBLO_CHANGE_REMOVED;
+    }
+    if change.is_moved {
+        flags |= LIBLO_CHANGE_MOVED;
+    }
+    if change.is_activated {
+        flags |= LIBLO_CHANGE_ACTIVATED;
+    }
+    if change.is_deactivated {
+        flags |= LIBLO_CHANGE_DEACTIVATED;
+    }
+    flags
+}
+
+/// Free an array output by `to_plugin_change_array()`.
+pub unsafe fn free_plugin_change_array(array: *mut lo_plugin_change, size: size_t) {
+    free_named_record_array(array, size, |r| r.name);
+}
+
+/// An array of C strings that is owned by a game handle, so that it can be lent to callers instead
+/// of being copied for each of them. It is only rebuilt when the generation of the handle's state
+/// that it was built from is out of date.
+#[derive(Default)]
+pub struct StringArrayView {
+    generation: Option<u64>,
+    strings: Vec<CString>,
+    pointers: Vec<*const c_char>,
+}
+
+// The pointers only point into the strings owned by the view.
+unsafe impl Send for StringArrayView {}
+
+impl StringArrayView {
+    pub fn update<S, F>(&mut self, generation: u64, get_strings: F) -> Result<(), u32>
+    where
+        S: AsRef<str>,
+        F: FnOnce() -> Vec<S>,
+    {
+        if self.generation == Some(generation) {
+            return Ok(());
+        }
+
+        let strings = get_strings()
+            .iter()
+            .map(|s| CString::new(s.as_ref()))
+            .collect::<Result<Vec<CString>, _>>()
+            .map_err(|_| LIBLO_ERROR_TEXT_ENCODE_FAIL)?;
+
+        // Moving the CStrings into the view doesn't move their buffers.
+        self.pointers = strings.iter().map(|s| s.as_ptr()).collect();
+        self.strings = strings;
+        self.generation = Some(generation);
+
+        Ok(())
+    }
+
+    pub fn as_ptr(&self) -> *const *const c_char {
+        if self.pointers.is_empty() {
+            ptr::null()
+        } else {
+            self.pointers.as_ptr()
+        }
+    }
+
+    pub fn len(&self) -> size_t {
+        self.pointers.len()
+    }
+}
+
 pub unsafe fn to_str_vec<'a>(
     array: *const *const c_char,
     array_size: usize,
@@ -42,13 +42,20 @@
 //!
 //! ## Thread Safety
 //!
-//! libloadorder-ffi is thread-safe. Reading and writing data for a single game handle is protected
-//! by a reader-writer lock, and error messages are stored thread-locally.
+//! libloadorder-ffi is thread-safe, and error messages are stored thread-locally. Writing data for a
+//! single game handle is protected by a lock, and changes are made to a copy of the handle's state
+//! that is published once each change is complete. Functions that only read data use the last
+//! published state, so never wait for a write to finish.
 //!
 //! Game handles operate independently, so using more than one game handle for a single game across
 //! multiple threads is not advised, as filesystem changes made when writing data are not atomic
 //! and data races may occur under such usage.
 //!
+//! A game handle that has a change callback set by `lo_set_change_callback()` runs a watcher
+//! thread that checks for changes using the published state, and that calls the callback.
+//! Similarly, `lo_load_current_state_async()` and `lo_save_async()` run their jobs on a worker
+//! thread that the handle starts when it is first needed.
+//!
 //! ## Data Caching
 //!
 //! libloadorder caches plugin data to improve performance. Each game handle has its own unique
@@ -58,6 +65,12 @@
 //! - calling `lo_fix_plugin_lists()`
 //! - an error is encountered writing a change.
 //!
+//! Plugin header data can also be persisted between sessions by setting a cache file path using
+//! `lo_set_cache_path()`. Cached header data is only reused for plugins whose path, size and
+//! modification time are unchanged. Alternatively, handles created using
+//! `lo_create_handle_with_options()` with the `LIBLO_HANDLE_SHARED_PLUGIN_CACHE` flag share an
+//! in-memory cache of plugin header data with each other.
+//!
 //! ## Plugin Validity
 //!
 //! Where libloadorder functions take one or more plugin filenames, it checks that these filenames
@@ -98,6 +111,9 @@
 //! there are additional conditions that may be enforced by the game (e.g. a plugin must load after
 //! all the plugins it depends on).
 //!
+//! A proposed load order can be checked against these conditions without setting it using
+//! `lo_validate_load_order()`.
+//!
 //! Libloadorder is less strict when loading load orders and will adjust them at load time to be
 //! valid, similar to game behaviour.
 
@@ -109,6 +125,7 @@ use std::ffi::CString;
 use std::io;
 use std::panic::catch_unwind;
 use std::ptr;
+use std::slice;
 
 use libc::{c_char, c_uint, size_t};
 use loadorder::Error;
@@ -118,12 +135,18 @@ mod constants;
 mod handle;
 mod helpers;
 mod load_order;
+mod metrics;
+mod watcher;
+mod worker;
 
 pub use active_plugins::*;
 pub use constants::*;
 pub use handle::*;
-use helpers::error;
+use helpers::{error, free_plugin_change_array, free_plugin_state_array};
 pub use load_order::*;
+pub use metrics::*;
+pub use watcher::*;
+pub use worker::*;
 
 thread_local!(static ERROR_MESSAGE: RefCell<CString> = RefCell::new(CString::default()));
 
@@ -228,3 +251,42 @@ pub unsafe extern "C" fn lo_free_string_array(array: *mut *mut c_char, size: siz
         lo_free_string(string);
     }
 }
+
+/// Free memory allocated to plugin state array output.
+///
+/// This function should be called to free memory allocated by `lo_get_load_order_state()`.
+#[no_mangle]
+pub unsafe extern "C" fn lo_free_load_order_state(states: *mut lo_plugin_state, size: size_t) {
+    if states.is_null() || size == 0 {
+        return;
+    }
+
+    free_plugin_state_array(states, size);
+}
+
+/// Free memory allocated to pending change array output.
+///
+/// This function should be called to free memory allocated by `lo_get_pending_changes()`.
+#[no_mangle]
+pub unsafe extern "C" fn lo_free_pending_changes(changes: *mut lo_plugin_change, size: size_t) {
+    if changes.is_null() || size == 0 {
+        return;
+    }
+
+    free_plugin_change_array(changes, size);
+}
+
+/// Free memory allocated to load order violation array output.
+///
+/// This function should be called to free memory allocated by `lo_validate_load_order()`.
+#[no_mangle]
+pub unsafe extern "C" fn lo_free_load_order_violations(
+    violations: *mut lo_load_order_violation,
+    size: size_t,
+) {
+    if violations.is_null() || size == 0 {
+        return;
+    }
+
+    drop(Box::from_raw(slice::from_raw_parts_mut(violations, size)));
+}
@@ -22,11 +22,14 @@ use std::panic::catch_unwind;
 use std::ptr;
 
 use libc::{c_char, c_uint, size_t};
-use loadorder::LoadOrderMethod;
+use loadorder::{LoadOrderMethod, LoadOrderViolation};
 
 use super::lo_game_handle;
 use constants::*;
-use helpers::{error, handle_error, to_c_string, to_c_string_array, to_str, to_str_vec};
+use helpers::{
+    error, handle_error, to_c_string, to_c_string_array, to_plugin_change_array,
+    to_plugin_state_array, to_str, to_str_vec,
+};
 
 /// Get which method is used for the load order.
 ///
@@ -99,6 +102,175 @@ pub unsafe extern "C" fn lo_get_load_order(
     }).unwrap_or(LIBLO_ERROR_PANICKED)
 }
 
+/// A plugin's name and status, as output by `lo_get_load_order_state()`.
+///
+/// `flags` is a bitwise OR of the `LIBLO_PLUGIN_*` flags that apply to the plugin.
+#[allow(non_camel_case_types)]
+#[repr(C)]
+pub struct lo_plugin_state {
+    pub name: *const c_char,
+    pub flags: c_uint,
+}
+
+/// Get the current load order, along with whether each plugin is active, a master, a light master
+/// or ghosted.
+///
+/// Outputs an array of records in load order, each holding a plugin's filename and a bitwise OR of
+/// the `LIBLO_PLUGIN_*` flags that apply to it. This gives the same information as calling
+/// `lo_get_load_order()` and then `lo_get_plugin_active()` for each plugin, but reads the
+/// handle's state once, and the filenames are stored in one buffer instead of one allocation per
+/// plugin. The array and its strings must not be modified, and must be freed together using
+/// `lo_free_load_order_state()`.
+///
+/// If no plugins are in the current order, the value pointed to by `states` will be null and
+/// `num_states` will point to zero.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_get_load_order_state(
+    handle: lo_game_handle,
+    states: *mut *mut lo_plugin_state,
+    num_states: *mut size_t,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || states.is_null() || num_states.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+        let handle = match (*handle).read() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+            Ok(h) => h,
+        };
+
+        *states = ptr::null_mut();
+        *num_states = 0;
+
+        let plugin_states = handle.plugin_states();
+
+        if plugin_states.is_empty() {
+            return LIBLO_OK;
+        }
+
+        match to_plugin_state_array(&plugin_states) {
+            Ok((pointer, size)) => {
+                *states = pointer;
+                *num_states = size;
+            }
+            Err(x) => return error(x, "A filename contained a null byte"),
+        }
+
+        LIBLO_OK
+    }).unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// A plugin that has changed since a handle's load order was last loaded or saved, as output by
+/// `lo_get_pending_changes()`.
+///
+/// `flags` is a bitwise OR of the `LIBLO_CHANGE_*` flags that apply to the plugin.
+#[allow(non_camel_case_types)]
+#[repr(C)]
+pub struct lo_plugin_change {
+    pub name: *const c_char,
+    pub flags: c_uint,
+}
+
+/// Get the plugins that have been added, removed, moved, activated or deactivated since the
+/// handle's load order was last loaded or saved.
+///
+/// Outputs an array of records holding each changed plugin's filename and a bitwise OR of the
+/// `LIBLO_CHANGE_*` flags that apply to it. Plugins in the current load order are given in load
+/// order, followed by removed plugins in their previous load order. Moving a plugin only reports
+/// that plugin as moved, not the plugins it shifts: the moved plugins are the fewest that would
+/// need to be moved to turn the previous load order into the current one, so the changes can be
+/// replicated by applying just them. Added plugins that are active are also flagged as activated.
+///
+/// Changes made during a transaction remain pending until the transaction is committed. The array
+/// and its strings must not be modified, and must be freed using `lo_free_pending_changes()`.
+///
+/// If nothing has changed, the value pointed to by `changes` will be null and `num_changes` will
+/// point to zero.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_get_pending_changes(
+    handle: lo_game_handle,
+    changes: *mut *mut lo_plugin_change,
+    num_changes: *mut size_t,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || changes.is_null() || num_changes.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+        let handle = match (*handle).read() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+            Ok(h) => h,
+        };
+
+        *changes = ptr::null_mut();
+        *num_changes = 0;
+
+        let plugin_changes = handle.pending_changes();
+
+        if plugin_changes.is_empty() {
+            return LIBLO_OK;
+        }
+
+        match to_plugin_change_array(&plugin_changes) {
+            Ok((pointer, size)) => {
+                *changes = pointer;
+                *num_changes = size;
+            }
+            Err(x) => return error(x, "A filename contained a null byte"),
+        }
+
+        LIBLO_OK
+    }).unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Get the current load order without copying it.
+///
+/// This function has the same effect as `lo_get_load_order()`, but instead of outputting a copy
+/// of the load order that must be freed by the caller, it outputs an array that is owned by the
+/// handle and must not be freed. The array is only rebuilt when it is requested after the handle's
+/// generation has changed (see `lo_get_generation()`), so it is much cheaper to call repeatedly.
+///
+/// The array and its strings remain valid until this function is next called with the same handle,
+/// or the handle is destroyed. They are not freed by other functions, including those that change
+/// the handle's state, or by changes made on other threads.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_get_load_order_view(
+    handle: lo_game_handle,
+    plugins: *mut *const *const c_char,
+    num_plugins: *mut size_t,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || plugins.is_null() || num_plugins.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+        let snapshot = match (*handle).read() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+            Ok(h) => h,
+        };
+
+        *plugins = ptr::null();
+        *num_plugins = 0;
+
+        match (*handle).load_order_view(&snapshot) {
+            Ok((pointer, size)) => {
+                *plugins = pointer;
+                *num_plugins = size;
+            }
+            Err(x) if x == LIBLO_ERROR_POISONED_THREAD_LOCK => {
+                return error(x, "The load order view's lock is poisoned")
+            }
+            Err(x) => return error(x, "A filename contained a null byte"),
+        }
+
+        LIBLO_OK
+    }).unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
 /// Set the load order.
 ///
 /// Sets the load order to the passed plugin array, then scans the plugins directory and inserts
@@ -136,7 +308,7 @@ pub unsafe extern "C" fn lo_set_load_order(
             return handle_error(x);
         }
 
-        if let Err(x) = handle.save() {
+        if let Err(x) = handle.save_unless_in_transaction() {
             return handle_error(x);
         }
 
@@ -144,6 +316,103 @@ pub unsafe extern "C" fn lo_set_load_order(
     }).unwrap_or(LIBLO_ERROR_PANICKED)
 }
 
+/// A reason why a proposed load order would be rejected, as output by `lo_validate_load_order()`.
+///
+/// `kind` is one of the `LIBLO_VIOLATION_*` constants, and `index` is the position in the proposed
+/// load order of the plugin that the violation applies to. `index` is `0` for
+/// `LIBLO_VIOLATION_GAME_MASTER_NOT_FIRST`.
+#[allow(non_camel_case_types)]
+#[repr(C)]
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct lo_load_order_violation {
+    pub kind: c_uint,
+    pub index: size_t,
+}
+
+impl From<LoadOrderViolation> for lo_load_order_violation {
+    fn from(violation: LoadOrderViolation) -> lo_load_order_violation {
+        let (kind, index) = match violation {
+            LoadOrderViolation::DuplicatePlugin(i) => (LIBLO_VIOLATION_DUPLICATE_PLUGIN, i),
+            LoadOrderViolation::UnknownPlugin(i) => (LIBLO_VIOLATION_UNKNOWN_PLUGIN, i),
+            LoadOrderViolation::NonMasterBeforeMaster(i) => {
+                (LIBLO_VIOLATION_NON_MASTER_BEFORE_MASTER, i)
+            }
+            LoadOrderViolation::GameMasterNotFirst => (LIBLO_VIOLATION_GAME_MASTER_NOT_FIRST, 0),
+            LoadOrderViolation::ImplicitlyActivePluginOutOfOrder(i) => {
+                (LIBLO_VIOLATION_IMPLICITLY_ACTIVE_PLUGIN_OUT_OF_ORDER, i)
+            }
+            LoadOrderViolation::TooManyActivePlugins(i) => {
+                (LIBLO_VIOLATION_TOO_MANY_ACTIVE_PLUGINS, i)
+            }
+        };
+
+        lo_load_order_violation { kind, index }
+    }
+}
+
+/// Check whether a proposed load order would be accepted by `lo_set_load_order()`, without
+/// changing the current load order.
+///
+/// The check only uses plugins that are in the current load order, and does not read any files,
+/// so it is cheap enough to run on many candidate load orders. Plugins that are not in the current
+/// load order are reported as `LIBLO_VIOLATION_UNKNOWN_PLUGIN`, and could be accepted by
+/// `lo_set_load_order()` if they are installed, so the current load order should be loaded first.
+/// Unlike `lo_set_load_order()`, all violations are reported rather than only the first.
+///
+/// Outputs an array of violations in the order they were found. If the proposed load order is
+/// valid, the value pointed to by `violations` will be null and `num_violations` will point to
+/// zero. Otherwise, the array must be freed using `lo_free_load_order_violations()`.
+///
+/// Returns `LIBLO_OK` if the check was performed, whether or not any violations were found,
+/// otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_validate_load_order(
+    handle: lo_game_handle,
+    plugins: *const *const c_char,
+    num_plugins: size_t,
+    violations: *mut *mut lo_load_order_violation,
+    num_violations: *mut size_t,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || violations.is_null() || num_violations.is_null()
+            || (plugins.is_null() && num_plugins != 0)
+        {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+        let handle = match (*handle).read() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+            Ok(h) => h,
+        };
+
+        *violations = ptr::null_mut();
+        *num_violations = 0;
+
+        let plugins: Vec<&str> = if num_plugins == 0 {
+            Vec::new()
+        } else {
+            match to_str_vec(plugins, num_plugins) {
+                Ok(x) => x,
+                Err(x) => return error(x, "A filename contained a null byte"),
+            }
+        };
+
+        let found: Vec<lo_load_order_violation> = handle
+            .validate_load_order(&plugins)
+            .into_iter()
+            .map(lo_load_order_violation::from)
+            .collect();
+
+        if found.is_empty() {
+            return LIBLO_OK;
+        }
+
+        *num_violations = found.len();
+        *violations = Box::into_raw(found.into_boxed_slice()) as *mut lo_load_order_violation;
+
+        LIBLO_OK
+    }).unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
 /// Get the load order position of a plugin.
 ///
 /// Load order positions are zero-based, so the first plugin in the load order has a position of
@@ -211,7 +480,7 @@ pub unsafe extern "C" fn lo_set_plugin_position(
             return handle_error(x);
         }
 
-        if let Err(x) = handle.save() {
+        if let Err(x) = handle.save_unless_in_transaction() {
             return handle_error(x);
         }
 
@@ -0,0 +1,204 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+use std::error::Error;
+use std::panic::catch_unwind;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::time::Instant;
+
+use libc::c_uint;
+use loadorder::PhaseMetrics;
+
+use constants::*;
+use handle::lo_game_handle;
+use helpers::error;
+
+/// The number of times a phase of work was performed, and the total time spent performing it.
+#[allow(non_camel_case_types)]
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default)]
+pub struct lo_phase_metrics {
+    pub calls: u64,
+    pub total_ns: u64,
+}
+
+impl From<PhaseMetrics> for lo_phase_metrics {
+    fn from(metrics: PhaseMetrics) -> lo_phase_metrics {
+        lo_phase_metrics {
+            calls: metrics.calls,
+            total_ns: metrics.total_time.as_nanos() as u64,
+        }
+    }
+}
+
+/// Counters and timings recorded by a game handle since metrics were enabled for it.
+///
+/// Phases may be nested in other phases: `load` includes the time spent in `find_plugins`,
+/// `load_plugins`, `read_plugin_lists` and `load_active_plugins`, and `save` includes the time
+/// spent in `write_plugin_lists` and `set_file_times`. `lock_wait` is the time that functions
+/// which change the handle's state spent waiting for other such functions to finish.
+///
+/// `file_opens`, `file_reads`, `file_stats` and `file_renames` count the file system calls made
+/// when scanning the plugins directory, reading plugin headers and writing the active plugins,
+/// load order and plugin cache files. Reads of the plugins directory's entries, the timestamp
+/// checks made when saving a timestamp-based load order and the renames made to unghost plugins
+/// are not counted.
+#[allow(non_camel_case_types)]
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default)]
+pub struct lo_metrics {
+    pub load: lo_phase_metrics,
+    pub save: lo_phase_metrics,
+    pub find_plugins: lo_phase_metrics,
+    pub load_plugins: lo_phase_metrics,
+    pub read_plugin_lists: lo_phase_metrics,
+    pub load_active_plugins: lo_phase_metrics,
+    pub write_plugin_lists: lo_phase_metrics,
+    pub set_file_times: lo_phase_metrics,
+    pub lock_wait: lo_phase_metrics,
+    pub plugin_files_scanned: u64,
+    pub plugin_headers_parsed: u64,
+    pub plugin_headers_reused: u64,
+    pub file_times_set: u64,
+    pub file_opens: u64,
+    pub file_reads: u64,
+    pub file_stats: u64,
+    pub file_renames: u64,
+}
+
+/// Records the time spent waiting to acquire a game handle's write lock, if enabled.
+#[derive(Debug, Default)]
+pub struct LockWaitRecorder {
+    enabled: AtomicBool,
+    calls: AtomicU64,
+    nanoseconds: AtomicU64,
+}
+
+impl LockWaitRecorder {
+    /// Enables or disables recording, discarding any previously recorded waits.
+    pub fn set_enabled(&self, enabled: bool) {
+        self.calls.store(0, Ordering::Relaxed);
+        self.nanoseconds.store(0, Ordering::Relaxed);
+        self.enabled.store(enabled, Ordering::Relaxed);
+    }
+
+    pub fn time<T, F: FnOnce() -> T>(&self, lock: F) -> T {
+        if !self.enabled.load(Ordering::Relaxed) {
+            return lock();
+        }
+
+        let start = Instant::now();
+        let result = lock();
+        let nanoseconds = start.elapsed().as_nanos() as u64;
+
+        self.calls.fetch_add(1, Ordering::Relaxed);
+        self.nanoseconds.fetch_add(nanoseconds, Ordering::Relaxed);
+
+        result
+    }
+
+    pub fn metrics(&self) -> lo_phase_metrics {
+        lo_phase_metrics {
+            calls: self.calls.load(Ordering::Relaxed),
+            total_ns: self.nanoseconds.load(Ordering::Relaxed),
+        }
+    }
+}
+
+/// Enable or disable recording metrics for the given game handle.
+///
+/// Metrics are disabled by default, and when enabled libloadorder counts the work done and the
+/// time spent in each phase of loading and saving the handle's load order state, so that the cost
+/// of slow operations can be attributed. Enabling metrics discards any previously recorded metrics.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_set_metrics_enabled(handle: lo_game_handle, enabled: bool) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+
+        let lock_waits = (*handle).lock_waits();
+
+        let mut handle = match (*handle).write() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+            Ok(h) => h,
+        };
+
+        handle.game_settings_mut().set_metrics_enabled(enabled);
+        lock_waits.set_enabled(enabled);
+
+        LIBLO_OK
+    }).unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Get the metrics recorded for the given game handle.
+///
+/// Fills the structure pointed to by `metrics` with the counters and timings recorded since
+/// metrics were last enabled using `lo_set_metrics_enabled()`. All its values are zero if
+/// metrics are disabled. Timings are given in nanoseconds.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_get_metrics(
+    handle: lo_game_handle,
+    metrics: *mut lo_metrics,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || metrics.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer(s) passed");
+        }
+
+        let lock_waits = (*handle).lock_waits();
+
+        let handle = match (*handle).read() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+            Ok(h) => h,
+        };
+
+        if !handle.game_settings().is_metrics_enabled() {
+            *metrics = lo_metrics::default();
+            return LIBLO_OK;
+        }
+
+        let recorded = handle.game_settings().metrics();
+
+        *metrics = lo_metrics {
+            load: recorded.load.into(),
+            save: recorded.save.into(),
+            find_plugins: recorded.find_plugins.into(),
+            load_plugins: recorded.load_plugins.into(),
+            read_plugin_lists: recorded.read_plugin_lists.into(),
+            load_active_plugins: recorded.load_active_plugins.into(),
+            write_plugin_lists: recorded.write_plugin_lists.into(),
+            set_file_times: recorded.set_file_times.into(),
+            lock_wait: lock_waits.metrics(),
+            plugin_files_scanned: recorded.plugin_files_scanned,
+            plugin_headers_parsed: recorded.plugin_headers_parsed,
+            plugin_headers_reused: recorded.plugin_headers_reused,
+            file_times_set: recorded.file_times_set,
+            file_opens: recorded.file_opens,
+            file_reads: recorded.file_reads,
+            file_stats: recorded.file_stats,
+            file_renames: recorded.file_renames,
+        };
+
+        LIBLO_OK
+    }).unwrap_or(LIBLO_ERROR_PANICKED)
+}
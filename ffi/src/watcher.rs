@@ -0,0 +1,184 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+use std::error::Error;
+use std::panic::catch_unwind;
+use std::sync::mpsc::{channel, RecvTimeoutError, Sender};
+use std::thread::{spawn, JoinHandle};
+use std::time::Duration;
+
+use libc::{c_uint, c_void};
+
+use super::lo_game_handle;
+use constants::*;
+use handle::GameHandle;
+use helpers::error;
+
+/// A function that is called by a game handle's watcher when it detects that the load order state
+/// on disk may have changed. It is passed the game handle and the user data pointer that were given
+/// to `lo_set_change_callback()`.
+#[allow(non_camel_case_types)]
+pub type lo_change_callback =
+    Option<unsafe extern "C" fn(handle: lo_game_handle, user_data: *mut c_void)>;
+
+/// A background thread that periodically checks if a game handle's load order state is stale, and
+/// calls a callback when it is. The thread is stopped when the watcher is dropped.
+pub struct Watcher {
+    stop_sender: Sender<()>,
+    thread: Option<JoinHandle<()>>,
+}
+
+// Raw pointers can't be sent between threads, so the watcher's handle and user data are passed to
+// its thread as integers.
+struct WatcherContext {
+    handle: usize,
+    callback: unsafe extern "C" fn(lo_game_handle, *mut c_void),
+    user_data: usize,
+    interval: Duration,
+    refresh: bool,
+}
+
+impl Watcher {
+    fn start(context: WatcherContext) -> Watcher {
+        let (stop_sender, stop_receiver) = channel();
+
+        let thread = spawn(move || {
+            let handle = context.handle as lo_game_handle;
+            let mut notified_generation = None;
+
+            while let Err(RecvTimeoutError::Timeout) = stop_receiver.recv_timeout(context.interval)
+            {
+                match check(unsafe { &*handle }, context.refresh, &mut notified_generation) {
+                    Some(true) => unsafe {
+                        (context.callback)(handle, context.user_data as *mut c_void)
+                    },
+                    Some(false) => {}
+                    None => break,
+                }
+            }
+        });
+
+        Watcher {
+            stop_sender,
+            thread: Some(thread),
+        }
+    }
+}
+
+impl Drop for Watcher {
+    fn drop(&mut self) {
+        // Sending fails if the thread has already stopped, which is fine.
+        let _ = self.stop_sender.send(());
+
+        if let Some(thread) = self.thread.take() {
+            let _ = thread.join();
+        }
+    }
+}
+
+/// Returns whether the callback should be called, or `None` if the handle's lock is poisoned and
+/// the watcher should stop.
+fn check(
+    handle: &GameHandle,
+    refresh: bool,
+    notified_generation: &mut Option<u64>,
+) -> Option<bool> {
+    {
+        let state = handle.read().ok()?;
+
+        if !state.is_stale() {
+            return Some(false);
+        }
+
+        // Refreshing during a transaction would discard its changes, so only notify.
+        if !refresh || state.in_transaction() {
+            // Only notify once for each generation of the state, until it is reloaded.
+            if *notified_generation == Some(state.generation()) {
+                return Some(false);
+            }
+
+            *notified_generation = Some(state.generation());
+            return Some(true);
+        }
+    }
+
+    let mut state = handle.write().ok()?;
+
+    // The state may have been reloaded or a transaction begun while it was unlocked.
+    if !state.is_stale() || state.in_transaction() {
+        return Some(false);
+    }
+
+    // Notify even if refreshing fails, so that the error can be seen by reloading.
+    let _ = state.refresh();
+
+    Some(true)
+}
+
+/// Set a callback to be called when the load order state on disk may have changed.
+///
+/// Setting a callback starts a watcher for the handle, which checks if its state is stale in the
+/// same way as `lo_is_stale()` every `interval_ms` milliseconds. If it is, and `refresh` is true,
+/// the watcher refreshes the handle's state in the same way as `lo_refresh_current_state()`,
+/// unless a transaction is in progress. It then calls the callback, passing it the handle and
+/// `user_data`. Without refreshing, the callback is called once for each change in the handle's
+/// state, until the state is loaded again.
+///
+/// The callback is called from the watcher's thread, and must not call `lo_set_change_callback()`
+/// or `lo_destroy_handle()` for the same handle. Passing a null `callback` stops any watcher that
+/// was running for the handle. The watcher is also stopped when the handle is destroyed.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_set_change_callback(
+    handle: lo_game_handle,
+    callback: lo_change_callback,
+    user_data: *mut c_void,
+    interval_ms: c_uint,
+    refresh: bool,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer passed");
+        }
+        if callback.is_some() && interval_ms == 0 {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Zero watcher interval passed");
+        }
+
+        let mut watcher = match (*handle).watcher() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+            Ok(w) => w,
+        };
+
+        // Stop any existing watcher before starting a new one.
+        *watcher = None;
+
+        if let Some(callback) = callback {
+            *watcher = Some(Watcher::start(WatcherContext {
+                handle: handle as usize,
+                callback,
+                user_data: user_data as usize,
+                interval: Duration::from_millis(u64::from(interval_ms)),
+                refresh,
+            }));
+        }
+
+        LIBLO_OK
+    }).unwrap_or(LIBLO_ERROR_PANICKED)
+}
@@ -0,0 +1,345 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+use std::collections::HashMap;
+use std::error::Error;
+use std::ffi::CString;
+use std::panic::{catch_unwind, AssertUnwindSafe};
+use std::sync::mpsc::{channel, Sender};
+use std::sync::{Arc, Mutex};
+use std::thread::{spawn, JoinHandle};
+
+use libc::{c_uint, c_void};
+
+use super::{lo_game_handle, ERROR_MESSAGE};
+use constants::*;
+use handle::GameHandle;
+use helpers::{error, handle_error};
+
+/// A function that is called by a game handle's worker when a job started by
+/// `lo_load_current_state_async()` or `lo_save_async()` has finished. It is passed the game
+/// handle, the job's ticket, the job's return code, and the user data pointer that was given when
+/// starting the job.
+#[allow(non_camel_case_types)]
+pub type lo_completion_callback = Option<
+    unsafe extern "C" fn(
+        handle: lo_game_handle,
+        ticket: u64,
+        return_code: c_uint,
+        user_data: *mut c_void,
+    ),
+>;
+
+#[derive(Clone, Copy, Debug)]
+enum JobKind {
+    Load,
+    Save,
+}
+
+// Raw pointers can't be sent between threads, so the user data is passed to the worker's thread
+// as an integer.
+struct Job {
+    ticket: u64,
+    kind: JobKind,
+    callback: lo_completion_callback,
+    user_data: usize,
+}
+
+/// The return code and error message of a finished job.
+struct Outcome {
+    return_code: c_uint,
+    message: CString,
+}
+
+/// The jobs that have no callback, which are polled for their outcome. A job's outcome is `None`
+/// until it has finished.
+type Outcomes = Arc<Mutex<HashMap<u64, Option<Outcome>>>>;
+
+/// A background thread that runs a game handle's queued load and save jobs in the order that they
+/// were started. The thread finishes any queued jobs and stops when the worker is dropped.
+pub struct Worker {
+    job_sender: Option<Sender<Job>>,
+    thread: Option<JoinHandle<()>>,
+    next_ticket: u64,
+    outcomes: Outcomes,
+}
+
+impl Worker {
+    fn start(handle: usize) -> Worker {
+        let (job_sender, job_receiver) = channel::<Job>();
+        let outcomes = Outcomes::default();
+        let thread_outcomes = Arc::clone(&outcomes);
+
+        let thread = spawn(move || {
+            let handle = handle as lo_game_handle;
+
+            for job in job_receiver {
+                let return_code = catch_unwind(AssertUnwindSafe(|| match job.kind {
+                    JobKind::Load => load(unsafe { &*handle }),
+                    JobKind::Save => save(unsafe { &*handle }),
+                })).unwrap_or(LIBLO_ERROR_PANICKED);
+
+                match job.callback {
+                    Some(callback) => unsafe {
+                        callback(handle, job.ticket, return_code, job.user_data as *mut c_void)
+                    },
+                    None => {
+                        let message = if return_code == LIBLO_OK {
+                            CString::default()
+                        } else {
+                            ERROR_MESSAGE.with(|f| f.borrow().clone())
+                        };
+
+                        if let Ok(mut outcomes) = thread_outcomes.lock() {
+                            outcomes.insert(
+                                job.ticket,
+                                Some(Outcome {
+                                    return_code,
+                                    message,
+                                }),
+                            );
+                        }
+                    }
+                }
+            }
+        });
+
+        Worker {
+            job_sender: Some(job_sender),
+            thread: Some(thread),
+            next_ticket: 1,
+            outcomes,
+        }
+    }
+
+    fn submit(
+        &mut self,
+        kind: JobKind,
+        callback: lo_completion_callback,
+        user_data: *mut c_void,
+    ) -> Result<u64, c_uint> {
+        let ticket = self.next_ticket;
+
+        if callback.is_none() {
+            self.outcomes
+                .lock()
+                .map_err(|_| LIBLO_ERROR_POISONED_THREAD_LOCK)?
+                .insert(ticket, None);
+        }
+
+        let job = Job {
+            ticket,
+            kind,
+            callback,
+            user_data: user_data as usize,
+        };
+
+        match self.job_sender.as_ref().map(|s| s.send(job)) {
+            Some(Ok(())) => {
+                self.next_ticket += 1;
+                Ok(ticket)
+            }
+            _ => Err(LIBLO_ERROR_INTERNAL_LOGIC_ERROR),
+        }
+    }
+}
+
+impl Drop for Worker {
+    fn drop(&mut self) {
+        // Dropping the sender ends the thread's loop once it has run all the queued jobs.
+        self.job_sender = None;
+
+        if let Some(thread) = self.thread.take() {
+            let _ = thread.join();
+        }
+    }
+}
+
+/// Load the handle's state in the same way as `lo_load_current_state()`, but without holding its
+/// write lock while plugins are scanned and parsed.
+///
+/// The load order is loaded into a copy of the handle's state, which replaces the state if
+/// nothing has changed it in the meantime. Otherwise the load is repeated while holding the lock,
+/// so that a concurrent change isn't lost.
+fn load(handle: &GameHandle) -> c_uint {
+    let (shared, generation) = match handle.write() {
+        Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+        Ok(state) => state.shared_load_order(),
+    };
+
+    let mut load_order = (*shared).clone();
+    drop(shared);
+
+    if let Err(x) = load_order.load() {
+        return handle_error(x);
+    }
+
+    let mut state = match handle.write() {
+        Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+        Ok(state) => state,
+    };
+
+    if !state.replace_load_order(load_order, generation) {
+        if let Err(x) = state.load() {
+            return handle_error(x);
+        }
+    }
+
+    LIBLO_OK
+}
+
+fn save(handle: &GameHandle) -> c_uint {
+    let mut state = match handle.write() {
+        Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+        Ok(state) => state,
+    };
+
+    if let Err(x) = state.commit() {
+        return handle_error(x);
+    }
+
+    LIBLO_OK
+}
+
+unsafe fn start_job(
+    handle: lo_game_handle,
+    kind: JobKind,
+    callback: lo_completion_callback,
+    user_data: *mut c_void,
+    ticket: *mut u64,
+) -> c_uint {
+    if handle.is_null() || ticket.is_null() {
+        return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer(s) passed");
+    }
+
+    let mut worker = match (*handle).worker() {
+        Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+        Ok(w) => w,
+    };
+
+    let worker = worker.get_or_insert_with(|| Worker::start(handle as usize));
+
+    match worker.submit(kind, callback, user_data) {
+        Ok(x) => *ticket = x,
+        Err(x) => return error(x, "The handle's worker could not start the job"),
+    }
+
+    LIBLO_OK
+}
+
+/// Load the current load order state in the background.
+///
+/// Starts a job that has the same effect as `lo_load_current_state()`, and outputs a ticket that
+/// identifies it. Plugins are scanned and parsed without holding the handle's write lock, so other
+/// functions that change the handle's state are only blocked while the loaded state is applied.
+///
+/// Jobs started by this function and `lo_save_async()` are run one at a time by a worker thread
+/// that the handle starts when it is first needed, in the order that they were started. If
+/// `callback` is not null, it is called from the worker's thread when the job has finished, with
+/// the handle, the ticket, the job's return code and `user_data`. Otherwise the job's outcome can
+/// be retrieved using `lo_poll()`. The callback must not call `lo_destroy_handle()` for the same
+/// handle. Destroying the handle waits for any jobs that have been started to finish.
+///
+/// Returns `LIBLO_OK` if the job was started, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_load_current_state_async(
+    handle: lo_game_handle,
+    callback: lo_completion_callback,
+    user_data: *mut c_void,
+    ticket: *mut u64,
+) -> c_uint {
+    catch_unwind(|| start_job(handle, JobKind::Load, callback, user_data, ticket))
+        .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Save the current load order state in the background.
+///
+/// Starts a job that saves the handle's load order state, and outputs a ticket that identifies it.
+/// If a transaction is in progress when the job runs, saving commits it in the same way as
+/// `lo_commit_transaction()`, so a transaction can be used to make many changes in memory and
+/// then save them without waiting. Jobs are run and their outcomes are reported in the same way
+/// as for `lo_load_current_state_async()`.
+///
+/// Returns `LIBLO_OK` if the job was started, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_save_async(
+    handle: lo_game_handle,
+    callback: lo_completion_callback,
+    user_data: *mut c_void,
+    ticket: *mut u64,
+) -> c_uint {
+    catch_unwind(|| start_job(handle, JobKind::Save, callback, user_data, ticket))
+        .unwrap_or(LIBLO_ERROR_PANICKED)
+}
+
+/// Check whether a background job has finished.
+///
+/// `ticket` is a ticket output by `lo_load_current_state_async()` or `lo_save_async()` for a job
+/// that was started without a callback. If the job has finished, `is_finished` is set to true and
+/// `return_code` is set to the job's return code, and if the job failed, its error message is made
+/// available through `lo_get_error_message()` on the calling thread. A finished job's ticket can
+/// only be polled once. If the job has not yet finished, `is_finished` is set to false.
+///
+/// Returns `LIBLO_OK` if successful, otherwise a `LIBLO_ERROR_*` code is returned.
+#[no_mangle]
+pub unsafe extern "C" fn lo_poll(
+    handle: lo_game_handle,
+    ticket: u64,
+    is_finished: *mut bool,
+    return_code: *mut c_uint,
+) -> c_uint {
+    catch_unwind(|| {
+        if handle.is_null() || is_finished.is_null() || return_code.is_null() {
+            return error(LIBLO_ERROR_INVALID_ARGS, "Null pointer(s) passed");
+        }
+
+        let outcomes = match (*handle).worker() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+            Ok(w) => match *w {
+                Some(ref w) => Arc::clone(&w.outcomes),
+                None => return error(LIBLO_ERROR_INVALID_ARGS, "No job has the given ticket"),
+            },
+        };
+
+        let mut outcomes = match outcomes.lock() {
+            Err(e) => return error(LIBLO_ERROR_POISONED_THREAD_LOCK, e.description()),
+            Ok(o) => o,
+        };
+
+        match outcomes.get(&ticket) {
+            None => return error(LIBLO_ERROR_INVALID_ARGS, "No job has the given ticket"),
+            Some(&None) => {
+                *is_finished = false;
+                return LIBLO_OK;
+            }
+            Some(&Some(_)) => {}
+        }
+
+        if let Some(Some(outcome)) = outcomes.remove(&ticket) {
+            *is_finished = true;
+            *return_code = outcome.return_code;
+
+            if outcome.return_code != LIBLO_OK {
+                ERROR_MESSAGE.with(|f| *f.borrow_mut() = outcome.message);
+            }
+        }
+
+        LIBLO_OK
+    }).unwrap_or(LIBLO_ERROR_PANICKED)
+}
@@ -101,6 +101,34 @@ void test_lo_create_handle() {
   lo_destroy_handle(handle);
 }
 
+void test_lo_create_handle_with_options() {
+  printf("testing lo_create_handle_with_options()...\n");
+  lo_game_handle handles[2] = { NULL, NULL };
+  for (int i = 0; i < 2; ++i) {
+    unsigned int return_code = lo_create_handle_with_options(&handles[i],
+      LIBLO_GAME_TES4,
+      "../../testing-plugins/Oblivion",
+      "../../testing-plugins/Oblivion",
+      LIBLO_HANDLE_SHARED_PLUGIN_CACHE);
+    assert(return_code == 0);
+
+    return_code = lo_load_current_state(handles[i]);
+    assert(return_code == 0);
+  }
+
+  size_t num_plugins[2];
+  for (int i = 0; i < 2; ++i) {
+    char ** plugins;
+    unsigned int return_code = lo_get_load_order(handles[i], &plugins, &num_plugins[i]);
+    assert(return_code == 0);
+    lo_free_string_array(plugins, num_plugins[i]);
+  }
+  assert(num_plugins[0] == num_plugins[1]);
+
+  lo_destroy_handle(handles[0]);
+  lo_destroy_handle(handles[1]);
+}
+
 void test_lo_fix_plugin_lists() {
   printf("testing lo_fix_plugin_list()...\n");
   lo_game_handle handle = create_handle();
@@ -110,6 +138,123 @@ void test_lo_fix_plugin_lists() {
   lo_destroy_handle(handle);
 }
 
+void test_lo_refresh_current_state() {
+  printf("testing lo_refresh_current_state()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_refresh_current_state(handle);
+  assert(return_code == 0);
+
+  lo_destroy_handle(handle);
+}
+
+void test_lo_set_cache_path() {
+  printf("testing lo_set_cache_path()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_set_cache_path(handle, "plugins.cache");
+  assert(return_code == 0);
+
+  return_code = lo_load_current_state(handle);
+  assert(return_code == 0);
+
+  return_code = lo_set_cache_path(handle, NULL);
+  assert(return_code == 0);
+
+  lo_destroy_handle(handle);
+  remove("plugins.cache");
+}
+
+void test_lo_set_write_durability() {
+  printf("testing lo_set_write_durability()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_set_write_durability(handle, LIBLO_DURABILITY_SYNC_FILE);
+  assert(return_code == 0);
+
+  return_code = lo_set_plugin_active(handle, "Blank.esm", true);
+  assert(return_code == 0);
+
+  return_code = lo_set_write_durability(handle, 100);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  lo_destroy_handle(handle);
+}
+
+void test_lo_set_io_concurrency() {
+  printf("testing lo_set_io_concurrency()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_set_io_concurrency(handle, 2);
+  assert(return_code == 0);
+
+  return_code = lo_load_current_state(handle);
+  assert(return_code == 0);
+
+  lo_destroy_handle(handle);
+}
+
+void test_lo_set_thread_count() {
+  printf("testing lo_set_thread_count()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_set_thread_count(handle, 2);
+  assert(return_code == 0);
+
+  return_code = lo_set_sequential_threshold(handle, 1);
+  assert(return_code == 0);
+
+  return_code = lo_load_current_state(handle);
+  assert(return_code == 0);
+
+  return_code = lo_set_thread_count(handle, 0);
+  assert(return_code == 0);
+
+  return_code = lo_set_thread_count(NULL, 2);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  lo_destroy_handle(handle);
+}
+
+void test_lo_get_metrics() {
+  printf("testing lo_get_metrics()...\n");
+  lo_game_handle handle = create_handle();
+
+  lo_metrics metrics;
+  unsigned int return_code = lo_get_metrics(handle, &metrics);
+  assert(return_code == 0);
+  assert(metrics.load.calls == 0);
+
+  return_code = lo_set_metrics_enabled(handle, true);
+  assert(return_code == 0);
+
+  return_code = lo_load_current_state(handle);
+  assert(return_code == 0);
+
+  return_code = lo_get_metrics(handle, &metrics);
+  assert(return_code == 0);
+  assert(metrics.load.calls == 1);
+  assert(metrics.find_plugins.calls == 1);
+  assert(metrics.load.total_ns >= metrics.find_plugins.total_ns);
+  assert(metrics.plugin_files_scanned > 0);
+  assert(metrics.plugin_headers_parsed + metrics.plugin_headers_reused > 0);
+  assert(metrics.file_opens > 0);
+  assert(metrics.file_stats >= metrics.plugin_files_scanned);
+  assert(metrics.lock_wait.calls > 0);
+
+  return_code = lo_set_metrics_enabled(handle, false);
+  assert(return_code == 0);
+
+  return_code = lo_get_metrics(handle, &metrics);
+  assert(return_code == 0);
+  assert(metrics.load.calls == 0);
+
+  return_code = lo_get_metrics(handle, NULL);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  lo_destroy_handle(handle);
+}
+
 void test_lo_get_implicitly_active_plugins() {
   printf("testing lo_get_load_order()...\n");
   lo_game_handle handle = create_fo4_handle();
@@ -152,6 +297,20 @@ void test_lo_get_active_plugins() {
   lo_destroy_handle(handle);
 }
 
+void test_lo_get_active_plugins_view() {
+  printf("testing lo_get_active_plugins_view()...\n");
+  lo_game_handle handle = create_handle();
+
+  const char * const * plugins = NULL;
+  size_t num_plugins = 0;
+  unsigned int return_code = lo_get_active_plugins_view(handle, &plugins, &num_plugins);
+
+  assert(return_code == 0);
+  assert(num_plugins == 1);
+  assert(strcmp(plugins[0], "Blank.esm") == 0);
+  lo_destroy_handle(handle);
+}
+
 void test_lo_set_plugin_active() {
   printf("testing lo_set_plugin_active()...\n");
   lo_game_handle handle = create_handle();
@@ -209,6 +368,52 @@ void test_lo_set_load_order() {
   lo_destroy_handle(handle);
 }
 
+void test_lo_validate_load_order() {
+  printf("testing lo_validate_load_order()...\n");
+  lo_game_handle handle = create_handle();
+
+  char ** plugins = NULL;
+  size_t num_plugins = 0;
+  unsigned int return_code = lo_get_load_order(handle, &plugins, &num_plugins);
+  assert(return_code == 0);
+
+  lo_load_order_violation * violations = NULL;
+  size_t num_violations = 0;
+  return_code = lo_validate_load_order(handle, (const char * const *)plugins, num_plugins,
+                                       &violations, &num_violations);
+  assert(return_code == 0);
+  assert(violations == NULL);
+  assert(num_violations == 0);
+  lo_free_string_array(plugins, num_plugins);
+
+  const char * invalid_plugins[] = {
+    "Blank.esp",
+    "Blank.esm",
+    "blank.esp",
+    "missing.esp"
+  };
+  return_code = lo_validate_load_order(handle, invalid_plugins, 4, &violations, &num_violations);
+  assert(return_code == 0);
+  assert(num_violations == 3);
+  assert(violations[0].kind == LIBLO_VIOLATION_NON_MASTER_BEFORE_MASTER);
+  assert(violations[0].index == 1);
+  assert(violations[1].kind == LIBLO_VIOLATION_DUPLICATE_PLUGIN);
+  assert(violations[1].index == 2);
+  assert(violations[2].kind == LIBLO_VIOLATION_UNKNOWN_PLUGIN);
+  assert(violations[2].index == 3);
+  lo_free_load_order_violations(violations, num_violations);
+
+  return_code = lo_get_load_order(handle, &plugins, &num_plugins);
+  assert(return_code == 0);
+  assert(strcmp(plugins[0], "Blank.esm") == 0);
+  lo_free_string_array(plugins, num_plugins);
+
+  return_code = lo_validate_load_order(handle, invalid_plugins, 4, NULL, &num_violations);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  lo_destroy_handle(handle);
+}
+
 void test_lo_get_load_order() {
   printf("testing lo_get_load_order()...\n");
   lo_game_handle handle = create_handle();
@@ -225,6 +430,182 @@ void test_lo_get_load_order() {
   lo_destroy_handle(handle);
 }
 
+void test_lo_get_load_order_state() {
+  printf("testing lo_get_load_order_state()...\n");
+  lo_game_handle handle = create_handle();
+
+  lo_plugin_state * states = NULL;
+  size_t num_states = 0;
+  unsigned int return_code = lo_get_load_order_state(handle, &states, &num_states);
+
+  assert(return_code == 0);
+  assert(num_states == 10);
+  assert(strcmp(states[0].name, "Blank.esm") == 0);
+  assert(states[0].flags & LIBLO_PLUGIN_MASTER);
+  assert(!(states[0].flags & LIBLO_PLUGIN_LIGHT_MASTER));
+  assert(strcmp(states[4].name, "Blank.esp") == 0);
+  assert(!(states[4].flags & LIBLO_PLUGIN_MASTER));
+
+  for (size_t i = 0; i < num_states; ++i) {
+    bool is_active = false;
+    return_code = lo_get_plugin_active(handle, states[i].name, &is_active);
+    assert(return_code == 0);
+    assert(is_active == ((states[i].flags & LIBLO_PLUGIN_ACTIVE) != 0));
+  }
+
+  lo_free_load_order_state(states, num_states);
+
+  return_code = lo_get_load_order_state(handle, NULL, &num_states);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  lo_destroy_handle(handle);
+}
+
+void test_lo_get_load_order_view() {
+  printf("testing lo_get_load_order_view()...\n");
+  lo_game_handle handle = create_handle();
+
+  const char * const * plugins = NULL;
+  size_t num_plugins = 0;
+  unsigned int return_code = lo_get_load_order_view(handle, &plugins, &num_plugins);
+
+  assert(return_code == 0);
+  assert(num_plugins == 10);
+  assert(strcmp(plugins[0], "Blank.esm") == 0);
+  assert(strcmp(plugins[4], "Blank.esp") == 0);
+
+  const char * const * unchanged_plugins = NULL;
+  return_code = lo_get_load_order_view(handle, &unchanged_plugins, &num_plugins);
+
+  assert(return_code == 0);
+  assert(unchanged_plugins == plugins);
+
+  return_code = lo_load_current_state(handle);
+  assert(return_code == 0);
+
+  assert(strcmp(plugins[0], "Blank.esm") == 0);
+  assert(strcmp(plugins[4], "Blank.esp") == 0);
+
+  const char * const * reloaded_plugins = NULL;
+  return_code = lo_get_load_order_view(handle, &reloaded_plugins, &num_plugins);
+
+  assert(return_code == 0);
+  assert(num_plugins == 10);
+  assert(strcmp(reloaded_plugins[0], "Blank.esm") == 0);
+  lo_destroy_handle(handle);
+}
+
+void test_lo_get_generation() {
+  printf("testing lo_get_generation()...\n");
+  lo_game_handle handle = create_handle();
+
+  uint64_t generation = 0;
+  unsigned int return_code = lo_get_generation(handle, &generation);
+  assert(return_code == 0);
+
+  uint64_t unchanged_generation = 0;
+  return_code = lo_get_generation(handle, &unchanged_generation);
+  assert(return_code == 0);
+  assert(unchanged_generation == generation);
+
+  return_code = lo_load_current_state(handle);
+  assert(return_code == 0);
+
+  uint64_t new_generation = 0;
+  return_code = lo_get_generation(handle, &new_generation);
+  assert(return_code == 0);
+  assert(new_generation != generation);
+  lo_destroy_handle(handle);
+}
+
+void test_lo_is_stale() {
+  printf("testing lo_is_stale()...\n");
+  lo_game_handle handle = create_handle();
+
+  bool is_stale = true;
+  unsigned int return_code = lo_is_stale(handle, &is_stale);
+  assert(return_code == 0);
+  assert(!is_stale);
+
+  FILE * file = fopen("../../testing-plugins/Oblivion/Data/stale.txt", "w");
+  assert(file != NULL);
+  fclose(file);
+  remove("../../testing-plugins/Oblivion/Data/stale.txt");
+
+  return_code = lo_is_stale(handle, &is_stale);
+  assert(return_code == 0);
+  assert(is_stale);
+  lo_destroy_handle(handle);
+}
+
+void on_change(lo_game_handle handle, void * user_data) {}
+
+void test_lo_set_change_callback() {
+  printf("testing lo_set_change_callback()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_set_change_callback(handle, on_change, NULL, 0, false);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  return_code = lo_set_change_callback(handle, on_change, NULL, 10, false);
+  assert(return_code == 0);
+
+  return_code = lo_set_change_callback(handle, NULL, NULL, 0, false);
+  assert(return_code == 0);
+
+  return_code = lo_set_change_callback(handle, on_change, NULL, 10, true);
+  assert(return_code == 0);
+  lo_destroy_handle(handle);
+}
+
+void test_lo_load_current_state_async() {
+  printf("testing lo_load_current_state_async()...\n");
+  lo_game_handle handle = create_handle();
+
+  uint64_t ticket = 0;
+  unsigned int return_code = lo_load_current_state_async(handle, NULL, NULL, NULL);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  return_code = lo_load_current_state_async(handle, NULL, NULL, &ticket);
+  assert(return_code == 0);
+
+  bool is_finished = false;
+  unsigned int job_return_code = LIBLO_ERROR_INTERNAL_LOGIC_ERROR;
+  while (!is_finished) {
+    return_code = lo_poll(handle, ticket, &is_finished, &job_return_code);
+    assert(return_code == 0);
+  }
+  assert(job_return_code == 0);
+
+  return_code = lo_poll(handle, ticket, &is_finished, &job_return_code);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+  lo_destroy_handle(handle);
+}
+
+void test_lo_save_async() {
+  printf("testing lo_save_async()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_begin_transaction(handle);
+  assert(return_code == 0);
+
+  uint64_t ticket = 0;
+  return_code = lo_save_async(handle, NULL, NULL, &ticket);
+  assert(return_code == 0);
+
+  bool is_finished = false;
+  unsigned int job_return_code = LIBLO_ERROR_INTERNAL_LOGIC_ERROR;
+  while (!is_finished) {
+    return_code = lo_poll(handle, ticket, &is_finished, &job_return_code);
+    assert(return_code == 0);
+  }
+  assert(job_return_code == 0);
+
+  return_code = lo_commit_transaction(handle);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+  lo_destroy_handle(handle);
+}
+
 void test_lo_set_plugin_position() {
   printf("testing lo_set_plugin_position()...\n");
   lo_game_handle handle = create_handle();
@@ -260,6 +641,148 @@ void test_lo_get_indexed_plugin() {
   lo_destroy_handle(handle);
 }
 
+void test_lo_get_pending_changes() {
+  printf("testing lo_get_pending_changes()...\n");
+  lo_game_handle handle = create_handle();
+
+  lo_plugin_change * changes = NULL;
+  size_t num_changes = 0;
+  unsigned int return_code = lo_get_pending_changes(handle, &changes, &num_changes);
+  assert(return_code == 0);
+  assert(changes == NULL);
+  assert(num_changes == 0);
+
+  return_code = lo_begin_transaction(handle);
+  assert(return_code == 0);
+
+  return_code = lo_set_plugin_position(handle, "Blank.esp", 100);
+  assert(return_code == 0);
+
+  return_code = lo_get_pending_changes(handle, &changes, &num_changes);
+  assert(return_code == 0);
+  assert(num_changes == 1);
+  assert(strcmp(changes[0].name, "Blank.esp") == 0);
+  assert(changes[0].flags == LIBLO_CHANGE_MOVED);
+  lo_free_pending_changes(changes, num_changes);
+
+  return_code = lo_abort_transaction(handle);
+  assert(return_code == 0);
+
+  return_code = lo_get_pending_changes(handle, &changes, &num_changes);
+  assert(return_code == 0);
+  assert(num_changes == 0);
+
+  return_code = lo_get_pending_changes(handle, NULL, &num_changes);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  lo_destroy_handle(handle);
+}
+
+void test_lo_begin_transaction() {
+  printf("testing lo_begin_transaction()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_begin_transaction(handle);
+  assert(return_code == 0);
+
+  return_code = lo_begin_transaction(handle);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  return_code = lo_abort_transaction(handle);
+  assert(return_code == 0);
+
+  lo_destroy_handle(handle);
+}
+
+void test_lo_commit_transaction() {
+  printf("testing lo_commit_transaction()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_commit_transaction(handle);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  return_code = lo_begin_transaction(handle);
+  assert(return_code == 0);
+
+  return_code = lo_set_plugin_position(handle, "Blank.esp", 100);
+  assert(return_code == 0);
+
+  return_code = lo_commit_transaction(handle);
+  assert(return_code == 0);
+  lo_destroy_handle(handle);
+
+  handle = create_handle();
+
+  size_t position = 0;
+  return_code = lo_get_plugin_position(handle, "Blank.esp", &position);
+  assert(return_code == 0);
+  assert(position > 7);
+
+  return_code = lo_set_plugin_position(handle, "Blank.esp", 7);
+  assert(return_code == 0);
+  lo_destroy_handle(handle);
+}
+
+void test_lo_abort_transaction() {
+  printf("testing lo_abort_transaction()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_abort_transaction(handle);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  return_code = lo_begin_transaction(handle);
+  assert(return_code == 0);
+
+  return_code = lo_set_plugin_position(handle, "Blank.esp", 100);
+  assert(return_code == 0);
+
+  return_code = lo_abort_transaction(handle);
+  assert(return_code == 0);
+
+  size_t position = 0;
+  return_code = lo_get_plugin_position(handle, "Blank.esp", &position);
+  assert(return_code == 0);
+  assert(position == 7);
+  lo_destroy_handle(handle);
+}
+
+void test_lo_abort_transaction_should_ghost_plugins_unghosted_during_it() {
+  printf("testing lo_abort_transaction() with a ghosted plugin...\n");
+  const char * path = "../../testing-plugins/Oblivion/Data/Blank - Different.esp";
+  const char * ghosted_path = "../../testing-plugins/Oblivion/Data/Blank - Different.esp.ghost";
+  int result = rename(path, ghosted_path);
+  assert(result == 0);
+
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_begin_transaction(handle);
+  assert(return_code == 0);
+
+  return_code = lo_set_plugin_active(handle, "Blank - Different.esp", true);
+  assert(return_code == 0);
+
+  FILE * file = fopen(path, "rb");
+  assert(file != NULL);
+  fclose(file);
+
+  return_code = lo_abort_transaction(handle);
+  assert(return_code == 0);
+
+  bool is_active = true;
+  return_code = lo_get_plugin_active(handle, "Blank - Different.esp", &is_active);
+  assert(return_code == 0);
+  assert(!is_active);
+
+  file = fopen(ghosted_path, "rb");
+  assert(file != NULL);
+  fclose(file);
+
+  lo_destroy_handle(handle);
+
+  result = rename(ghosted_path, path);
+  assert(result == 0);
+}
+
 int main(void) {
   test_game_id_values();
 
@@ -268,21 +791,43 @@ int main(void) {
   test_lo_free_string_array();
 
   test_lo_create_handle();
+  test_lo_create_handle_with_options();
   test_lo_fix_plugin_lists();
+  test_lo_refresh_current_state();
+  test_lo_set_cache_path();
+  test_lo_set_write_durability();
+  test_lo_set_io_concurrency();
+  test_lo_set_thread_count();
+  test_lo_get_metrics();
   test_lo_get_implicitly_active_plugins();
 
   test_lo_set_active_plugins();
   test_lo_get_active_plugins();
+  test_lo_get_active_plugins_view();
   test_lo_set_plugin_active();
   test_lo_get_plugin_active();
 
   test_lo_get_load_order_method();
   test_lo_set_load_order();
+  test_lo_validate_load_order();
   test_lo_get_load_order();
+  test_lo_get_load_order_state();
+  test_lo_get_load_order_view();
+  test_lo_get_generation();
+  test_lo_is_stale();
+  test_lo_set_change_callback();
+  test_lo_load_current_state_async();
+  test_lo_save_async();
   test_lo_set_plugin_position();
   test_lo_get_plugin_position();
   test_lo_get_indexed_plugin();
 
+  test_lo_begin_transaction();
+  test_lo_get_pending_changes();
+  test_lo_commit_transaction();
+  test_lo_abort_transaction();
+  test_lo_abort_transaction_should_ghost_plugins_unghosted_during_it();
+
   remove("testing-plugins/Oblivion/plugins.txt");
   printf("SUCCESS\n");
   return 0;
@@ -1,10 +1,13 @@
+#include <atomic>
 #include <cassert>
 #include <cstdbool>
 #include <cstdio>
 #include <cstdint>
 #include <cstring>
 
+#include <chrono>
 #include <thread>
+#include <utility>
 #include <vector>
 
 #include "libloadorder.hpp"
@@ -104,6 +107,34 @@ void test_lo_create_handle() {
   lo_destroy_handle(handle);
 }
 
+void test_lo_create_handle_with_options() {
+  printf("testing lo_create_handle_with_options()...\n");
+  lo_game_handle handles[2] = { nullptr, nullptr };
+  for (int i = 0; i < 2; ++i) {
+    unsigned int return_code = lo_create_handle_with_options(&handles[i],
+      LIBLO_GAME_TES4,
+      "../../testing-plugins/Oblivion",
+      "../../testing-plugins/Oblivion",
+      LIBLO_HANDLE_SHARED_PLUGIN_CACHE);
+    assert(return_code == 0);
+
+    return_code = lo_load_current_state(handles[i]);
+    assert(return_code == 0);
+  }
+
+  size_t num_plugins[2];
+  for (int i = 0; i < 2; ++i) {
+    char ** plugins;
+    unsigned int return_code = lo_get_load_order(handles[i], &plugins, &num_plugins[i]);
+    assert(return_code == 0);
+    lo_free_string_array(plugins, num_plugins[i]);
+  }
+  assert(num_plugins[0] == num_plugins[1]);
+
+  lo_destroy_handle(handles[0]);
+  lo_destroy_handle(handles[1]);
+}
+
 void test_lo_fix_plugin_lists() {
   printf("testing lo_fix_plugin_list()...\n");
   lo_game_handle handle = create_handle();
@@ -113,6 +144,115 @@ void test_lo_fix_plugin_lists() {
   lo_destroy_handle(handle);
 }
 
+void test_lo_refresh_current_state() {
+  printf("testing lo_refresh_current_state()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_refresh_current_state(handle);
+  assert(return_code == 0);
+
+  lo_destroy_handle(handle);
+}
+
+void test_lo_set_cache_path() {
+  printf("testing lo_set_cache_path()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_set_cache_path(handle, "plugins.cache");
+  assert(return_code == 0);
+
+  return_code = lo_load_current_state(handle);
+  assert(return_code == 0);
+
+  return_code = lo_set_cache_path(handle, nullptr);
+  assert(return_code == 0);
+
+  lo_destroy_handle(handle);
+  remove("plugins.cache");
+}
+
+void test_lo_set_write_durability() {
+  printf("testing lo_set_write_durability()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_set_write_durability(handle, LIBLO_DURABILITY_SYNC_FILE);
+  assert(return_code == 0);
+
+  return_code = lo_set_plugin_active(handle, "Blank.esm", true);
+  assert(return_code == 0);
+
+  return_code = lo_set_write_durability(handle, 100);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  lo_destroy_handle(handle);
+}
+
+void test_lo_set_io_concurrency() {
+  printf("testing lo_set_io_concurrency()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_set_io_concurrency(handle, 2);
+  assert(return_code == 0);
+
+  return_code = lo_load_current_state(handle);
+  assert(return_code == 0);
+
+  lo_destroy_handle(handle);
+}
+
+void test_lo_set_thread_count() {
+  printf("testing lo_set_thread_count()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_set_thread_count(handle, 2);
+  assert(return_code == 0);
+
+  return_code = lo_set_sequential_threshold(handle, 1);
+  assert(return_code == 0);
+
+  return_code = lo_load_current_state(handle);
+  assert(return_code == 0);
+
+  return_code = lo_set_thread_count(handle, 0);
+  assert(return_code == 0);
+
+  return_code = lo_set_thread_count(nullptr, 2);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  lo_destroy_handle(handle);
+}
+
+void test_lo_get_metrics() {
+  printf("testing lo_get_metrics()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_set_metrics_enabled(handle, true);
+  assert(return_code == 0);
+
+  return_code = lo_load_current_state(handle);
+  assert(return_code == 0);
+
+  lo_metrics metrics;
+  return_code = lo_get_metrics(handle, &metrics);
+  assert(return_code == 0);
+  assert(metrics.load.calls == 1);
+  assert(metrics.plugin_headers_parsed > 0);
+  assert(metrics.file_reads >= metrics.plugin_headers_parsed);
+
+  uint64_t parsed_count = metrics.plugin_headers_parsed;
+
+  return_code = lo_refresh_current_state(handle);
+  assert(return_code == 0);
+
+  return_code = lo_get_metrics(handle, &metrics);
+  assert(return_code == 0);
+  assert(metrics.load.calls == 2);
+  assert(metrics.plugin_headers_parsed == parsed_count);
+  assert(metrics.plugin_headers_reused > 0);
+
+  lo_destroy_handle(handle);
+}
+
 void test_lo_get_implicitly_active_plugins() {
   printf("testing lo_get_load_order()...\n");
   lo_game_handle handle = create_fo4_handle();
@@ -155,6 +295,20 @@ void test_lo_get_active_plugins() {
   lo_destroy_handle(handle);
 }
 
+void test_lo_get_active_plugins_view() {
+  printf("testing lo_get_active_plugins_view()...\n");
+  lo_game_handle handle = create_handle();
+
+  const char * const * plugins = nullptr;
+  size_t num_plugins = 0;
+  unsigned int return_code = lo_get_active_plugins_view(handle, &plugins, &num_plugins);
+
+  assert(return_code == 0);
+  assert(num_plugins == 1);
+  assert(strcmp(plugins[0], "Blank.esm") == 0);
+  lo_destroy_handle(handle);
+}
+
 void test_lo_set_plugin_active() {
   printf("testing lo_set_plugin_active()...\n");
   lo_game_handle handle = create_handle();
@@ -212,6 +366,52 @@ void test_lo_set_load_order() {
   lo_destroy_handle(handle);
 }
 
+void test_lo_validate_load_order() {
+  printf("testing lo_validate_load_order()...\n");
+  lo_game_handle handle = create_handle();
+
+  char ** plugins = nullptr;
+  size_t num_plugins = 0;
+  unsigned int return_code = lo_get_load_order(handle, &plugins, &num_plugins);
+  assert(return_code == 0);
+
+  lo_load_order_violation * violations = nullptr;
+  size_t num_violations = 0;
+  return_code = lo_validate_load_order(handle, plugins, num_plugins,
+                                       &violations, &num_violations);
+  assert(return_code == 0);
+  assert(violations == nullptr);
+  assert(num_violations == 0);
+  lo_free_string_array(plugins, num_plugins);
+
+  const char * invalid_plugins[] = {
+    "Blank.esp",
+    "Blank.esm",
+    "blank.esp",
+    "missing.esp"
+  };
+  return_code = lo_validate_load_order(handle, invalid_plugins, 4, &violations, &num_violations);
+  assert(return_code == 0);
+  assert(num_violations == 3);
+  assert(violations[0].kind == LIBLO_VIOLATION_NON_MASTER_BEFORE_MASTER);
+  assert(violations[0].index == 1);
+  assert(violations[1].kind == LIBLO_VIOLATION_DUPLICATE_PLUGIN);
+  assert(violations[1].index == 2);
+  assert(violations[2].kind == LIBLO_VIOLATION_UNKNOWN_PLUGIN);
+  assert(violations[2].index == 3);
+  lo_free_load_order_violations(violations, num_violations);
+
+  return_code = lo_get_load_order(handle, &plugins, &num_plugins);
+  assert(return_code == 0);
+  assert(strcmp(plugins[0], "Blank.esm") == 0);
+  lo_free_string_array(plugins, num_plugins);
+
+  return_code = lo_validate_load_order(handle, invalid_plugins, 4, nullptr, &num_violations);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  lo_destroy_handle(handle);
+}
+
 void test_lo_get_load_order() {
   printf("testing lo_get_load_order()...\n");
   lo_game_handle handle = create_handle();
@@ -228,6 +428,208 @@ void test_lo_get_load_order() {
   lo_destroy_handle(handle);
 }
 
+void test_lo_get_load_order_state() {
+  printf("testing lo_get_load_order_state()...\n");
+  lo_game_handle handle = create_handle();
+
+  loadorder::LoadOrderState state;
+  assert(state.empty());
+
+  unsigned int return_code = state.load(handle);
+  assert(return_code == 0);
+  assert(state.size() == 10);
+  assert(strcmp(state[0].name, "Blank.esm") == 0);
+  assert(state[0].flags & LIBLO_PLUGIN_MASTER);
+
+  char ** plugins = nullptr;
+  size_t num_plugins = 0;
+  return_code = lo_get_load_order(handle, &plugins, &num_plugins);
+  assert(return_code == 0);
+
+  size_t i = 0;
+  for (const lo_plugin_state& plugin : state) {
+    assert(strcmp(plugin.name, plugins[i]) == 0);
+    ++i;
+  }
+  assert(i == num_plugins);
+  lo_free_string_array(plugins, num_plugins);
+
+  loadorder::LoadOrderState moved(std::move(state));
+  assert(state.empty());
+  assert(moved.size() == 10);
+
+  lo_destroy_handle(handle);
+}
+
+void test_lo_get_load_order_view() {
+  printf("testing lo_get_load_order_view()...\n");
+  lo_game_handle handle = create_handle();
+
+  const char * const * plugins = nullptr;
+  size_t num_plugins = 0;
+  unsigned int return_code = lo_get_load_order_view(handle, &plugins, &num_plugins);
+
+  assert(return_code == 0);
+  assert(num_plugins == 10);
+  assert(strcmp(plugins[0], "Blank.esm") == 0);
+  assert(strcmp(plugins[4], "Blank.esp") == 0);
+
+  const char * const * unchanged_plugins = nullptr;
+  return_code = lo_get_load_order_view(handle, &unchanged_plugins, &num_plugins);
+
+  assert(return_code == 0);
+  assert(unchanged_plugins == plugins);
+
+  return_code = lo_load_current_state(handle);
+  assert(return_code == 0);
+
+  assert(strcmp(plugins[0], "Blank.esm") == 0);
+  assert(strcmp(plugins[4], "Blank.esp") == 0);
+
+  const char * const * reloaded_plugins = nullptr;
+  return_code = lo_get_load_order_view(handle, &reloaded_plugins, &num_plugins);
+
+  assert(return_code == 0);
+  assert(num_plugins == 10);
+  assert(strcmp(reloaded_plugins[0], "Blank.esm") == 0);
+  lo_destroy_handle(handle);
+}
+
+void test_lo_get_generation() {
+  printf("testing lo_get_generation()...\n");
+  lo_game_handle handle = create_handle();
+
+  uint64_t generation = 0;
+  unsigned int return_code = lo_get_generation(handle, &generation);
+  assert(return_code == 0);
+
+  uint64_t unchanged_generation = 0;
+  return_code = lo_get_generation(handle, &unchanged_generation);
+  assert(return_code == 0);
+  assert(unchanged_generation == generation);
+
+  return_code = lo_load_current_state(handle);
+  assert(return_code == 0);
+
+  uint64_t new_generation = 0;
+  return_code = lo_get_generation(handle, &new_generation);
+  assert(return_code == 0);
+  assert(new_generation != generation);
+  lo_destroy_handle(handle);
+}
+
+void test_lo_is_stale() {
+  printf("testing lo_is_stale()...\n");
+  lo_game_handle handle = create_handle();
+
+  bool is_stale = true;
+  unsigned int return_code = lo_is_stale(handle, &is_stale);
+  assert(return_code == 0);
+  assert(!is_stale);
+
+  FILE * file = fopen("../../testing-plugins/Oblivion/Data/stale.txt", "w");
+  assert(file != nullptr);
+  fclose(file);
+  remove("../../testing-plugins/Oblivion/Data/stale.txt");
+
+  return_code = lo_is_stale(handle, &is_stale);
+  assert(return_code == 0);
+  assert(is_stale);
+  lo_destroy_handle(handle);
+}
+
+void on_change(lo_game_handle handle, void * user_data) {
+  static_cast<std::atomic<bool>*>(user_data)->store(true);
+}
+
+void test_lo_set_change_callback() {
+  printf("testing lo_set_change_callback()...\n");
+  lo_game_handle handle = create_handle();
+
+  std::atomic<bool> changed(false);
+  unsigned int return_code = lo_set_change_callback(handle, on_change, &changed, 0, false);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  return_code = lo_set_change_callback(handle, on_change, &changed, 10, false);
+  assert(return_code == 0);
+
+  FILE * file = fopen("../../testing-plugins/Oblivion/Data/stale.txt", "w");
+  assert(file != nullptr);
+  fclose(file);
+  remove("../../testing-plugins/Oblivion/Data/stale.txt");
+
+  for (int i = 0; i < 500 && !changed.load(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  assert(changed.load());
+
+  return_code = lo_set_change_callback(handle, nullptr, nullptr, 0, false);
+  assert(return_code == 0);
+  lo_destroy_handle(handle);
+}
+
+void on_completion(lo_game_handle handle, uint64_t ticket, unsigned int return_code, void * user_data) {
+  static_cast<std::atomic<unsigned int>*>(user_data)->store(return_code);
+}
+
+void test_lo_load_current_state_async() {
+  printf("testing lo_load_current_state_async()...\n");
+  lo_game_handle handle = create_handle();
+
+  uint64_t ticket = 0;
+  unsigned int return_code = lo_load_current_state_async(handle, nullptr, nullptr, nullptr);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  std::atomic<unsigned int> job_return_code(LIBLO_ERROR_INTERNAL_LOGIC_ERROR);
+  return_code = lo_load_current_state_async(handle, on_completion, &job_return_code, &ticket);
+  assert(return_code == 0);
+
+  for (int i = 0; i < 500 && job_return_code.load() != 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  assert(job_return_code.load() == 0);
+
+  bool is_finished = false;
+  unsigned int polled_return_code = 0;
+  return_code = lo_poll(handle, ticket, &is_finished, &polled_return_code);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+  lo_destroy_handle(handle);
+}
+
+void test_lo_save_async() {
+  printf("testing lo_save_async()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_begin_transaction(handle);
+  assert(return_code == 0);
+
+  return_code = lo_set_plugin_position(handle, "Blank.esp", 5);
+  assert(return_code == 0);
+
+  uint64_t ticket = 0;
+  return_code = lo_save_async(handle, nullptr, nullptr, &ticket);
+  assert(return_code == 0);
+
+  bool is_finished = false;
+  unsigned int job_return_code = LIBLO_ERROR_INTERNAL_LOGIC_ERROR;
+  while (!is_finished) {
+    return_code = lo_poll(handle, ticket, &is_finished, &job_return_code);
+    assert(return_code == 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  assert(job_return_code == 0);
+
+  lo_plugin_change * changes = nullptr;
+  size_t num_changes = 0;
+  return_code = lo_get_pending_changes(handle, &changes, &num_changes);
+  assert(return_code == 0);
+  assert(num_changes == 0);
+
+  return_code = lo_commit_transaction(handle);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+  lo_destroy_handle(handle);
+}
+
 void test_lo_set_plugin_position() {
   printf("testing lo_set_plugin_position()...\n");
   lo_game_handle handle = create_handle();
@@ -285,6 +687,155 @@ void test_thread_safety() {
   lo_destroy_handle(handle);
 }
 
+void test_concurrent_reads_and_writes() {
+  printf("testing concurrent reads and writes...\n");
+  lo_game_handle handle = create_handle();
+
+  char ** plugins;
+  size_t num_plugins;
+  unsigned int return_code = lo_get_load_order(handle, &plugins, &num_plugins);
+  assert(return_code == 0);
+  lo_free_string_array(plugins, num_plugins);
+  const size_t expected_num_plugins = num_plugins;
+
+  std::atomic<bool> done(false);
+  std::thread writer([&](){
+    for (int i = 0; i < 20; ++i) {
+      unsigned int return_code = lo_load_current_state(handle);
+      assert(return_code == 0);
+    }
+    done.store(true);
+  });
+
+  // Readers see the last published load order while the writer reloads it.
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.push_back(std::thread([&](){
+      while (!done.load()) {
+        char ** plugins;
+        size_t num_plugins;
+        unsigned int return_code = lo_get_load_order(handle, &plugins, &num_plugins);
+
+        assert(return_code == 0);
+        assert(num_plugins == expected_num_plugins);
+        lo_free_string_array(plugins, num_plugins);
+      }
+    }));
+  }
+
+  writer.join();
+  for (auto& thread : readers) {
+    thread.join();
+  }
+
+  lo_destroy_handle(handle);
+}
+
+void test_lo_get_pending_changes() {
+  printf("testing lo_get_pending_changes()...\n");
+  lo_game_handle handle = create_handle();
+
+  lo_plugin_change * changes = nullptr;
+  size_t num_changes = 0;
+  unsigned int return_code = lo_get_pending_changes(handle, &changes, &num_changes);
+  assert(return_code == 0);
+  assert(changes == nullptr);
+  assert(num_changes == 0);
+
+  return_code = lo_begin_transaction(handle);
+  assert(return_code == 0);
+
+  return_code = lo_set_plugin_position(handle, "Blank.esp", 100);
+  assert(return_code == 0);
+
+  return_code = lo_get_pending_changes(handle, &changes, &num_changes);
+  assert(return_code == 0);
+  assert(num_changes == 1);
+  assert(strcmp(changes[0].name, "Blank.esp") == 0);
+  assert(changes[0].flags == LIBLO_CHANGE_MOVED);
+  lo_free_pending_changes(changes, num_changes);
+
+  return_code = lo_abort_transaction(handle);
+  assert(return_code == 0);
+
+  return_code = lo_get_pending_changes(handle, &changes, &num_changes);
+  assert(return_code == 0);
+  assert(num_changes == 0);
+
+  return_code = lo_get_pending_changes(handle, nullptr, &num_changes);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  lo_destroy_handle(handle);
+}
+
+void test_lo_begin_transaction() {
+  printf("testing lo_begin_transaction()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_begin_transaction(handle);
+  assert(return_code == 0);
+
+  return_code = lo_begin_transaction(handle);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  return_code = lo_abort_transaction(handle);
+  assert(return_code == 0);
+
+  lo_destroy_handle(handle);
+}
+
+void test_lo_commit_transaction() {
+  printf("testing lo_commit_transaction()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_commit_transaction(handle);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  return_code = lo_begin_transaction(handle);
+  assert(return_code == 0);
+
+  return_code = lo_set_plugin_position(handle, "Blank.esp", 100);
+  assert(return_code == 0);
+
+  return_code = lo_commit_transaction(handle);
+  assert(return_code == 0);
+  lo_destroy_handle(handle);
+
+  handle = create_handle();
+
+  size_t position = 0;
+  return_code = lo_get_plugin_position(handle, "Blank.esp", &position);
+  assert(return_code == 0);
+  assert(position > 7);
+
+  return_code = lo_set_plugin_position(handle, "Blank.esp", 7);
+  assert(return_code == 0);
+  lo_destroy_handle(handle);
+}
+
+void test_lo_abort_transaction() {
+  printf("testing lo_abort_transaction()...\n");
+  lo_game_handle handle = create_handle();
+
+  unsigned int return_code = lo_abort_transaction(handle);
+  assert(return_code == LIBLO_ERROR_INVALID_ARGS);
+
+  return_code = lo_begin_transaction(handle);
+  assert(return_code == 0);
+
+  return_code = lo_set_plugin_position(handle, "Blank.esp", 100);
+  assert(return_code == 0);
+
+  return_code = lo_abort_transaction(handle);
+  assert(return_code == 0);
+
+  size_t position = 0;
+  return_code = lo_get_plugin_position(handle, "Blank.esp", &position);
+  assert(return_code == 0);
+  assert(position == 7);
+  lo_destroy_handle(handle);
+}
+
 int main(void) {
   test_game_id_values();
 
@@ -293,22 +844,44 @@ int main(void) {
   test_lo_free_string_array();
 
   test_lo_create_handle();
+  test_lo_create_handle_with_options();
   test_lo_fix_plugin_lists();
+  test_lo_refresh_current_state();
+  test_lo_set_cache_path();
+  test_lo_set_write_durability();
+  test_lo_set_io_concurrency();
+  test_lo_set_thread_count();
+  test_lo_get_metrics();
   test_lo_get_implicitly_active_plugins();
 
   test_lo_set_active_plugins();
   test_lo_get_active_plugins();
+  test_lo_get_active_plugins_view();
   test_lo_set_plugin_active();
   test_lo_get_plugin_active();
 
   test_lo_get_load_order_method();
   test_lo_set_load_order();
+  test_lo_validate_load_order();
   test_lo_get_load_order();
+  test_lo_get_load_order_state();
+  test_lo_get_load_order_view();
+  test_lo_get_generation();
+  test_lo_is_stale();
+  test_lo_set_change_callback();
+  test_lo_load_current_state_async();
+  test_lo_save_async();
   test_lo_set_plugin_position();
   test_lo_get_plugin_position();
   test_lo_get_indexed_plugin();
 
+  test_lo_begin_transaction();
+  test_lo_get_pending_changes();
+  test_lo_commit_transaction();
+  test_lo_abort_transaction();
+
   test_thread_safety();
+  test_concurrent_reads_and_writes();
 
   remove("testing-plugins/Oblivion/plugins.txt");
   printf("SUCCESS\n");
@@ -0,0 +1,372 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#define make_directory(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define make_directory(path) mkdir(path, 0755)
+#endif
+
+#include "libloadorder.hpp"
+
+// Benchmarks for the C FFI. Each scenario is run against generated game
+// directories holding 1k, 5k and 10k plugins, a mix of masters, light masters
+// and plugins, some of which are ghosted.
+//
+// Run from the build directory, like the FFI tests. An optional argument gives
+// the directory to generate game data in, which defaults to "bench-data".
+//
+// The operating system's file cache is not dropped between runs, as that
+// requires elevated privileges, so "cold" scenarios measure a handle that has
+// no cached plugin data of its own, and "warm" scenarios one that does.
+
+static const char * SOURCE_DATA_PATH = "../../testing-plugins/SkyrimSE/Data/";
+static const size_t PLUGIN_COUNTS[] = { 1000, 5000, 10000 };
+static const size_t MAX_ACTIVE_PLUGINS = 250;
+static const size_t MAX_ACTIVE_LIGHT_MASTERS = 1000;
+static const int READER_THREADS = 4;
+
+typedef std::chrono::steady_clock Clock;
+
+struct GameData {
+  std::string game_path;
+  std::string local_path;
+  std::vector<std::string> plugins;
+  std::vector<std::string> active_plugins;
+};
+
+void copy_file(const std::string& from, const std::string& to) {
+  std::ifstream in(from.c_str(), std::ios::binary);
+  std::ofstream out(to.c_str(), std::ios::binary | std::ios::trunc);
+  assert(in.good() && out.good());
+  out << in.rdbuf();
+}
+
+std::string source_plugin(size_t index) {
+  switch (index % 10) {
+    case 0:
+      return "Blank.esm";
+    case 1:
+    case 2:
+      return "Blank.esl";
+    default:
+      return "Blank.esp";
+  }
+}
+
+std::string plugin_name(size_t index) {
+  std::string source = source_plugin(index);
+  return "Plugin " + std::to_string(index) + source.substr(source.size() - 4);
+}
+
+GameData create_game_data(const std::string& root, size_t plugin_count) {
+  GameData data;
+  data.game_path = root + "/" + std::to_string(plugin_count);
+  data.local_path = data.game_path + "/local";
+  std::string data_path = data.game_path + "/Data/";
+
+  make_directory(root.c_str());
+  make_directory(data.game_path.c_str());
+  make_directory(data.local_path.c_str());
+  make_directory(data_path.c_str());
+
+  copy_file(std::string(SOURCE_DATA_PATH) + "Blank.esm", data_path + "Skyrim.esm");
+  data.active_plugins.push_back("Skyrim.esm");
+
+  size_t active_count = 0;
+  size_t active_light_master_count = 0;
+  for (size_t i = 0; i < plugin_count; ++i) {
+    std::string name = plugin_name(i);
+    bool is_light_master = source_plugin(i) == "Blank.esl";
+
+    bool is_active = i % 3 == 0;
+    if (is_active && is_light_master) {
+      is_active = active_light_master_count < MAX_ACTIVE_LIGHT_MASTERS;
+      active_light_master_count += is_active ? 1 : 0;
+    } else if (is_active) {
+      is_active = active_count < MAX_ACTIVE_PLUGINS;
+      active_count += is_active ? 1 : 0;
+    }
+
+    // Ghost some inactive plugins, as activating a plugin unghosts it, which
+    // would make repeated runs of a scenario differ.
+    std::string path = data_path + name;
+    if (!is_active && i % 7 == 0) {
+      remove(path.c_str());
+      path += ".ghost";
+    } else {
+      remove((path + ".ghost").c_str());
+    }
+    copy_file(std::string(SOURCE_DATA_PATH) + source_plugin(i), path);
+
+    data.plugins.push_back(name);
+    if (is_active) {
+      data.active_plugins.push_back(name);
+    }
+  }
+
+  std::ofstream plugins_txt((data.local_path + "/plugins.txt").c_str(),
+                            std::ios::trunc);
+  for (size_t i = 0; i < data.plugins.size(); ++i) {
+    bool is_active = std::find(data.active_plugins.begin(),
+                               data.active_plugins.end(),
+                               data.plugins[i]) != data.active_plugins.end();
+    plugins_txt << (is_active ? "*" : "") << data.plugins[i] << "\n";
+  }
+
+  return data;
+}
+
+lo_game_handle create_handle(const GameData& data) {
+  lo_game_handle handle = nullptr;
+  unsigned int return_code = lo_create_handle(&handle,
+    LIBLO_GAME_TES5SE,
+    data.game_path.c_str(),
+    data.local_path.c_str());
+  assert(return_code == 0 || return_code == LIBLO_WARN_LO_MISMATCH);
+  assert(handle != nullptr);
+
+  return handle;
+}
+
+double elapsed_us(Clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+template<typename F>
+double mean_us(int iterations, F function) {
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    function();
+  }
+  return elapsed_us(start) / iterations;
+}
+
+void report(const char * scenario, size_t plugin_count, double us) {
+  printf("%-44s %6zu plugins %14.1f us\n", scenario, plugin_count, us);
+}
+
+void check(unsigned int return_code) {
+  if (return_code != 0) {
+    const char * message = nullptr;
+    lo_get_error_message(&message);
+    fprintf(stderr, "Error %u: %s\n", return_code, message ? message : "");
+    exit(1);
+  }
+}
+
+std::vector<const char *> to_pointers(const std::vector<std::string>& strings) {
+  std::vector<const char *> pointers;
+  for (size_t i = 0; i < strings.size(); ++i) {
+    pointers.push_back(strings[i].c_str());
+  }
+  return pointers;
+}
+
+void bench_loading(const GameData& data, size_t count) {
+  report("create handle and load (cold)", count, mean_us(3, [&]() {
+    lo_game_handle handle = create_handle(data);
+    check(lo_load_current_state(handle));
+    lo_destroy_handle(handle);
+  }));
+
+  lo_game_handle handle = create_handle(data);
+  check(lo_load_current_state(handle));
+
+  report("lo_load_current_state (warm)", count, mean_us(5, [&]() {
+    check(lo_load_current_state(handle));
+  }));
+
+  report("lo_refresh_current_state (unchanged)", count, mean_us(5, [&]() {
+    check(lo_refresh_current_state(handle));
+  }));
+
+  std::string cache_path = data.local_path + "/plugins.cache";
+  remove(cache_path.c_str());
+  check(lo_set_cache_path(handle, cache_path.c_str()));
+  check(lo_load_current_state(handle));
+  lo_destroy_handle(handle);
+
+  report("create handle and load (cache file)", count, mean_us(3, [&]() {
+    lo_game_handle handle = create_handle(data);
+    check(lo_set_cache_path(handle, cache_path.c_str()));
+    check(lo_load_current_state(handle));
+    lo_destroy_handle(handle);
+  }));
+
+  lo_game_handle handles[2];
+  report("create shared-cache handle and load", count, mean_us(3, [&]() {
+    for (int i = 0; i < 2; ++i) {
+      handles[i] = nullptr;
+      unsigned int return_code = lo_create_handle_with_options(&handles[i],
+        LIBLO_GAME_TES5SE,
+        data.game_path.c_str(),
+        data.local_path.c_str(),
+        LIBLO_HANDLE_SHARED_PLUGIN_CACHE);
+      assert(return_code == 0 || return_code == LIBLO_WARN_LO_MISMATCH);
+      check(lo_load_current_state(handles[i]));
+    }
+    lo_destroy_handle(handles[0]);
+    lo_destroy_handle(handles[1]);
+  }) / 2);
+}
+
+void bench_queries(const GameData& data, size_t count) {
+  lo_game_handle handle = create_handle(data);
+  check(lo_load_current_state(handle));
+
+  report("lo_get_load_order", count, mean_us(100, [&]() {
+    char ** plugins;
+    size_t num_plugins;
+    check(lo_get_load_order(handle, &plugins, &num_plugins));
+    lo_free_string_array(plugins, num_plugins);
+  }));
+
+  report("lo_get_load_order_view", count, mean_us(100, [&]() {
+    const char * const * plugins;
+    size_t num_plugins;
+    check(lo_get_load_order_view(handle, &plugins, &num_plugins));
+  }));
+
+  report("lo_get_active_plugins", count, mean_us(100, [&]() {
+    char ** plugins;
+    size_t num_plugins;
+    check(lo_get_active_plugins(handle, &plugins, &num_plugins));
+    lo_free_string_array(plugins, num_plugins);
+  }));
+
+  report("lo_get_plugin_active (x100)", count, mean_us(100, [&]() {
+    for (size_t i = 0; i < 100; ++i) {
+      bool is_active;
+      check(lo_get_plugin_active(handle, data.plugins[i * count / 100].c_str(), &is_active));
+    }
+  }));
+
+  report("lo_get_plugin_position (x100)", count, mean_us(100, [&]() {
+    for (size_t i = 0; i < 100; ++i) {
+      size_t position;
+      check(lo_get_plugin_position(handle, data.plugins[i * count / 100].c_str(), &position));
+    }
+  }));
+
+  lo_destroy_handle(handle);
+}
+
+void bench_writes(const GameData& data, size_t count) {
+  lo_game_handle handle = create_handle(data);
+  check(lo_load_current_state(handle));
+
+  std::vector<const char *> active_plugins = to_pointers(data.active_plugins);
+  std::vector<const char *> fewer_active_plugins(active_plugins.begin(),
+                                                 active_plugins.end() - 1);
+  bool use_all = false;
+  report("lo_set_active_plugins", count, mean_us(10, [&]() {
+    use_all = !use_all;
+    std::vector<const char *>& plugins = use_all ? active_plugins : fewer_active_plugins;
+    check(lo_set_active_plugins(handle, plugins.data(), plugins.size()));
+  }));
+
+  const char * plugin = data.plugins.back().c_str();
+  bool active = false;
+  report("lo_set_plugin_active", count, mean_us(10, [&]() {
+    active = !active;
+    check(lo_set_plugin_active(handle, plugin, active));
+  }));
+
+  report("lo_set_plugin_active (x100 in transaction)", count, mean_us(5, [&]() {
+    check(lo_begin_transaction(handle));
+    for (int i = 0; i < 100; ++i) {
+      active = !active;
+      check(lo_set_plugin_active(handle, plugin, active));
+    }
+    check(lo_commit_transaction(handle));
+  }));
+
+  check(lo_set_active_plugins(handle, active_plugins.data(), active_plugins.size()));
+  lo_destroy_handle(handle);
+}
+
+void bench_contention(const GameData& data, size_t count) {
+  lo_game_handle handle = create_handle(data);
+  check(lo_load_current_state(handle));
+
+  std::atomic<bool> done(false);
+  std::vector<double> reader_max_us(READER_THREADS, 0);
+  std::vector<double> reader_total_us(READER_THREADS, 0);
+  std::vector<size_t> reader_calls(READER_THREADS, 0);
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < READER_THREADS; ++i) {
+    readers.push_back(std::thread([&, i]() {
+      const char * plugin = data.plugins[i * count / READER_THREADS].c_str();
+      while (!done.load()) {
+        Clock::time_point start = Clock::now();
+
+        char ** plugins;
+        size_t num_plugins;
+        check(lo_get_load_order(handle, &plugins, &num_plugins));
+        lo_free_string_array(plugins, num_plugins);
+
+        bool is_active;
+        check(lo_get_plugin_active(handle, plugin, &is_active));
+
+        double us = elapsed_us(start);
+        reader_total_us[i] += us;
+        reader_max_us[i] = std::max(reader_max_us[i], us);
+        reader_calls[i] += 1;
+      }
+    }));
+  }
+
+  double writer_us = mean_us(5, [&]() {
+    check(lo_load_current_state(handle));
+  });
+  done.store(true);
+
+  for (size_t i = 0; i < readers.size(); ++i) {
+    readers[i].join();
+  }
+
+  double total_us = 0;
+  double max_us = 0;
+  size_t calls = 0;
+  for (int i = 0; i < READER_THREADS; ++i) {
+    total_us += reader_total_us[i];
+    max_us = std::max(max_us, reader_max_us[i]);
+    calls += reader_calls[i];
+  }
+
+  report("contended lo_load_current_state", count, writer_us);
+  report("contended reader (mean)", count, calls > 0 ? total_us / calls : 0);
+  report("contended reader (max)", count, max_us);
+
+  lo_destroy_handle(handle);
+}
+
+int main(int argc, char ** argv) {
+  std::string root = argc > 1 ? argv[1] : "bench-data";
+
+  for (size_t i = 0; i < sizeof(PLUGIN_COUNTS) / sizeof(PLUGIN_COUNTS[0]); ++i) {
+    size_t count = PLUGIN_COUNTS[i];
+    GameData data = create_game_data(root, count);
+
+    bench_loading(data, count);
+    bench_queries(data, count);
+    bench_writes(data, count);
+    bench_contention(data, count);
+  }
+
+  return 0;
+}
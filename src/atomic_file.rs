@@ -0,0 +1,282 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+use std::fs::{remove_file, rename, File};
+use std::io::{Read, Write};
+use std::path::{Path, PathBuf};
+use std::process;
+use std::sync::atomic::{AtomicUsize, Ordering};
+
+use enums::{Error, WriteDurability};
+use load_order::create_parent_dirs;
+use metrics::{Counter, CountingReader, MetricsRecorder};
+
+/// Counts the temporary files created by this process, so that concurrent
+/// writes of the same file don't use the same temporary file.
+static TEMP_FILE_COUNTER: AtomicUsize = AtomicUsize::new(0);
+
+/// Writes `content` to the file at `path`, unless the file already has that
+/// content.
+///
+/// The content is written to a temporary file in the same directory, which
+/// is then renamed to replace the file at `path`, so that readers see either
+/// the old or the new content but never a partially written file.
+pub fn write_file(
+    path: &Path,
+    content: &[u8],
+    durability: WriteDurability,
+    metrics: &MetricsRecorder,
+) -> Result<(), Error> {
+    if has_content(path, content, metrics) {
+        return Ok(());
+    }
+
+    create_parent_dirs(path)?;
+
+    let temp_path = temp_file_path(path);
+    let result = write_temp_file(&temp_path, content, durability, metrics).and_then(|_| {
+        metrics.add(Counter::FileRenames, 1);
+        rename(&temp_path, path).map_err(Error::from)
+    });
+
+    if result.is_err() {
+        let _ = remove_file(&temp_path);
+    }
+    result?;
+
+    if durability == WriteDurability::SyncFileAndDirectory {
+        sync_parent_dir(path, metrics)?;
+    }
+
+    Ok(())
+}
+
+fn has_content(path: &Path, content: &[u8], metrics: &MetricsRecorder) -> bool {
+    metrics.add(Counter::FileOpens, 1);
+    let file = match File::open(path) {
+        Ok(x) => x,
+        Err(_) => return false,
+    };
+
+    metrics.add(Counter::FileStats, 1);
+    match file.metadata() {
+        Ok(ref m) if m.len() == content.len() as u64 => {}
+        _ => return false,
+    }
+
+    let mut reader = CountingReader::new(file);
+    let mut existing_content = Vec::with_capacity(content.len());
+    let result = reader.read_to_end(&mut existing_content);
+    metrics.add(Counter::FileReads, reader.reads());
+
+    match result {
+        Ok(_) => existing_content == content,
+        Err(_) => false,
+    }
+}
+
+fn temp_file_path(path: &Path) -> PathBuf {
+    let mut filename = path.file_name().unwrap_or_default().to_os_string();
+    let count = TEMP_FILE_COUNTER.fetch_add(1, Ordering::Relaxed);
+    filename.push(format!(".{}.{}.tmp", process::id(), count));
+
+    path.with_file_name(filename)
+}
+
+fn write_temp_file(
+    path: &Path,
+    content: &[u8],
+    durability: WriteDurability,
+    metrics: &MetricsRecorder,
+) -> Result<(), Error> {
+    metrics.add(Counter::FileOpens, 1);
+    let mut file = File::create(path)?;
+    file.write_all(content)?;
+
+    if durability != WriteDurability::Buffered {
+        file.sync_all()?;
+    }
+
+    Ok(())
+}
+
+#[cfg(unix)]
+fn sync_parent_dir(path: &Path, metrics: &MetricsRecorder) -> Result<(), Error> {
+    if let Some(parent) = path.parent() {
+        metrics.add(Counter::FileOpens, 1);
+        File::open(parent)?.sync_all()?;
+    }
+    Ok(())
+}
+
+#[cfg(not(unix))]
+fn sync_parent_dir(_: &Path, _: &MetricsRecorder) -> Result<(), Error> {
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    use std::fs::{read_dir, File};
+
+    use filetime::{set_file_times, FileTime};
+    use tempfile::tempdir;
+
+    fn read_file(path: &Path) -> Vec<u8> {
+        let mut content = Vec::new();
+        File::open(path)
+            .unwrap()
+            .read_to_end(&mut content)
+            .unwrap();
+        content
+    }
+
+    #[test]
+    fn write_file_should_create_the_file_and_its_parent_directories() {
+        let tmp_dir = tempdir().unwrap();
+        let path = tmp_dir.path().join("a").join("plugins.txt");
+
+        write_file(
+            &path,
+            b"Blank.esp\n",
+            WriteDurability::Buffered,
+            &MetricsRecorder::default(),
+        ).unwrap();
+
+        assert_eq!(b"Blank.esp\n".to_vec(), read_file(&path));
+    }
+
+    #[test]
+    fn write_file_should_replace_the_content_of_an_existing_file() {
+        let tmp_dir = tempdir().unwrap();
+        let path = tmp_dir.path().join("plugins.txt");
+        File::create(&path)
+            .unwrap()
+            .write_all(b"Blank.esm\nBlank.esp\n")
+            .unwrap();
+
+        write_file(
+            &path,
+            b"Blank.esp\n",
+            WriteDurability::SyncFile,
+            &MetricsRecorder::default(),
+        ).unwrap();
+
+        assert_eq!(b"Blank.esp\n".to_vec(), read_file(&path));
+    }
+
+    #[test]
+    fn write_file_should_not_write_the_file_if_its_content_is_unchanged() {
+        let tmp_dir = tempdir().unwrap();
+        let path = tmp_dir.path().join("plugins.txt");
+        File::create(&path)
+            .unwrap()
+            .write_all(b"Blank.esp\n")
+            .unwrap();
+        set_file_times(&path, FileTime::zero(), FileTime::zero()).unwrap();
+
+        write_file(
+            &path,
+            b"Blank.esp\n",
+            WriteDurability::Buffered,
+            &MetricsRecorder::default(),
+        ).unwrap();
+
+        let mtime = FileTime::from_last_modification_time(&path.metadata().unwrap());
+        assert_eq!(FileTime::zero(), mtime);
+    }
+
+    #[test]
+    fn write_file_should_count_the_file_system_calls_it_makes() {
+        let tmp_dir = tempdir().unwrap();
+        let path = tmp_dir.path().join("plugins.txt");
+        let metrics = MetricsRecorder::enabled();
+
+        write_file(&path, b"Blank.esp\n", WriteDurability::Buffered, &metrics).unwrap();
+
+        let recorded = metrics.metrics();
+        assert_eq!(2, recorded.file_opens);
+        assert_eq!(0, recorded.file_reads);
+        assert_eq!(0, recorded.file_stats);
+        assert_eq!(1, recorded.file_renames);
+
+        write_file(&path, b"Blank.esp\n", WriteDurability::Buffered, &metrics).unwrap();
+
+        let recorded = metrics.metrics();
+        assert_eq!(3, recorded.file_opens);
+        assert!(recorded.file_reads > 0);
+        assert_eq!(1, recorded.file_stats);
+        assert_eq!(1, recorded.file_renames);
+    }
+
+    #[test]
+    fn write_file_should_not_leave_a_temporary_file_behind() {
+        let tmp_dir = tempdir().unwrap();
+        let path = tmp_dir.path().join("plugins.txt");
+
+        write_file(
+            &path,
+            b"Blank.esp\n",
+            WriteDurability::SyncFileAndDirectory,
+            &MetricsRecorder::default(),
+        ).unwrap();
+
+        let filenames: Vec<_> = read_dir(tmp_dir.path())
+            .unwrap()
+            .map(|e| e.unwrap().file_name())
+            .collect();
+        assert_eq!(vec!["plugins.txt"], filenames);
+    }
+
+    #[test]
+    fn temp_file_path_should_be_unique_for_each_write_of_the_same_file() {
+        let path = Path::new("plugins.txt");
+
+        assert_ne!(temp_file_path(path), temp_file_path(path));
+    }
+
+    #[test]
+    fn write_file_should_support_concurrent_writes_of_the_same_file() {
+        let tmp_dir = tempdir().unwrap();
+        let path = tmp_dir.path().join("plugins.txt");
+
+        let threads: Vec<_> = (0..8)
+            .map(|i| {
+                let path = path.clone();
+                ::std::thread::spawn(move || {
+                    let content = format!("Blank{}.esp\n", i).repeat(1000);
+                    write_file(
+                        &path,
+                        content.as_bytes(),
+                        WriteDurability::Buffered,
+                        &MetricsRecorder::default(),
+                    )
+                })
+            })
+            .collect();
+
+        for thread in threads {
+            thread.join().unwrap().unwrap();
+        }
+
+        let content = String::from_utf8(read_file(&path)).unwrap();
+        let first_line = content.lines().next().unwrap().to_string() + "\n";
+        assert_eq!(first_line.repeat(1000), content);
+    }
+}
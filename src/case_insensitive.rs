@@ -0,0 +1,116 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+use std::borrow::Borrow;
+use std::hash::{Hash, Hasher};
+
+use unicase::UniCase;
+
+/// A string slice that is compared and hashed case-insensitively.
+///
+/// Sets and maps keyed by `CaseInsensitiveString` can be queried with a
+/// `&CaseInsensitiveStr`, which is created from a `&str` without copying it.
+#[derive(Debug)]
+pub struct CaseInsensitiveStr(str);
+
+impl CaseInsensitiveStr {
+    pub fn new(string: &str) -> &CaseInsensitiveStr {
+        // This is sound because CaseInsensitiveStr is a single-field wrapper
+        // around str, so has the same layout.
+        unsafe { &*(string as *const str as *const CaseInsensitiveStr) }
+    }
+}
+
+impl PartialEq for CaseInsensitiveStr {
+    fn eq(&self, other: &CaseInsensitiveStr) -> bool {
+        UniCase::new(&self.0) == UniCase::new(&other.0)
+    }
+}
+
+impl Eq for CaseInsensitiveStr {}
+
+impl Hash for CaseInsensitiveStr {
+    fn hash<H: Hasher>(&self, state: &mut H) {
+        UniCase::new(&self.0).hash(state)
+    }
+}
+
+/// An owned string that is compared and hashed case-insensitively, and which
+/// can be borrowed as a `CaseInsensitiveStr`.
+#[derive(Clone, Debug)]
+pub struct CaseInsensitiveString(Box<str>);
+
+impl CaseInsensitiveString {
+    pub fn new(string: &str) -> CaseInsensitiveString {
+        CaseInsensitiveString(Box::from(string))
+    }
+}
+
+impl Borrow<CaseInsensitiveStr> for CaseInsensitiveString {
+    fn borrow(&self) -> &CaseInsensitiveStr {
+        CaseInsensitiveStr::new(&self.0)
+    }
+}
+
+impl PartialEq for CaseInsensitiveString {
+    fn eq(&self, other: &CaseInsensitiveString) -> bool {
+        Borrow::<CaseInsensitiveStr>::borrow(self) == other.borrow()
+    }
+}
+
+impl Eq for CaseInsensitiveString {}
+
+// Must hash the same as the borrowed form, for lookups to find the entry.
+impl Hash for CaseInsensitiveString {
+    fn hash<H: Hasher>(&self, state: &mut H) {
+        Borrow::<CaseInsensitiveStr>::borrow(self).hash(state)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    use std::collections::HashSet;
+
+    use tests::count_allocations;
+
+    #[test]
+    fn case_insensitive_strs_should_be_equal_if_they_differ_only_by_case() {
+        assert_eq!(CaseInsensitiveStr::new("Blàñk.esp"), CaseInsensitiveStr::new("BLÀÑK.ESP"));
+        assert_ne!(CaseInsensitiveStr::new("Blank.esp"), CaseInsensitiveStr::new("Blank.esm"));
+    }
+
+    #[test]
+    fn sets_of_case_insensitive_strings_should_be_queryable_without_allocating() {
+        let set: HashSet<CaseInsensitiveString> = ["Update.esm", "Blàñk.esp"]
+            .iter()
+            .map(|s| CaseInsensitiveString::new(s))
+            .collect();
+
+        let mut found = false;
+        let allocations = count_allocations(|| {
+            found = set.contains(CaseInsensitiveStr::new("update.ESM"))
+                && set.contains(CaseInsensitiveStr::new("BLÀÑK.esp"))
+                && !set.contains(CaseInsensitiveStr::new("Blank.esm"));
+        });
+
+        assert!(found);
+        assert_eq!(0, allocations);
+    }
+}
@@ -40,6 +40,26 @@ pub enum LoadOrderMethod {
     Asterisk,
 }
 
+/// How durably saved files are written. Files are always written to a
+/// temporary file that then replaces the original, so that other processes
+/// never read a partially written file.
+#[derive(Clone, Copy, PartialEq, Eq, Debug, Hash)]
+pub enum WriteDurability {
+    /// Leave flushing written data to disk to the operating system.
+    Buffered,
+    /// Flush written data to disk before replacing the original file.
+    SyncFile,
+    /// As `SyncFile`, and also flush the replacement of the original file to
+    /// disk. This has no additional effect on Windows.
+    SyncFileAndDirectory,
+}
+
+impl Default for WriteDurability {
+    fn default() -> Self {
+        WriteDurability::Buffered
+    }
+}
+
 #[derive(Clone, Copy, PartialEq, Eq, Debug, Hash)]
 pub enum GameId {
     Morrowind = 1,
@@ -77,6 +97,28 @@ impl GameId {
     }
 }
 
+/// A reason why a proposed load order would be rejected, as found by
+/// `WritableLoadOrder::validate_load_order()`. Indices are positions in the
+/// proposed load order.
+#[derive(Clone, Copy, PartialEq, Eq, Debug, Hash)]
+pub enum LoadOrderViolation {
+    /// The plugin at the index has the same name as a plugin before it.
+    DuplicatePlugin(usize),
+    /// The plugin at the index is not in the current load order, so it was
+    /// not checked further.
+    UnknownPlugin(usize),
+    /// The master at the index loads after a non-master.
+    NonMasterBeforeMaster(usize),
+    /// The game's main master file does not load first.
+    GameMasterNotFirst,
+    /// The implicitly active plugin at the index loads out of its hardcoded
+    /// order relative to the other implicitly active plugins.
+    ImplicitlyActivePluginOutOfOrder(usize),
+    /// The active plugin at the index exceeds the limit on the number of
+    /// active plugins of its type.
+    TooManyActivePlugins(usize),
+}
+
 #[derive(Debug)]
 pub enum Error {
     InvalidPath(PathBuf),
@@ -96,6 +138,9 @@ pub enum Error {
     InvalidPlugin(String),
     ImplicitlyActivePlugin(String),
     NoLocalAppData,
+    /// The plugins that could not be activated, with the errors encountered.
+    ActivationFailed(Vec<(String, Error)>),
+    ThreadPoolError(String),
 }
 
 #[cfg(windows)]
@@ -184,6 +229,14 @@ impl fmt::Display for Error {
             Error::NoLocalAppData => {
                 write!(f, "The game's local app data folder could not be detected")
             }
+            Error::ActivationFailed(ref x) => {
+                write!(f, "The following plugins could not be activated:")?;
+                for &(ref name, ref error) in x {
+                    write!(f, " \"{}\" ({})", name, error)?;
+                }
+                Ok(())
+            }
+            Error::ThreadPoolError(ref x) => write!(f, "A thread pool could not be created: {}", x),
         }
     }
 }
@@ -214,6 +267,8 @@ impl error::Error for Error {
             Error::InvalidPlugin(_) => "The plugin file is invalid",
             Error::ImplicitlyActivePlugin(_) => "Implicitly active plugins cannot be deactivated",
             Error::NoLocalAppData => "The game's local app data folder could not be detected",
+            Error::ActivationFailed(_) => "One or more plugins could not be activated",
+            Error::ThreadPoolError(_) => "A thread pool could not be created",
         }
     }
 
@@ -17,22 +17,32 @@
  * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
  */
 
+use std::cmp::max;
+use std::collections::HashSet;
 use std::fs::File;
+use std::hash::{Hash, Hasher};
 use std::io::{BufRead, BufReader, Read};
 use std::path::Path;
 use std::path::PathBuf;
+use std::sync::Arc;
+use std::time::SystemTime;
 
 #[cfg(windows)]
 use app_dirs;
 
 use encoding::all::WINDOWS_1252;
 use encoding::{DecoderTrap, Encoding};
+use rayon::ThreadPool;
 
-use enums::{Error, GameId, LoadOrderMethod};
+use case_insensitive::{CaseInsensitiveStr, CaseInsensitiveString};
+use enums::{Error, GameId, LoadOrderMethod, WriteDurability};
 use load_order::AsteriskBasedLoadOrder;
 use load_order::TextfileBasedLoadOrder;
 use load_order::TimestampBasedLoadOrder;
 use load_order::WritableLoadOrder;
+use metrics::{Metrics, MetricsRecorder};
+use parallelism::Parallelism;
+use plugin_cache::PluginCache;
 
 #[derive(Clone, Eq, PartialEq, Hash, Debug)]
 pub struct GameSettings {
@@ -40,9 +50,61 @@ pub struct GameSettings {
     game_path: PathBuf,
     plugins_file_path: PathBuf,
     load_order_path: Option<PathBuf>,
-    implicitly_active_plugins: Vec<String>,
+    implicitly_active_plugins: ImplicitlyActivePlugins,
+    plugin_cache: PluginCache,
+    write_durability: WriteDurability,
+    io_concurrency: usize,
+    parallelism: Parallelism,
+    metrics: MetricsRecorder,
 }
 
+/// The plugins that are always active, with a case-folded set of their names
+/// for constant-time lookups, and the modification time of the ccc file that
+/// some of them were read from, so that it is only read again if it changes.
+#[derive(Clone, Debug, Default)]
+struct ImplicitlyActivePlugins {
+    names: Vec<String>,
+    folded_names: HashSet<CaseInsensitiveString>,
+    ccc_file_modified: Option<SystemTime>,
+}
+
+impl ImplicitlyActivePlugins {
+    fn read(game_id: GameId, game_path: &Path) -> Result<ImplicitlyActivePlugins, Error> {
+        let ccc_file_path = ccc_file_path(game_id, game_path);
+        let ccc_file_modified = ccc_file_path.as_ref().and_then(|p| modification_time(p));
+        let names = implicitly_active_plugins(game_id, ccc_file_path.as_ref())?;
+        let folded_names = names.iter().map(|n| CaseInsensitiveString::new(n)).collect();
+
+        Ok(ImplicitlyActivePlugins {
+            names,
+            folded_names,
+            ccc_file_modified,
+        })
+    }
+
+    fn contains(&self, plugin: &str) -> bool {
+        !self.folded_names.is_empty()
+            && self.folded_names.contains(CaseInsensitiveStr::new(plugin))
+    }
+}
+
+// The set and modification time are derived from the names.
+impl PartialEq for ImplicitlyActivePlugins {
+    fn eq(&self, other: &ImplicitlyActivePlugins) -> bool {
+        self.names == other.names
+    }
+}
+
+impl Eq for ImplicitlyActivePlugins {}
+
+impl Hash for ImplicitlyActivePlugins {
+    fn hash<H: Hasher>(&self, state: &mut H) {
+        self.names.hash(state);
+    }
+}
+
+const DEFAULT_IO_CONCURRENCY: usize = 8;
+
 const SKYRIM_HARDCODED_PLUGINS: &[&str] = &["Skyrim.esm", "Update.esm"];
 
 const SKYRIM_SE_HARDCODED_PLUGINS: &[&str] = &[
@@ -92,7 +154,7 @@ impl GameSettings {
     ) -> Result<GameSettings, Error> {
         let plugins_file_path = plugins_file_path(&game_id, game_path, local_path);
         let load_order_path = load_order_path(&game_id, local_path);
-        let implicitly_active_plugins = implicitly_active_plugins(game_id, game_path)?;
+        let implicitly_active_plugins = ImplicitlyActivePlugins::read(game_id, game_path)?;
 
         Ok(GameSettings {
             id: game_id,
@@ -100,6 +162,11 @@ impl GameSettings {
             plugins_file_path,
             load_order_path,
             implicitly_active_plugins,
+            plugin_cache: PluginCache::new(game_id),
+            write_durability: WriteDurability::default(),
+            io_concurrency: DEFAULT_IO_CONCURRENCY,
+            parallelism: Parallelism::default(),
+            metrics: MetricsRecorder::default(),
         })
     }
 
@@ -137,14 +204,29 @@ impl GameSettings {
     }
 
     pub fn implicitly_active_plugins(&self) -> &[String] {
-        &self.implicitly_active_plugins
+        &self.implicitly_active_plugins.names
     }
 
     pub fn is_implicitly_active(&self, plugin: &str) -> bool {
-        use unicase::eq;
-        self.implicitly_active_plugins()
-            .iter()
-            .any(|p| eq(p.as_str(), plugin))
+        self.implicitly_active_plugins.contains(plugin)
+    }
+
+    /// Reads the implicitly active plugins again if the file that lists the
+    /// game's Creation Club plugins has been created, changed or deleted
+    /// since it was last read, returning true if it was read again.
+    pub(crate) fn refresh_implicitly_active_plugins(&mut self) -> Result<bool, Error> {
+        let ccc_file_modified = match ccc_file_path(self.id, &self.game_path) {
+            Some(path) => modification_time(&path),
+            None => return Ok(false),
+        };
+
+        if ccc_file_modified == self.implicitly_active_plugins.ccc_file_modified {
+            return Ok(false);
+        }
+
+        self.implicitly_active_plugins = ImplicitlyActivePlugins::read(self.id, &self.game_path)?;
+
+        Ok(true)
     }
 
     pub fn plugins_directory(&self) -> PathBuf {
@@ -155,10 +237,129 @@ impl GameSettings {
         &self.plugins_file_path
     }
 
+    pub(crate) fn implicitly_active_plugins_file(&self) -> Option<PathBuf> {
+        ccc_file_path(self.id, &self.game_path)
+    }
+
     pub fn load_order_file(&self) -> Option<&PathBuf> {
         self.load_order_path.as_ref()
     }
 
+    pub fn plugin_cache_path(&self) -> Option<&Path> {
+        self.plugin_cache.path()
+    }
+
+    /// Sets the path of the file used to persist plugin header data between
+    /// loads, or disables the cache if `None` is given. Any existing cache
+    /// file is read immediately. This replaces a shared plugin cache.
+    pub fn set_plugin_cache_path(&mut self, path: Option<&Path>) -> Result<(), Error> {
+        self.plugin_cache = match path {
+            Some(x) => PluginCache::load(self.id, x)?,
+            None => PluginCache::new(self.id),
+        };
+        Ok(())
+    }
+
+    pub fn is_plugin_cache_shared(&self) -> bool {
+        self.plugin_cache.is_shared()
+    }
+
+    /// Enables an in-memory plugin header cache that is shared with all other
+    /// game settings for the same game in the process that also share their
+    /// cache, or disables the cache if `false` is given. This replaces any
+    /// persistent plugin cache.
+    pub fn set_plugin_cache_shared(&mut self, shared: bool) {
+        self.plugin_cache = if shared {
+            PluginCache::shared(self.id, &self.plugins_directory())
+        } else {
+            PluginCache::new(self.id)
+        };
+    }
+
+    pub(crate) fn plugin_cache(&self) -> &PluginCache {
+        &self.plugin_cache
+    }
+
+    pub fn write_durability(&self) -> WriteDurability {
+        self.write_durability
+    }
+
+    /// Sets how durably the load order and active plugins files are written
+    /// when saving.
+    pub fn set_write_durability(&mut self, durability: WriteDurability) {
+        self.write_durability = durability;
+    }
+
+    pub fn io_concurrency(&self) -> usize {
+        self.io_concurrency
+    }
+
+    /// Sets the maximum number of threads used to unghost plugins when
+    /// activating many plugins at once. Unghosting is limited by filesystem
+    /// latency rather than CPU time, so this is independent of the number of
+    /// CPU cores. A value of zero is treated as one.
+    pub fn set_io_concurrency(&mut self, concurrency: usize) {
+        self.io_concurrency = max(concurrency, 1);
+    }
+
+    /// Gets the number of threads in the thread pool used for CPU-bound
+    /// parallel work, or zero if rayon's global thread pool is used.
+    pub fn thread_count(&self) -> usize {
+        self.parallelism.thread_count()
+    }
+
+    /// Creates a thread pool with the given number of threads that is used for
+    /// CPU-bound parallel work, such as reading plugin headers, instead of
+    /// rayon's global thread pool. A value of zero uses the global thread pool.
+    pub fn set_thread_count(&mut self, count: usize) -> Result<(), Error> {
+        self.parallelism.set_thread_count(count)
+    }
+
+    /// Sets the thread pool used for CPU-bound parallel work, so that it can
+    /// be shared with other code.
+    pub fn set_thread_pool(&mut self, pool: Arc<ThreadPool>) {
+        self.parallelism.set_thread_pool(pool)
+    }
+
+    pub fn sequential_threshold(&self) -> usize {
+        self.parallelism.sequential_threshold()
+    }
+
+    /// Sets the number of plugins or plugin names below which work is done
+    /// sequentially instead of in parallel, as splitting up small amounts of
+    /// work costs more than it saves. A value of zero is treated as one.
+    pub fn set_sequential_threshold(&mut self, threshold: usize) {
+        self.parallelism.set_sequential_threshold(threshold)
+    }
+
+    pub(crate) fn parallelism(&self) -> &Parallelism {
+        &self.parallelism
+    }
+
+    pub fn is_metrics_enabled(&self) -> bool {
+        self.metrics.is_enabled()
+    }
+
+    /// Enables or disables recording metrics while loading and saving. Enabling
+    /// metrics discards any previously recorded metrics.
+    pub fn set_metrics_enabled(&mut self, enabled: bool) {
+        self.metrics = if enabled {
+            MetricsRecorder::enabled()
+        } else {
+            MetricsRecorder::default()
+        };
+    }
+
+    /// Gets the metrics recorded since they were enabled. If metrics are
+    /// disabled, all values are zero.
+    pub fn metrics(&self) -> Metrics {
+        self.metrics.metrics()
+    }
+
+    pub(crate) fn metrics_recorder(&self) -> &MetricsRecorder {
+        &self.metrics
+    }
+
     fn plugins_folder_name(&self) -> &'static str {
         match self.id {
             GameId::Morrowind => "Data Files",
@@ -245,13 +446,20 @@ fn hardcoded_plugins(game_id: GameId) -> &'static [&'static str] {
     }
 }
 
-fn implicitly_active_plugins(game_id: GameId, game_path: &Path) -> Result<Vec<String>, Error> {
+fn modification_time(path: &Path) -> Option<SystemTime> {
+    path.metadata().and_then(|m| m.modified()).ok()
+}
+
+fn implicitly_active_plugins(
+    game_id: GameId,
+    ccc_file_path: Option<&PathBuf>,
+) -> Result<Vec<String>, Error> {
     let mut plugin_names: Vec<String> = hardcoded_plugins(game_id)
         .iter()
         .map(|s| s.to_string())
         .collect();
 
-    if let Some(file_path) = ccc_file_path(game_id, game_path) {
+    if let Some(file_path) = ccc_file_path {
         if file_path.exists() {
             let reader = BufReader::new(File::open(file_path)?);
 
@@ -271,10 +479,14 @@ fn implicitly_active_plugins(game_id: GameId, game_path: &Path) -> Result<Vec<St
 mod tests {
     #[cfg(windows)]
     use std::env;
+    use filetime::{set_file_times, FileTime};
+    use std::fs::remove_file;
     use std::io::Write;
     use tempfile::tempdir;
 
     use super::*;
+    use metrics::Phase;
+    use tests::count_allocations;
 
     fn game_with_ccc_plugins(
         game_id: GameId,
@@ -823,6 +1035,189 @@ mod tests {
         assert!(settings.is_implicitly_active("update.esm"));
     }
 
+    #[test]
+    fn is_implicitly_active_should_not_allocate() {
+        let settings =
+            GameSettings::with_local_path(GameId::Skyrim, &PathBuf::default(), &PathBuf::default())
+                .unwrap();
+
+        let mut is_active = false;
+        let allocations = count_allocations(|| {
+            is_active = settings.is_implicitly_active("update.esm")
+                && !settings.is_implicitly_active("Blank.esm");
+        });
+
+        assert!(is_active);
+        assert_eq!(0, allocations);
+    }
+
+    #[test]
+    fn refresh_implicitly_active_plugins_should_do_nothing_if_the_ccc_file_is_unchanged() {
+        let tmp_dir = tempdir().unwrap();
+        let game_path = tmp_dir.path();
+
+        let mut settings =
+            game_with_ccc_plugins(GameId::Fallout4, game_path, &["ccBGSFO4001-PipBoy(Black).esl"]);
+        let ccc_file_path = ccc_file_path(GameId::Fallout4, game_path).unwrap();
+        set_file_times(&ccc_file_path, FileTime::zero(), FileTime::from_unix_time(1, 0))
+            .unwrap();
+        assert!(settings.refresh_implicitly_active_plugins().unwrap());
+
+        assert!(!settings.refresh_implicitly_active_plugins().unwrap());
+        assert!(settings.is_implicitly_active("ccbgsfo4001-pipboy(black).esl"));
+    }
+
+    #[test]
+    fn refresh_implicitly_active_plugins_should_read_the_ccc_file_again_if_it_has_changed() {
+        let tmp_dir = tempdir().unwrap();
+        let game_path = tmp_dir.path();
+
+        let mut settings =
+            game_with_ccc_plugins(GameId::Fallout4, game_path, &["ccBGSFO4001-PipBoy(Black).esl"]);
+        let ccc_file_path = ccc_file_path(GameId::Fallout4, game_path).unwrap();
+        set_file_times(&ccc_file_path, FileTime::zero(), FileTime::from_unix_time(1, 0))
+            .unwrap();
+        settings.refresh_implicitly_active_plugins().unwrap();
+
+        let mut file = File::create(&ccc_file_path).unwrap();
+        writeln!(file, "ccBGSFO4016-Prey.esl").unwrap();
+        drop(file);
+        set_file_times(&ccc_file_path, FileTime::zero(), FileTime::from_unix_time(2, 0))
+            .unwrap();
+
+        assert!(settings.refresh_implicitly_active_plugins().unwrap());
+        assert!(settings.is_implicitly_active("ccBGSFO4016-Prey.esl"));
+        assert!(!settings.is_implicitly_active("ccBGSFO4001-PipBoy(Black).esl"));
+    }
+
+    #[test]
+    fn refresh_implicitly_active_plugins_should_read_the_ccc_file_again_if_it_is_deleted() {
+        let tmp_dir = tempdir().unwrap();
+        let game_path = tmp_dir.path();
+
+        let mut settings =
+            game_with_ccc_plugins(GameId::Fallout4, game_path, &["ccBGSFO4016-Prey.esl"]);
+        remove_file(ccc_file_path(GameId::Fallout4, game_path).unwrap()).unwrap();
+
+        assert!(settings.refresh_implicitly_active_plugins().unwrap());
+        assert!(!settings.is_implicitly_active("ccBGSFO4016-Prey.esl"));
+        assert!(settings.is_implicitly_active("Fallout4.esm"));
+    }
+
+    #[test]
+    fn refresh_implicitly_active_plugins_should_do_nothing_for_games_without_a_ccc_file() {
+        let mut settings =
+            GameSettings::with_local_path(GameId::Skyrim, &PathBuf::default(), &PathBuf::default())
+                .unwrap();
+
+        assert!(!settings.refresh_implicitly_active_plugins().unwrap());
+    }
+
+    #[test]
+    fn plugin_cache_path_should_be_none_by_default() {
+        let settings =
+            GameSettings::with_local_path(GameId::Skyrim, &PathBuf::default(), &PathBuf::default())
+                .unwrap();
+        assert!(settings.plugin_cache_path().is_none());
+    }
+
+    #[test]
+    fn set_plugin_cache_path_should_enable_and_disable_the_plugin_cache() {
+        let tmp_dir = tempdir().unwrap();
+        let cache_path = tmp_dir.path().join("cache");
+        let mut settings =
+            GameSettings::with_local_path(GameId::Skyrim, &PathBuf::default(), &PathBuf::default())
+                .unwrap();
+
+        settings.set_plugin_cache_path(Some(&cache_path)).unwrap();
+        assert_eq!(Some(cache_path.as_path()), settings.plugin_cache_path());
+        assert!(settings.plugin_cache().is_enabled());
+
+        settings.set_plugin_cache_path(None).unwrap();
+        assert!(settings.plugin_cache_path().is_none());
+        assert!(!settings.plugin_cache().is_enabled());
+    }
+
+    #[test]
+    fn set_plugin_cache_shared_should_replace_a_persistent_plugin_cache() {
+        let tmp_dir = tempdir().unwrap();
+        let mut settings =
+            GameSettings::with_local_path(GameId::Skyrim, &PathBuf::default(), &PathBuf::default())
+                .unwrap();
+
+        settings
+            .set_plugin_cache_path(Some(&tmp_dir.path().join("cache")))
+            .unwrap();
+        settings.set_plugin_cache_shared(true);
+        assert!(settings.is_plugin_cache_shared());
+        assert!(settings.plugin_cache_path().is_none());
+        assert!(settings.plugin_cache().is_enabled());
+
+        settings.set_plugin_cache_shared(false);
+        assert!(!settings.is_plugin_cache_shared());
+        assert!(!settings.plugin_cache().is_enabled());
+    }
+
+    #[test]
+    fn set_metrics_enabled_should_reset_recorded_metrics() {
+        let mut settings =
+            GameSettings::with_local_path(GameId::Skyrim, &PathBuf::default(), &PathBuf::default())
+                .unwrap();
+        assert!(!settings.is_metrics_enabled());
+
+        settings.set_metrics_enabled(true);
+        drop(settings.metrics_recorder().start(Phase::Load));
+        assert!(settings.is_metrics_enabled());
+        assert_eq!(1, settings.metrics().load.calls);
+
+        settings.set_metrics_enabled(true);
+        assert_eq!(0, settings.metrics().load.calls);
+
+        settings.set_metrics_enabled(false);
+        assert!(!settings.is_metrics_enabled());
+        assert_eq!(Metrics::default(), settings.metrics());
+    }
+
+    #[test]
+    fn write_durability_should_be_buffered_by_default() {
+        let settings =
+            GameSettings::with_local_path(GameId::Skyrim, &PathBuf::default(), &PathBuf::default())
+                .unwrap();
+        assert_eq!(WriteDurability::Buffered, settings.write_durability());
+    }
+
+    #[test]
+    fn io_concurrency_should_default_to_eight() {
+        let settings =
+            GameSettings::with_local_path(GameId::Skyrim, &PathBuf::default(), &PathBuf::default())
+                .unwrap();
+
+        assert_eq!(8, settings.io_concurrency());
+    }
+
+    #[test]
+    fn set_io_concurrency_should_treat_zero_as_one() {
+        let mut settings =
+            GameSettings::with_local_path(GameId::Skyrim, &PathBuf::default(), &PathBuf::default())
+                .unwrap();
+
+        settings.set_io_concurrency(0);
+        assert_eq!(1, settings.io_concurrency());
+
+        settings.set_io_concurrency(32);
+        assert_eq!(32, settings.io_concurrency());
+    }
+
+    #[test]
+    fn set_write_durability_should_set_the_write_durability() {
+        let mut settings =
+            GameSettings::with_local_path(GameId::Skyrim, &PathBuf::default(), &PathBuf::default())
+                .unwrap();
+
+        settings.set_write_durability(WriteDurability::SyncFile);
+        assert_eq!(WriteDurability::SyncFile, settings.write_durability());
+    }
+
     #[test]
     fn plugins_folder_should_be_a_child_of_the_game_path() {
         let settings =
@@ -28,15 +28,21 @@ extern crate regex;
 extern crate tempfile;
 extern crate unicase;
 
+mod atomic_file;
+mod case_insensitive;
 mod enums;
 mod game_settings;
 mod ghostable_path;
 mod load_order;
+mod metrics;
+mod parallelism;
 mod plugin;
+mod plugin_cache;
 #[cfg(test)]
 mod tests;
 
-pub use enums::{Error, GameId, LoadOrderMethod};
+pub use enums::{Error, GameId, LoadOrderMethod, LoadOrderViolation, WriteDurability};
 pub use game_settings::GameSettings;
-pub use load_order::ReadableLoadOrder;
+pub use load_order::{PluginChange, PluginState, ReadableLoadOrder};
 pub use load_order::WritableLoadOrder;
+pub use metrics::{Metrics, PhaseMetrics};
@@ -16,36 +16,47 @@
  * You should have received a copy of the GNU General Public License
  * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
  */
-use std::fs::File;
-use std::io::{BufWriter, Write};
+use std::collections::HashMap;
+use std::io::Write;
+use std::sync::Arc;
 
 use encoding::all::WINDOWS_1252;
 use encoding::{EncoderTrap, Encoding};
-use unicase::eq;
+use unicase::{eq, UniCase};
 
 use super::insertable::InsertableLoadOrder;
 use super::mutable::{read_plugin_names, MutableLoadOrder};
+use super::plugin_list::PluginList;
 use super::readable::{
-    active_plugin_names, index_of, is_active, plugin_at, plugin_names, ReadableLoadOrder,
-    ReadableLoadOrderExt,
+    active_plugin_names, index_of, is_active, plugin_at, plugin_names, plugin_states, PluginState,
+    ReadableLoadOrder, ReadableLoadOrderExt,
 };
+use super::pending::{PluginChange, SavedState};
+use super::snapshot::FileSnapshot;
 use super::writable::{activate, deactivate, set_active_plugins, WritableLoadOrder};
-use super::{create_parent_dirs, find_first_non_master_position};
-use enums::Error;
+use super::PreviousPlugins;
+use atomic_file::write_file;
+use enums::{Error, LoadOrderViolation};
 use game_settings::GameSettings;
+use metrics::Phase;
 use plugin::Plugin;
 
 #[derive(Clone, Debug)]
 pub struct AsteriskBasedLoadOrder {
     game_settings: GameSettings,
-    plugins: Vec<Plugin>,
+    // Shared between copies of the load order until one of them changes it.
+    plugins: Arc<PluginList>,
+    snapshot: FileSnapshot,
+    saved: SavedState,
 }
 
 impl AsteriskBasedLoadOrder {
     pub fn new(game_settings: GameSettings) -> Self {
         Self {
             game_settings,
-            plugins: Vec::new(),
+            plugins: Arc::default(),
+            snapshot: FileSnapshot::default(),
+            saved: SavedState::default(),
         }
     }
 }
@@ -74,17 +85,21 @@ impl ReadableLoadOrder for AsteriskBasedLoadOrder {
     fn is_active(&self, plugin_name: &str) -> bool {
         is_active(self.plugins(), plugin_name)
     }
+
+    fn plugin_states<'a>(&'a self) -> Vec<PluginState<'a>> {
+        plugin_states(self.plugins())
+    }
 }
 
 impl ReadableLoadOrderExt for AsteriskBasedLoadOrder {
-    fn plugins(&self) -> &Vec<Plugin> {
+    fn plugins(&self) -> &PluginList {
         &self.plugins
     }
 }
 
 impl MutableLoadOrder for AsteriskBasedLoadOrder {
-    fn plugins_mut(&mut self) -> &mut Vec<Plugin> {
-        &mut self.plugins
+    fn plugins_mut(&mut self) -> &mut PluginList {
+        Arc::make_mut(&mut self.plugins)
     }
 }
 
@@ -110,7 +125,7 @@ impl InsertableLoadOrder for AsteriskBasedLoadOrder {
         if plugin.is_master_file()
             || (plugin.is_light_master_file() && !plugin.name().to_lowercase().ends_with(".esp"))
         {
-            find_first_non_master_position(self.plugins())
+            self.plugins().first_non_master_position()
         } else {
             None
         }
@@ -118,40 +133,65 @@ impl InsertableLoadOrder for AsteriskBasedLoadOrder {
 }
 
 impl WritableLoadOrder for AsteriskBasedLoadOrder {
-    fn load(&mut self) -> Result<(), Error> {
-        self.plugins_mut().clear();
+    fn boxed_clone(&self) -> Box<WritableLoadOrder> {
+        Box::new(self.clone())
+    }
 
-        let plugin_tuples = self.read_from_active_plugins_file()?;
-        let filenames = self.find_plugins_in_dir_sorted();
+    fn game_settings_mut(&mut self) -> &mut GameSettings {
+        &mut self.game_settings
+    }
 
-        self.load_unique_plugins(plugin_tuples, filenames);
+    fn load(&mut self) -> Result<(), Error> {
+        self.plugins_mut().clear();
 
-        self.add_implicitly_active_plugins()?;
+        self.load_with_previous_plugins(&PreviousPlugins::default())
+    }
 
-        self.deactivate_excess_plugins();
+    fn refresh(&mut self) -> Result<(), Error> {
+        let previous_plugins = self.take_plugins();
 
-        Ok(())
+        self.load_with_previous_plugins(&previous_plugins)
     }
 
     fn save(&mut self) -> Result<(), Error> {
-        create_parent_dirs(self.game_settings().active_plugins_file())?;
+        let _timer = self.game_settings().metrics_recorder().start(Phase::Save);
 
-        let file = File::create(self.game_settings().active_plugins_file())?;
-        let mut writer = BufWriter::new(file);
+        // Nothing needs to be written if the load order hasn't changed since
+        // it was saved and the files it was saved to haven't changed either.
+        if self.saved.is_saved(self.plugins()) && !self.is_stale() {
+            return Ok(());
+        }
+
+        let mut content: Vec<u8> = Vec::new();
         for plugin in self.plugins() {
             if self.game_settings().is_implicitly_active(plugin.name()) {
                 continue;
             }
 
             if plugin.is_active() {
-                write!(writer, "*")?;
+                write!(content, "*")?;
             }
-            writer.write_all(&WINDOWS_1252
+            content.write_all(&WINDOWS_1252
                 .encode(plugin.name(), EncoderTrap::Strict)
                 .map_err(Error::EncodeError)?)?;
-            writeln!(writer)?;
+            writeln!(content)?;
+        }
+
+        {
+            let _timer = self.game_settings()
+                .metrics_recorder()
+                .start(Phase::WritePluginLists);
+            write_file(
+                self.game_settings().active_plugins_file(),
+                &content,
+                self.game_settings().write_durability(),
+                self.game_settings().metrics_recorder(),
+            )?;
         }
 
+        self.snapshot.update_saved_files(&self.game_settings);
+        self.saved = SavedState::saved(self.plugins());
+
         Ok(())
     }
 
@@ -162,23 +202,30 @@ impl WritableLoadOrder for AsteriskBasedLoadOrder {
 
         // Check that all implicitly active plugins that are present load in
         // their hardcoded order.
-        let mut missing_plugins_count = 0;
-        for (i, plugin_name) in self.game_settings()
-            .implicitly_active_plugins()
-            .iter()
-            .enumerate()
-        {
-            match plugin_names.iter().position(|n| eq(*n, plugin_name)) {
-                Some(pos) => if pos != i - missing_plugins_count {
-                    return Err(Error::GameMasterMustLoadFirst);
-                },
-                None => missing_plugins_count += 1,
-            }
+        if !implicitly_active_plugins_out_of_order(self.game_settings(), plugin_names).is_empty() {
+            return Err(Error::GameMasterMustLoadFirst);
         }
 
         self.replace_plugins(plugin_names)
     }
 
+    fn validate_load_order(&self, plugin_names: &[&str]) -> Vec<LoadOrderViolation> {
+        let mut violations = Vec::new();
+        if plugin_names.is_empty() || !eq(plugin_names[0], self.game_settings().master_file()) {
+            violations.push(LoadOrderViolation::GameMasterNotFirst);
+        }
+
+        violations.extend(
+            implicitly_active_plugins_out_of_order(self.game_settings(), plugin_names)
+                .into_iter()
+                .map(LoadOrderViolation::ImplicitlyActivePluginOutOfOrder),
+        );
+
+        violations.extend(self.find_load_order_violations(plugin_names));
+
+        violations
+    }
+
     fn set_plugin_index(&mut self, plugin_name: &str, position: usize) -> Result<(), Error> {
         if position != 0
             && !self.plugins().is_empty()
@@ -197,6 +244,14 @@ impl WritableLoadOrder for AsteriskBasedLoadOrder {
         Ok(true)
     }
 
+    fn pending_changes<'a>(&'a self) -> Vec<PluginChange<'a>> {
+        self.saved.changes(self.plugins())
+    }
+
+    fn is_stale(&self) -> bool {
+        self.snapshot.is_stale()
+    }
+
     fn activate(&mut self, plugin_name: &str) -> Result<(), Error> {
         activate(self, plugin_name)
     }
@@ -211,7 +266,39 @@ impl WritableLoadOrder for AsteriskBasedLoadOrder {
 }
 
 impl AsteriskBasedLoadOrder {
+    fn load_with_previous_plugins(
+        &mut self,
+        previous_plugins: &PreviousPlugins,
+    ) -> Result<(), Error> {
+        let _timer = self.game_settings().metrics_recorder().start(Phase::Load);
+
+        self.game_settings_mut().refresh_implicitly_active_plugins()?;
+        self.snapshot = FileSnapshot::new(self.game_settings());
+
+        let plugin_tuples = self.read_from_active_plugins_file()?;
+        let files = self.find_plugins_in_dir_sorted();
+
+        self.load_unique_plugins(plugin_tuples, files, previous_plugins);
+
+        self.add_implicitly_active_plugins()?;
+
+        self.deactivate_excess_plugins();
+
+        let game_settings = self.game_settings();
+        game_settings
+            .plugin_cache()
+            .flush(game_settings.metrics_recorder());
+
+        self.saved = SavedState::loaded(self.plugins());
+
+        Ok(())
+    }
+
     fn read_from_active_plugins_file(&self) -> Result<Vec<(String, bool)>, Error> {
+        let _timer = self.game_settings()
+            .metrics_recorder()
+            .start(Phase::ReadPluginLists);
+
         read_plugin_names(
             self.game_settings().active_plugins_file(),
             plugin_line_mapper,
@@ -219,6 +306,35 @@ impl AsteriskBasedLoadOrder {
     }
 }
 
+/// Gets the positions of the implicitly active plugins in the given load
+/// order that don't load in their hardcoded order before all other plugins.
+fn implicitly_active_plugins_out_of_order(
+    game_settings: &GameSettings,
+    plugin_names: &[&str],
+) -> Vec<usize> {
+    let mut positions: HashMap<UniCase<&str>, usize> = HashMap::new();
+    for (i, plugin_name) in plugin_names.iter().enumerate() {
+        positions.entry(UniCase::new(*plugin_name)).or_insert(i);
+    }
+
+    let mut out_of_order = Vec::new();
+    let mut missing_plugins_count = 0;
+    for (i, plugin_name) in game_settings
+        .implicitly_active_plugins()
+        .iter()
+        .enumerate()
+    {
+        match positions.get(&UniCase::new(plugin_name.as_str())) {
+            Some(&pos) => if pos != i - missing_plugins_count {
+                out_of_order.push(pos);
+            },
+            None => missing_plugins_count += 1,
+        }
+    }
+
+    out_of_order
+}
+
 fn plugin_line_mapper(line: &str) -> Option<(String, bool)> {
     if line.is_empty() || line.starts_with('#') {
         None
@@ -236,7 +352,7 @@ mod tests {
     use enums::GameId;
     use filetime::{set_file_times, FileTime};
     use load_order::tests::*;
-    use std::fs::{remove_dir_all, File};
+    use std::fs::{remove_dir_all, remove_file, File};
     use std::io;
     use std::io::{BufRead, BufReader};
     use std::path::Path;
@@ -247,7 +363,9 @@ mod tests {
         let (game_settings, plugins) = mock_game_files(game_id, game_dir);
         AsteriskBasedLoadOrder {
             game_settings,
-            plugins,
+            plugins: Arc::new(plugins),
+            snapshot: FileSnapshot::default(),
+            saved: SavedState::default(),
         }
     }
 
@@ -677,6 +795,76 @@ mod tests {
         assert_eq!(expected_filenames, load_order.plugin_names());
     }
 
+    #[test]
+    fn refresh_should_reread_modified_plugins() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::SkyrimSE, &tmp_dir.path());
+        load_order.load().unwrap();
+
+        let index = load_order.index_of("Blank.esp").unwrap();
+        assert!(!load_order.plugins()[index].is_master_file());
+        copy_to_test_dir("Blank.esm", "Blank.esp", &load_order.game_settings());
+        let plugin_path = load_order
+            .game_settings()
+            .plugins_directory()
+            .join("Blank.esp");
+        set_file_times(&plugin_path, FileTime::zero(), FileTime::zero()).unwrap();
+
+        load_order.refresh().unwrap();
+
+        let index = load_order.index_of("Blank.esp").unwrap();
+        assert!(load_order.plugins()[index].is_master_file());
+    }
+
+    #[test]
+    fn refresh_should_reuse_unmodified_plugins() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::SkyrimSE, &tmp_dir.path());
+        load_order.load().unwrap();
+
+        let plugin_path = load_order
+            .game_settings()
+            .plugins_directory()
+            .join("Blank.esm");
+        let mtime = plugin_path.metadata().unwrap().modified().unwrap();
+        copy_to_test_dir("Blank.esp", "Blank.esm", &load_order.game_settings());
+        set_file_times(
+            &plugin_path,
+            FileTime::zero(),
+            FileTime::from_system_time(mtime),
+        ).unwrap();
+
+        load_order.refresh().unwrap();
+
+        let index = load_order.index_of("Blank.esm").unwrap();
+        assert!(load_order.plugins()[index].is_master_file());
+    }
+
+    #[test]
+    fn refresh_should_add_new_plugins_and_remove_deleted_plugins() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::SkyrimSE, &tmp_dir.path());
+        load_order.load().unwrap();
+
+        assert!(load_order.index_of("Blank - Different.esm").is_none());
+        copy_to_test_dir(
+            "Blank - Different.esm",
+            "Blank - Different.esm",
+            &load_order.game_settings(),
+        );
+        remove_file(
+            load_order
+                .game_settings()
+                .plugins_directory()
+                .join("Blank - Different.esp"),
+        ).unwrap();
+
+        load_order.refresh().unwrap();
+
+        assert!(load_order.index_of("Blank - Different.esm").is_some());
+        assert!(load_order.index_of("Blank - Different.esp").is_none());
+    }
+
     #[test]
     fn save_should_create_active_plugins_file_parent_directory_if_it_does_not_exist() {
         let tmp_dir = tempdir().unwrap();
@@ -868,6 +1056,52 @@ mod tests {
         assert!(load_order.is_active("Blank.esp"));
     }
 
+    #[test]
+    fn validate_load_order_should_return_no_violations_for_a_valid_load_order() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::SkyrimSE, &tmp_dir.path());
+        load_order.load().unwrap();
+
+        let filenames = vec![
+            "Skyrim.esm",
+            "Blank.esm",
+            "Blank.esp",
+            "Blank - Master Dependent.esp",
+        ];
+
+        assert!(load_order.validate_load_order(&filenames).is_empty());
+    }
+
+    #[test]
+    fn validate_load_order_should_return_all_violations() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::SkyrimSE, &tmp_dir.path());
+
+        copy_to_test_dir("Blank.esm", "Update.esm", &load_order.game_settings());
+        load_order.load().unwrap();
+
+        let filenames = vec![
+            "Blank.esp",
+            "Skyrim.esm",
+            "Update.esm",
+            "blank.esp",
+            "missing.esp",
+        ];
+
+        assert_eq!(
+            vec![
+                LoadOrderViolation::GameMasterNotFirst,
+                LoadOrderViolation::ImplicitlyActivePluginOutOfOrder(1),
+                LoadOrderViolation::ImplicitlyActivePluginOutOfOrder(2),
+                LoadOrderViolation::NonMasterBeforeMaster(1),
+                LoadOrderViolation::NonMasterBeforeMaster(2),
+                LoadOrderViolation::DuplicatePlugin(3),
+                LoadOrderViolation::UnknownPlugin(4),
+            ],
+            load_order.validate_load_order(&filenames)
+        );
+    }
+
     #[test]
     fn set_plugin_index_should_error_if_setting_the_game_master_index_to_non_zero_in_bounds() {
         let tmp_dir = tempdir().unwrap();
@@ -899,6 +1133,18 @@ mod tests {
         assert_eq!(num_plugins + 1, load_order.plugins().len());
     }
 
+    #[test]
+    fn is_stale_should_be_true_if_the_active_plugins_file_has_changed_since_loading() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::SkyrimSE, &tmp_dir.path());
+        load_order.load().unwrap();
+        assert!(!load_order.is_stale());
+
+        write_active_plugins_file(load_order.game_settings(), &["Blank.esp", "Blank.esm"]);
+
+        assert!(load_order.is_stale());
+    }
+
     #[test]
     fn is_self_consistent_should_return_true() {
         let tmp_dir = tempdir().unwrap();
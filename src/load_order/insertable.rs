@@ -16,13 +16,17 @@
  * You should have received a copy of the GNU General Public License
  * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
  */
-use std::collections::HashSet;
+use std::collections::{HashMap, HashSet};
 
 use rayon::prelude::*;
 
 use super::mutable::MutableLoadOrder;
+use super::plugin_list::borrowed_key;
+use super::PreviousPlugins;
+use case_insensitive::CaseInsensitiveStr;
 use enums::Error;
-use plugin::{trim_dot_ghost, Plugin};
+use metrics::Phase;
+use plugin::{Plugin, PluginFile};
 
 pub trait InsertableLoadOrder: MutableLoadOrder {
     fn insert_position(&self, plugin: &Plugin) -> Option<usize>;
@@ -57,17 +61,41 @@ pub trait InsertableLoadOrder: MutableLoadOrder {
     fn load_unique_plugins(
         &mut self,
         plugin_name_tuples: Vec<(String, bool)>,
-        installed_filenames: Vec<String>,
+        installed_files: Vec<PluginFile>,
+        previous_plugins: &PreviousPlugins,
     ) {
+        let _timer = self.game_settings()
+            .metrics_recorder()
+            .start(Phase::LoadPlugins);
+
         let plugins: Vec<Plugin> = {
             let game_settings = self.game_settings();
-
-            remove_duplicates_icase(plugin_name_tuples, installed_filenames)
-                .into_par_iter()
-                .filter_map(|(filename, active)| {
-                    Plugin::with_active(&filename, game_settings, active).ok()
-                })
-                .collect()
+            let files: HashMap<&CaseInsensitiveStr, &PluginFile> = installed_files
+                .iter()
+                .map(|f| (borrowed_key(&f.filename), f))
+                .collect();
+
+            let plugin_name_tuples =
+                remove_duplicates_icase(&plugin_name_tuples, &installed_files);
+            let parallelism = game_settings.parallelism();
+
+            parallelism.install(|| {
+                plugin_name_tuples
+                    .into_par_iter()
+                    .with_min_len(parallelism.sequential_threshold())
+                    .filter_map(|(filename, active)| {
+                        let previous = previous_plugins.get(filename);
+                        match files.get(borrowed_key(filename)) {
+                            Some(file) => {
+                                Plugin::from_file(filename, file, game_settings, active, previous)
+                            }
+                            None => {
+                                Plugin::with_previous(filename, game_settings, active, previous)
+                            }
+                        }.ok()
+                    })
+                    .collect()
+            })
         };
 
         for plugin in plugins {
@@ -91,25 +119,25 @@ pub trait InsertableLoadOrder: MutableLoadOrder {
     }
 }
 
-fn remove_duplicates_icase(
-    plugin_tuples: Vec<(String, bool)>,
-    filenames: Vec<String>,
-) -> Vec<(String, bool)> {
-    let mut set: HashSet<String> = HashSet::with_capacity(filenames.len());
+fn remove_duplicates_icase<'a>(
+    plugin_tuples: &'a [(String, bool)],
+    files: &'a [PluginFile],
+) -> Vec<(&'a str, bool)> {
+    let mut set: HashSet<&CaseInsensitiveStr> =
+        HashSet::with_capacity(plugin_tuples.len() + files.len());
 
-    let mut unique_tuples: Vec<(String, bool)> = plugin_tuples
-        .into_iter()
+    let mut unique_tuples: Vec<(&str, bool)> = plugin_tuples
+        .iter()
         .rev()
-        .filter(|&(ref string, _)| set.insert(trim_dot_ghost(&string).to_lowercase()))
+        .filter(|&&(ref string, _)| set.insert(borrowed_key(string)))
+        .map(|&(ref string, active)| (string.as_str(), active))
         .collect();
-
     unique_tuples.reverse();
 
-    let unique_file_tuples_iter = filenames
-        .into_iter()
-        .filter(|ref string| set.insert(trim_dot_ghost(&string).to_lowercase()))
-        .map(|f| (f, false));
-
+    let unique_file_tuples_iter = files
+        .iter()
+        .filter(|f| set.insert(borrowed_key(&f.filename)))
+        .map(|f| (f.filename.as_str(), false));
     unique_tuples.extend(unique_file_tuples_iter);
 
     unique_tuples
@@ -119,17 +147,17 @@ fn activate_unvalidated<T: InsertableLoadOrder + ?Sized>(
     load_order: &mut T,
     filename: &str,
 ) -> Result<(), Error> {
-    let index = {
-        let index = load_order.index_of(filename);
-        if index.is_none() && Plugin::is_valid(&filename, load_order.game_settings()) {
-            Some(load_order.add_to_load_order(filename)?)
-        } else {
-            index
-        }
+    // Creating the plugin also checks that it's valid, which avoids reading
+    // its header twice.
+    let index = match load_order.index_of(filename) {
+        Some(x) => Some(x),
+        None => Plugin::new(filename, load_order.game_settings())
+            .ok()
+            .map(|plugin| load_order.insert(plugin)),
     };
 
     if let Some(x) = index {
-        load_order.plugins_mut()[x].activate()?;
+        load_order.plugins_mut().activate(x)?;
     }
 
     Ok(())
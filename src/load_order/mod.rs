@@ -20,7 +20,10 @@
 mod asterisk_based;
 mod insertable;
 mod mutable;
+mod pending;
+mod plugin_list;
 mod readable;
+mod snapshot;
 #[cfg(test)]
 mod tests;
 mod textfile_based;
@@ -32,19 +35,32 @@ use std::path::Path;
 
 use enums::Error;
 pub use load_order::asterisk_based::AsteriskBasedLoadOrder;
-pub use load_order::readable::ReadableLoadOrder;
+pub use load_order::pending::PluginChange;
+pub use load_order::readable::{PluginState, ReadableLoadOrder};
 pub use load_order::textfile_based::TextfileBasedLoadOrder;
 pub use load_order::timestamp_based::TimestampBasedLoadOrder;
 pub use load_order::writable::WritableLoadOrder;
+use load_order::plugin_list::PluginList;
 use plugin::Plugin;
 
+/// Plugins from a previous load, which can be reused when loading again
+/// if their files have not changed.
+#[derive(Default)]
+pub struct PreviousPlugins(PluginList);
+
+impl PreviousPlugins {
+    fn get(&self, filename: &str) -> Option<&Plugin> {
+        self.0.find(filename)
+    }
+}
+
 fn find_first_non_master_position(plugins: &[Plugin]) -> Option<usize> {
     plugins
         .iter()
         .position(|p| !p.is_master_file() && !p.is_light_master_file())
 }
 
-fn create_parent_dirs(path: &Path) -> Result<(), Error> {
+pub fn create_parent_dirs(path: &Path) -> Result<(), Error> {
     if let Some(x) = path.parent() {
         if !x.exists() {
             create_dir_all(x)?
@@ -17,27 +17,35 @@
  * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
  */
 
+use std::borrow::Cow;
+use std::cmp::min;
 use std::collections::HashSet;
 use std::fs::File;
 use std::io::Read;
 use std::mem;
 use std::path::Path;
+use std::str;
 
 use encoding::all::WINDOWS_1252;
 use encoding::{DecoderTrap, Encoding};
 use rayon::prelude::*;
+use unicase::UniCase;
 
 use super::find_first_non_master_position;
+use super::plugin_list::PluginList;
 use super::readable::ReadableLoadOrderExt;
+use super::PreviousPlugins;
 use enums::Error;
+use metrics::Phase;
+use parallelism::Parallelism;
 use plugin::Plugin;
 
 pub trait MutableLoadOrder: ReadableLoadOrderExt {
-    fn plugins_mut(&mut self) -> &mut Vec<Plugin>;
+    fn plugins_mut(&mut self) -> &mut PluginList;
 
     fn deactivate_excess_plugins(&mut self) {
         for index in self.get_excess_active_plugin_indices() {
-            self.plugins_mut()[index].deactivate();
+            self.plugins_mut().deactivate(index);
         }
     }
 
@@ -50,31 +58,39 @@ pub trait MutableLoadOrder: ReadableLoadOrderExt {
             if x == position {
                 return Ok(());
             }
-        }
 
-        let plugin = get_plugin_to_insert_at(self, plugin_name, position)?;
+            let is_master = self.plugins()[x].is_master_file();
+            self.validate_index(position, is_master)?;
 
-        if position >= self.plugins().len() {
-            self.plugins_mut().push(plugin);
+            let last_position = self.plugins().len() - 1;
+            self.plugins_mut()
+                .move_plugin(x, min(position, last_position));
         } else {
+            let plugin = Plugin::new(plugin_name, self.game_settings())
+                .map_err(|_| Error::InvalidPlugin(plugin_name.to_string()))?;
+
+            self.validate_index(position, plugin.is_master_file())?;
+
             self.plugins_mut().insert(position, plugin);
         }
 
         Ok(())
     }
 
+    fn take_plugins(&mut self) -> PreviousPlugins {
+        PreviousPlugins(mem::replace(self.plugins_mut(), PluginList::default()))
+    }
+
     fn deactivate_all(&mut self) {
-        for plugin in self.plugins_mut() {
-            plugin.deactivate();
-        }
+        self.plugins_mut().deactivate_all();
     }
 
     fn replace_plugins(&mut self, plugin_names: &[&str]) -> Result<(), Error> {
-        if !are_plugin_names_unique(plugin_names) {
+        if !are_plugin_names_unique(plugin_names, self.game_settings().parallelism()) {
             return Err(Error::DuplicatePlugin);
         }
 
-        let mut plugins = match self.map_to_plugins(plugin_names) {
+        let plugins = match self.map_to_plugins(plugin_names) {
             Err(x) => return Err(Error::InvalidPlugin(x.to_string())),
             Ok(x) => x,
         };
@@ -83,7 +99,7 @@ pub trait MutableLoadOrder: ReadableLoadOrderExt {
             return Err(Error::NonMasterBeforeMaster);
         }
 
-        mem::swap(&mut plugins, self.plugins_mut());
+        *self.plugins_mut() = PluginList::from(plugins);
 
         Ok(())
     }
@@ -94,23 +110,34 @@ where
     T: MutableLoadOrder,
     F: Fn(&str) -> Option<String> + Send + Sync,
 {
-    load_order.deactivate_all();
+    let metrics = load_order.game_settings().metrics_recorder().clone();
+    let _timer = metrics.start(Phase::LoadActivePlugins);
 
-    let plugin_names = read_plugin_names(
-        load_order.game_settings().active_plugins_file(),
-        line_mapper,
-    )?;
+    load_order.deactivate_all();
 
-    let plugin_indices: Vec<usize> = plugin_names
-        .par_iter()
-        .filter_map(|p| load_order.index_of(p))
-        .collect();
+    let plugin_names = {
+        let _timer = metrics.start(Phase::ReadPluginLists);
+        read_plugin_names(
+            load_order.game_settings().active_plugins_file(),
+            line_mapper,
+        )?
+    };
 
-    for index in plugin_indices {
-        load_order.plugins_mut()[index].activate()?;
-    }
+    let plugin_indices: Vec<usize> = {
+        let parallelism = load_order.game_settings().parallelism();
+        parallelism.install(|| {
+            plugin_names
+                .par_iter()
+                .with_min_len(parallelism.sequential_threshold())
+                .filter_map(|p| load_order.index_of(p))
+                .collect()
+        })
+    };
 
-    Ok(())
+    let io_concurrency = load_order.game_settings().io_concurrency();
+    load_order
+        .plugins_mut()
+        .activate_all(&plugin_indices, io_concurrency)
 }
 
 pub fn read_plugin_names<F, T>(file_path: &Path, line_mapper: F) -> Result<Vec<T>, Error>
@@ -118,52 +145,82 @@ where
     F: Fn(&str) -> Option<T> + Send + Sync,
     T: Send,
 {
+    match read_plugins_file(file_path)? {
+        Some(content) => map_windows_1252_lines(&content, line_mapper),
+        None => Ok(Vec::new()),
+    }
+}
+
+/// Reads the content of a file that lists plugins, or returns `None` if it
+/// doesn't exist.
+pub fn read_plugins_file(file_path: &Path) -> Result<Option<Vec<u8>>, Error> {
     if !file_path.exists() {
-        return Ok(Vec::new());
+        return Ok(None);
     }
 
     let mut content: Vec<u8> = Vec::new();
     let mut file = File::open(file_path)?;
     file.read_to_end(&mut content)?;
 
-    let content = WINDOWS_1252
-        .decode(&content, DecoderTrap::Strict)
-        .map_err(Error::DecodeError)?;
-
-    Ok(content.lines().filter_map(line_mapper).collect())
+    Ok(Some(content))
 }
 
-pub fn plugin_line_mapper(line: &str) -> Option<String> {
-    if line.is_empty() || line.starts_with('#') {
-        None
-    } else {
-        Some(line.to_owned())
+/// Maps each line of Windows-1252 encoded content, decoding only the lines
+/// that are not ASCII, so that `line_mapper` is usually given a slice of the
+/// content itself.
+pub fn map_windows_1252_lines<F, T>(content: &[u8], line_mapper: F) -> Result<Vec<T>, Error>
+where
+    F: Fn(&str) -> Option<T>,
+{
+    let mut mapped = Vec::new();
+    for line in split_lines(content) {
+        let line = decode_windows_1252(line)?;
+        mapped.extend(line_mapper(&line));
     }
+
+    Ok(mapped)
 }
 
-fn get_plugin_to_insert_at<T: MutableLoadOrder + ?Sized>(
-    load_order: &mut T,
-    plugin_name: &str,
-    insert_position: usize,
-) -> Result<Plugin, Error> {
-    if let Some(p) = load_order.index_of(plugin_name) {
-        let is_master = load_order.plugins()[p].is_master_file();
-        load_order.validate_index(insert_position, is_master)?;
+/// Splits content into lines in the same way as `str::lines()`, without
+/// needing it to be decoded first.
+pub fn split_lines<'a>(content: &'a [u8]) -> impl Iterator<Item = &'a [u8]> {
+    let content = content.strip_suffix(b"\n").unwrap_or(content);
 
-        Ok(load_order.plugins_mut().remove(p))
-    } else {
-        let plugin = Plugin::new(plugin_name, load_order.game_settings())
-            .map_err(|_| Error::InvalidPlugin(plugin_name.to_string()))?;
+    content
+        .split(|b| *b == b'\n')
+        .map(|line| line.strip_suffix(b"\r").unwrap_or(line))
+}
 
-        load_order.validate_index(insert_position, plugin.is_master_file())?;
+fn decode_windows_1252<'a>(bytes: &'a [u8]) -> Result<Cow<'a, str>, Error> {
+    // ASCII is a subset of both Windows-1252 and UTF-8, so needs no decoding.
+    if bytes.is_ascii() {
+        if let Ok(string) = str::from_utf8(bytes) {
+            return Ok(Cow::Borrowed(string));
+        }
+    }
 
-        Ok(plugin)
+    WINDOWS_1252
+        .decode(bytes, DecoderTrap::Strict)
+        .map(Cow::Owned)
+        .map_err(Error::DecodeError)
+}
+
+pub fn plugin_line_mapper(line: &str) -> Option<String> {
+    if line.is_empty() || line.starts_with('#') {
+        None
+    } else {
+        Some(line.to_owned())
     }
 }
 
-fn are_plugin_names_unique(plugin_names: &[&str]) -> bool {
-    let unique_plugin_names: HashSet<String> =
-        plugin_names.par_iter().map(|s| s.to_lowercase()).collect();
+fn are_plugin_names_unique(plugin_names: &[&str], parallelism: &Parallelism) -> bool {
+    let unique_plugin_names: HashSet<UniCase<&str>> = parallelism.install(|| {
+        plugin_names
+            .par_iter()
+            .with_min_len(parallelism.sequential_threshold())
+            .map(|s| UniCase::new(*s))
+            .collect()
+    });
 
     unique_plugin_names.len() == plugin_names.len()
 }
@@ -178,3 +235,25 @@ fn is_partitioned_by_master_flag(plugins: &[Plugin]) -> bool {
         Some(master_pos) => master_pos < plugin_pos,
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn split_lines_should_split_content_in_the_same_way_as_str_lines() {
+        let content = "Blank.esm\r\n\r\nBlank.esp\n# Comment\nBlank - Different.esp\n";
+        let lines: Vec<&[u8]> = split_lines(content.as_bytes()).collect();
+        let expected: Vec<&[u8]> = content.lines().map(str::as_bytes).collect();
+
+        assert_eq!(expected, lines);
+    }
+
+    #[test]
+    fn map_windows_1252_lines_should_borrow_ascii_lines_and_decode_other_lines() {
+        let content = b"Blank.esm\nBl\xe0nk.esp\n";
+        let lines = map_windows_1252_lines(content, plugin_line_mapper).unwrap();
+
+        assert_eq!(vec!["Blank.esm", "Blànk.esp"], lines);
+    }
+}
@@ -0,0 +1,284 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+use std::collections::HashMap;
+use std::sync::Arc;
+
+use unicase::UniCase;
+
+use super::plugin_list::PluginList;
+
+/// A plugin whose presence, position or active state differs from when the
+/// load order was last loaded or saved.
+///
+/// A plugin is moved if it is one of the fewest plugins that would need to be
+/// moved to turn the previous load order into the current one, so moving one
+/// plugin only reports that plugin, not all the plugins it shifted. Added
+/// plugins are activated if they are active, and removed plugins are only
+/// reported as removed.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct PluginChange<'a> {
+    pub name: &'a str,
+    pub is_added: bool,
+    pub is_removed: bool,
+    pub is_moved: bool,
+    pub is_activated: bool,
+    pub is_deactivated: bool,
+}
+
+/// The plugins and their active states as they were when the load order was
+/// last loaded or saved.
+#[derive(Clone, Debug, Default)]
+pub struct SavedState {
+    // Shared so that copying a load order doesn't copy the saved state.
+    plugins: Arc<Vec<(Arc<str>, bool)>>,
+    // Loading may change the load order to make it valid, so only saving
+    // gives a state that is known to match what's on disk.
+    is_on_disk: bool,
+}
+
+impl SavedState {
+    pub fn loaded(plugins: &PluginList) -> SavedState {
+        SavedState {
+            plugins: Arc::new(record(plugins)),
+            is_on_disk: false,
+        }
+    }
+
+    pub fn saved(plugins: &PluginList) -> SavedState {
+        SavedState {
+            plugins: Arc::new(record(plugins)),
+            is_on_disk: true,
+        }
+    }
+
+    /// Checks whether the given plugins are the ones that were last saved,
+    /// in the same order and with the same active states.
+    pub fn is_saved(&self, plugins: &PluginList) -> bool {
+        self.is_on_disk
+            && self.plugins.len() == plugins.len()
+            && self.plugins
+                .iter()
+                .zip(plugins.iter())
+                .all(|(&(ref name, active), p)| p.is_active() == active && **name == *p.name())
+    }
+
+    pub fn changes<'a>(&'a self, plugins: &'a PluginList) -> Vec<PluginChange<'a>> {
+        let mut previous: HashMap<UniCase<&str>, usize> =
+            HashMap::with_capacity(self.plugins.len());
+        for (index, &(ref name, _)) in self.plugins.iter().enumerate() {
+            previous.entry(UniCase::new(&**name)).or_insert(index);
+        }
+
+        let mut changes = Vec::new();
+        let mut is_kept = vec![false; self.plugins.len()];
+        let mut kept_changes = Vec::new();
+        let mut kept_previous_indices = Vec::new();
+
+        for plugin in plugins.iter() {
+            let mut change = PluginChange {
+                name: plugin.name(),
+                ..PluginChange::default()
+            };
+
+            match previous.get(&UniCase::new(plugin.name())) {
+                Some(&index) if !is_kept[index] => {
+                    is_kept[index] = true;
+                    let was_active = self.plugins[index].1;
+                    change.is_activated = plugin.is_active() && !was_active;
+                    change.is_deactivated = !plugin.is_active() && was_active;
+                    kept_changes.push(changes.len());
+                    kept_previous_indices.push(index);
+                }
+                _ => {
+                    change.is_added = true;
+                    change.is_activated = plugin.is_active();
+                }
+            }
+
+            changes.push(change);
+        }
+
+        let is_in_order = longest_increasing_subsequence(&kept_previous_indices);
+        for (&change_index, is_in_order) in kept_changes.iter().zip(is_in_order) {
+            changes[change_index].is_moved = !is_in_order;
+        }
+
+        changes.retain(|c| c.is_added || c.is_moved || c.is_activated || c.is_deactivated);
+
+        for (&(ref name, _), _) in self.plugins.iter().zip(is_kept).filter(|&(_, k)| !k) {
+            changes.push(PluginChange {
+                name: &**name,
+                is_removed: true,
+                ..PluginChange::default()
+            });
+        }
+
+        changes
+    }
+}
+
+fn record(plugins: &PluginList) -> Vec<(Arc<str>, bool)> {
+    plugins
+        .iter()
+        .map(|p| (p.shared_name(), p.is_active()))
+        .collect()
+}
+
+/// Marks the values that are part of a longest strictly increasing
+/// subsequence of the given values, in O(n log n) time.
+fn longest_increasing_subsequence(values: &[usize]) -> Vec<bool> {
+    // tails[k] is the index of the smallest value that ends an increasing
+    // subsequence of length k + 1.
+    let mut tails: Vec<usize> = Vec::new();
+    let mut predecessors: Vec<Option<usize>> = Vec::with_capacity(values.len());
+
+    for (index, value) in values.iter().enumerate() {
+        let length = match tails.binary_search_by(|&t| values[t].cmp(value)) {
+            Ok(x) | Err(x) => x,
+        };
+
+        predecessors.push(if length > 0 {
+            Some(tails[length - 1])
+        } else {
+            None
+        });
+
+        if length == tails.len() {
+            tails.push(index);
+        } else {
+            tails[length] = index;
+        }
+    }
+
+    let mut is_in_subsequence = vec![false; values.len()];
+    let mut current = tails.last().cloned();
+    while let Some(index) = current {
+        is_in_subsequence[index] = true;
+        current = predecessors[index];
+    }
+
+    is_in_subsequence
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    use std::path::Path;
+
+    use tempfile::tempdir;
+
+    use enums::GameId;
+    use game_settings::GameSettings;
+    use load_order::tests::mock_game_files;
+    use plugin::Plugin;
+    use tests::copy_to_test_dir;
+
+    fn names<'a>(changes: &[PluginChange<'a>], filter: fn(&PluginChange) -> bool) -> Vec<&'a str> {
+        changes.iter().filter(|c| filter(c)).map(|c| c.name).collect()
+    }
+
+    fn prepare(game_dir: &Path) -> (GameSettings, PluginList, SavedState) {
+        let (settings, mut plugins) = mock_game_files(GameId::Oblivion, game_dir);
+        plugins.insert(1, Plugin::new("Blank.esm", &settings).unwrap());
+        plugins.insert(4, Plugin::new("Blank - Master Dependent.esp", &settings).unwrap());
+
+        let saved = SavedState::saved(&plugins);
+
+        (settings, plugins, saved)
+    }
+
+    #[test]
+    fn longest_increasing_subsequence_should_mark_the_values_it_contains() {
+        assert!(longest_increasing_subsequence(&[]).is_empty());
+        assert_eq!(
+            vec![true, true, true],
+            longest_increasing_subsequence(&[0, 1, 2])
+        );
+        assert_eq!(
+            vec![true, false, true, true],
+            longest_increasing_subsequence(&[0, 2, 1, 3])
+        );
+        assert_eq!(
+            vec![false, true, true, true],
+            longest_increasing_subsequence(&[3, 0, 1, 2])
+        );
+    }
+
+    #[test]
+    fn changes_should_be_empty_if_nothing_has_changed() {
+        let tmp_dir = tempdir().unwrap();
+        let (_, plugins, saved) = prepare(&tmp_dir.path());
+
+        assert!(saved.changes(&plugins).is_empty());
+        assert!(saved.is_saved(&plugins));
+    }
+
+    #[test]
+    fn changes_should_only_report_a_moved_plugin_as_moved() {
+        let tmp_dir = tempdir().unwrap();
+        let (_, mut plugins, saved) = prepare(&tmp_dir.path());
+
+        let last = plugins.len() - 1;
+        plugins.move_plugin(2, last);
+
+        let changes = saved.changes(&plugins);
+        assert_eq!(1, changes.len());
+        assert_eq!(plugins[last].name(), changes[0].name);
+        assert!(changes[0].is_moved);
+        assert!(!saved.is_saved(&plugins));
+    }
+
+    #[test]
+    fn changes_should_report_added_removed_activated_and_deactivated_plugins() {
+        let tmp_dir = tempdir().unwrap();
+        let (settings, mut plugins, saved) = prepare(&tmp_dir.path());
+
+        copy_to_test_dir("Blank.esp", "New.esp", &settings);
+        let index = plugins.index_of("Blank - Different.esp").unwrap();
+        plugins.remove(index);
+        let index = plugins.index_of("Blank.esp").unwrap();
+        plugins.deactivate(index);
+        let index = plugins.index_of("Blank.esm").unwrap();
+        plugins.activate(index).unwrap();
+        plugins.insert(
+            plugins.len(),
+            Plugin::with_active("New.esp", &settings, true).unwrap(),
+        );
+
+        let changes = saved.changes(&plugins);
+        assert_eq!(vec!["New.esp"], names(&changes, |c| c.is_added));
+        assert_eq!(
+            vec!["Blank - Different.esp"],
+            names(&changes, |c| c.is_removed)
+        );
+        assert_eq!(vec!["Blank.esm", "New.esp"], names(&changes, |c| c.is_activated));
+        assert_eq!(vec!["Blank.esp"], names(&changes, |c| c.is_deactivated));
+        assert!(names(&changes, |c| c.is_moved).is_empty());
+    }
+
+    #[test]
+    fn is_saved_should_be_false_for_a_loaded_state() {
+        let tmp_dir = tempdir().unwrap();
+        let (_, plugins, _) = prepare(&tmp_dir.path());
+
+        assert!(!SavedState::loaded(&plugins).is_saved(&plugins));
+        assert!(SavedState::loaded(&plugins).changes(&plugins).is_empty());
+    }
+}
@@ -0,0 +1,839 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+use std::collections::hash_map::Entry;
+use std::collections::HashMap;
+use std::mem;
+use std::ops::Index;
+use std::slice;
+use std::sync::Arc;
+use std::time::SystemTime;
+
+use rayon::prelude::*;
+
+use case_insensitive::{CaseInsensitiveStr, CaseInsensitiveString};
+use enums::Error;
+use parallelism::Parallelism;
+use plugin::{activate_plugins, trim_dot_ghost, Plugin};
+
+/// A list of plugins in load order, with a case-insensitive index of their
+/// names so that plugins can be looked up by name in constant time, and
+/// counts of the active plugins so that active plugin limits can be checked
+/// without iterating over the list.
+///
+/// Plugins are stored in slots that don't change as the load order does, and
+/// the load order is a list of slot numbers, so inserting, removing and moving
+/// plugins only shifts 4-byte slot numbers. The position of the first plugin
+/// that isn't a master or light master is also kept up to date, as it is
+/// needed whenever a plugin is added or moved.
+///
+/// Plugins can only be added, removed, reordered or (de)activated through the
+/// methods below, as they keep the index and counts consistent with the list.
+#[derive(Clone, Debug, Default)]
+pub struct PluginList {
+    plugins: Vec<Plugin>,
+    order: Vec<u32>,
+    // The position of the plugin in each slot.
+    positions: Vec<u32>,
+    // Maps names to the slot of the first plugin with each name. Shared
+    // between copies of the list until one of them adds or removes a plugin.
+    indices: Arc<HashMap<CaseInsensitiveString, u32>>,
+    // The number of plugins with names that are not indexed because an
+    // earlier plugin has the same name.
+    duplicates: usize,
+    first_non_master: Option<usize>,
+    active_normal_plugins: usize,
+    active_light_masters: usize,
+}
+
+impl PluginList {
+    pub fn len(&self) -> usize {
+        self.order.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.order.is_empty()
+    }
+
+    pub fn get(&self, index: usize) -> Option<&Plugin> {
+        self.order.get(index).map(|&slot| &self.plugins[slot as usize])
+    }
+
+    pub fn iter<'a>(&'a self) -> Iter<'a> {
+        Iter {
+            plugins: &self.plugins,
+            order: self.order.iter(),
+        }
+    }
+
+    /// Iterates over the plugins in parallel, but not in load order.
+    pub fn par_iter_unordered<'a>(&'a self) -> rayon::slice::Iter<'a, Plugin> {
+        self.plugins.par_iter()
+    }
+
+    pub fn active_normal_plugins_count(&self) -> usize {
+        self.active_normal_plugins
+    }
+
+    pub fn active_light_masters_count(&self) -> usize {
+        self.active_light_masters
+    }
+
+    /// Gets the position of the first plugin that is neither a master nor a
+    /// light master.
+    pub fn first_non_master_position(&self) -> Option<usize> {
+        self.first_non_master
+    }
+
+    pub fn index_of(&self, plugin_name: &str) -> Option<usize> {
+        self.indices
+            .get(borrowed_key(plugin_name))
+            .map(|&slot| self.positions[slot as usize] as usize)
+    }
+
+    pub fn find(&self, plugin_name: &str) -> Option<&Plugin> {
+        self.indices
+            .get(borrowed_key(plugin_name))
+            .map(|&slot| &self.plugins[slot as usize])
+    }
+
+    pub fn activate(&mut self, index: usize) -> Result<(), Error> {
+        let slot = self.slot(index);
+
+        self.uncount(slot);
+        let result = self.plugins[slot].activate();
+        self.count(slot);
+
+        result
+    }
+
+    /// Activates the plugins at the given indices, unghosting ghosted plugins
+    /// concurrently using up to `max_threads` threads. All the plugins are
+    /// activated even if some fail to activate.
+    pub fn activate_all(&mut self, indices: &[usize], max_threads: usize) -> Result<(), Error> {
+        let mut selected = vec![false; self.plugins.len()];
+        for &index in indices {
+            let slot = self.slot(index);
+            selected[slot] = !self.plugins[slot].is_active();
+        }
+
+        let result = activate_plugins(
+            self.plugins
+                .iter_mut()
+                .zip(&selected)
+                .filter(|&(_, selected)| *selected)
+                .map(|(plugin, _)| plugin)
+                .collect(),
+            max_threads,
+        );
+
+        // Only plugins that weren't active were selected, so none were counted.
+        for (slot, _) in selected.iter().enumerate().filter(|&(_, s)| *s) {
+            self.count(slot);
+        }
+
+        result
+    }
+
+    pub fn deactivate(&mut self, index: usize) {
+        let slot = self.slot(index);
+        self.uncount(slot);
+        self.plugins[slot].deactivate();
+    }
+
+    pub fn deactivate_all(&mut self) {
+        for plugin in &mut self.plugins {
+            plugin.deactivate();
+        }
+        self.active_normal_plugins = 0;
+        self.active_light_masters = 0;
+    }
+
+    /// Sets the plugins' modification times, which are given in load order,
+    /// returning the number of plugin files whose timestamps had to be
+    /// written.
+    pub fn set_modification_times(
+        &mut self,
+        times: Vec<SystemTime>,
+        parallelism: &Parallelism,
+    ) -> Result<usize, Error> {
+        let plugins = &mut self.plugins;
+        let positions = &self.positions;
+        let written: Vec<bool> = parallelism.install(|| {
+            plugins
+                .par_iter_mut()
+                .zip(positions.par_iter())
+                .with_min_len(parallelism.sequential_threshold())
+                .map(|(plugin, &position)| match times.get(position as usize) {
+                    Some(&time) => plugin.set_modification_time(time),
+                    None => Ok(false),
+                })
+                .collect::<Result<_, _>>()
+        })?;
+
+        Ok(written.into_iter().filter(|x| *x).count())
+    }
+
+    pub fn push(&mut self, plugin: Plugin) {
+        let index = self.len();
+        self.insert(index, plugin);
+    }
+
+    pub fn insert(&mut self, index: usize, plugin: Plugin) {
+        let index = index.min(self.len());
+        let slot = self.plugins.len();
+        let is_non_master = is_non_master(&plugin);
+        let plugin_key = key(plugin.name());
+
+        self.plugins.push(plugin);
+        self.positions.push(index as u32);
+        self.order.insert(index, slot as u32);
+        for &later_slot in &self.order[index + 1..] {
+            self.positions[later_slot as usize] += 1;
+        }
+
+        match Arc::make_mut(&mut self.indices).entry(plugin_key) {
+            Entry::Vacant(entry) => {
+                entry.insert(slot as u32);
+            }
+            Entry::Occupied(mut entry) => {
+                self.duplicates += 1;
+                if self.positions[*entry.get() as usize] as usize > index {
+                    entry.insert(slot as u32);
+                }
+            }
+        }
+
+        self.first_non_master = match self.first_non_master {
+            Some(i) if i < index => Some(i),
+            Some(_) | None if is_non_master => Some(index),
+            Some(i) => Some(i + 1),
+            None => None,
+        };
+
+        self.count(slot);
+    }
+
+    pub fn remove(&mut self, index: usize) -> Plugin {
+        let slot = self.slot(index);
+        self.uncount(slot);
+
+        self.order.remove(index);
+        for &later_slot in &self.order[index..] {
+            self.positions[later_slot as usize] -= 1;
+        }
+
+        let plugin_key = borrowed_key(self.plugins[slot].name());
+        if self.indices.get(plugin_key) == Some(&(slot as u32)) {
+            match self.find_duplicate(plugin_key) {
+                Some(duplicate_slot) => {
+                    self.duplicates -= 1;
+                    if let Some(indexed_slot) = Arc::make_mut(&mut self.indices).get_mut(plugin_key)
+                    {
+                        *indexed_slot = duplicate_slot;
+                    }
+                }
+                None => {
+                    Arc::make_mut(&mut self.indices).remove(plugin_key);
+                }
+            }
+        } else {
+            self.duplicates -= 1;
+        }
+
+        self.first_non_master = match self.first_non_master {
+            Some(i) if i > index => Some(i - 1),
+            Some(i) if i == index => self.find_non_master(index),
+            x => x,
+        };
+
+        // Move the last slot's plugin into the freed slot.
+        let last_slot = self.plugins.len() - 1;
+        let plugin = self.plugins.swap_remove(slot);
+        self.positions.swap_remove(slot);
+        if slot != last_slot {
+            self.order[self.positions[slot] as usize] = slot as u32;
+            let indices = Arc::make_mut(&mut self.indices);
+            if let Some(indexed_slot) = indices.get_mut(borrowed_key(self.plugins[slot].name())) {
+                if *indexed_slot == last_slot as u32 {
+                    *indexed_slot = slot as u32;
+                }
+            }
+        }
+
+        plugin
+    }
+
+    /// Moves the plugin at the `from` index so that it is at the `to` index.
+    pub fn move_plugin(&mut self, from: usize, to: usize) {
+        if from == to {
+            return;
+        }
+
+        let slot = self.slot(from);
+        let (start, end) = if from < to {
+            self.order[from..to + 1].rotate_left(1);
+            (from, to)
+        } else {
+            self.order[to..from + 1].rotate_right(1);
+            (to, from)
+        };
+        for position in start..end + 1 {
+            self.positions[self.order[position] as usize] = position as u32;
+        }
+
+        if self.duplicates > 0 {
+            let plugin_key = borrowed_key(self.plugins[slot].name());
+            if let Some(first_slot) = self.find_duplicate(plugin_key) {
+                if let Some(indexed_slot) = Arc::make_mut(&mut self.indices).get_mut(plugin_key) {
+                    *indexed_slot = first_slot;
+                }
+            }
+        }
+
+        self.first_non_master = match self.first_non_master {
+            None => None,
+            Some(i) if !is_non_master(&self.plugins[slot]) => {
+                if from < i && to >= i {
+                    Some(i - 1)
+                } else if from > i && to <= i {
+                    Some(i + 1)
+                } else {
+                    Some(i)
+                }
+            }
+            Some(i) if i == from && to > from => self.find_non_master(from),
+            Some(i) => Some(i.min(to)),
+        };
+    }
+
+    pub fn retain<F: FnMut(&Plugin) -> bool>(&mut self, mut f: F) {
+        let mut plugins: Vec<Option<Plugin>> = mem::replace(&mut self.plugins, Vec::new())
+            .into_iter()
+            .map(Some)
+            .collect();
+
+        let retained: Vec<Plugin> = self.order
+            .iter()
+            .filter_map(|&slot| plugins[slot as usize].take())
+            .filter(|plugin| f(plugin))
+            .collect();
+
+        *self = PluginList::from(retained);
+    }
+
+    pub fn clear(&mut self) {
+        *self = PluginList::default();
+    }
+
+    fn slot(&self, index: usize) -> usize {
+        self.order[index] as usize
+    }
+
+    // Finds the first slot in load order holding a plugin with the given key.
+    fn find_duplicate(&self, plugin_key: &CaseInsensitiveStr) -> Option<u32> {
+        if self.duplicates == 0 {
+            return None;
+        }
+
+        self.order
+            .iter()
+            .find(|&&slot| borrowed_key(self.plugins[slot as usize].name()) == plugin_key)
+            .cloned()
+    }
+
+    fn find_non_master(&self, start: usize) -> Option<usize> {
+        self.order[start..]
+            .iter()
+            .position(|&slot| is_non_master(&self.plugins[slot as usize]))
+            .map(|i| i + start)
+    }
+
+    fn reindex(&mut self) {
+        let mut indices = HashMap::with_capacity(self.plugins.len());
+        self.duplicates = 0;
+        self.active_normal_plugins = 0;
+        self.active_light_masters = 0;
+        for slot in 0..self.plugins.len() {
+            match indices.entry(key(self.plugins[slot].name())) {
+                Entry::Vacant(entry) => {
+                    entry.insert(slot as u32);
+                }
+                Entry::Occupied(_) => self.duplicates += 1,
+            }
+            self.count(slot);
+        }
+        self.indices = Arc::new(indices);
+        self.first_non_master = self.find_non_master(0);
+    }
+
+    fn active_count_mut(&mut self, slot: usize) -> Option<&mut usize> {
+        let plugin = &self.plugins[slot];
+        if !plugin.is_active() {
+            None
+        } else if plugin.is_light_master_file() {
+            Some(&mut self.active_light_masters)
+        } else {
+            Some(&mut self.active_normal_plugins)
+        }
+    }
+
+    fn count(&mut self, slot: usize) {
+        if let Some(count) = self.active_count_mut(slot) {
+            *count += 1;
+        }
+    }
+
+    fn uncount(&mut self, slot: usize) {
+        if let Some(count) = self.active_count_mut(slot) {
+            *count -= 1;
+        }
+    }
+}
+
+impl From<Vec<Plugin>> for PluginList {
+    fn from(plugins: Vec<Plugin>) -> Self {
+        let order: Vec<u32> = (0..plugins.len() as u32).collect();
+        let mut list = PluginList {
+            plugins,
+            positions: order.clone(),
+            order,
+            indices: Arc::default(),
+            duplicates: 0,
+            first_non_master: None,
+            active_normal_plugins: 0,
+            active_light_masters: 0,
+        };
+        list.reindex();
+        list
+    }
+}
+
+impl Index<usize> for PluginList {
+    type Output = Plugin;
+
+    fn index(&self, index: usize) -> &Plugin {
+        &self.plugins[self.slot(index)]
+    }
+}
+
+impl<'a> IntoIterator for &'a PluginList {
+    type Item = &'a Plugin;
+    type IntoIter = Iter<'a>;
+
+    fn into_iter(self) -> Iter<'a> {
+        self.iter()
+    }
+}
+
+/// An iterator over the plugins in a `PluginList`, in load order.
+pub struct Iter<'a> {
+    plugins: &'a [Plugin],
+    order: slice::Iter<'a, u32>,
+}
+
+impl<'a> Iterator for Iter<'a> {
+    type Item = &'a Plugin;
+
+    fn next(&mut self) -> Option<&'a Plugin> {
+        let plugins = self.plugins;
+        self.order.next().map(|&slot| &plugins[slot as usize])
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        self.order.size_hint()
+    }
+}
+
+impl<'a> DoubleEndedIterator for Iter<'a> {
+    fn next_back(&mut self) -> Option<&'a Plugin> {
+        let plugins = self.plugins;
+        self.order.next_back().map(|&slot| &plugins[slot as usize])
+    }
+}
+
+impl<'a> ExactSizeIterator for Iter<'a> {}
+
+fn is_non_master(plugin: &Plugin) -> bool {
+    !plugin.is_master_file() && !plugin.is_light_master_file()
+}
+
+pub fn key(plugin_name: &str) -> CaseInsensitiveString {
+    CaseInsensitiveString::new(trim_dot_ghost(plugin_name))
+}
+
+/// Gets the same key as `key()` without copying the plugin name, for comparing or deduplicating
+/// names that outlive the key.
+pub fn borrowed_key(plugin_name: &str) -> &CaseInsensitiveStr {
+    CaseInsensitiveStr::new(trim_dot_ghost(plugin_name))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    use std::borrow::Borrow;
+    use std::path::Path;
+
+    use tempfile::tempdir;
+
+    use enums::GameId;
+    use game_settings::GameSettings;
+    use load_order::tests::mock_game_files;
+    use tests::{copy_to_test_dir, count_allocations};
+
+    fn prepare(game_dir: &Path) -> PluginList {
+        let (_, plugins) = mock_game_files(GameId::Oblivion, game_dir);
+
+        plugins
+    }
+
+    fn assert_indices_are_consistent(list: &PluginList) {
+        assert_eq!(list.len(), list.indices.len() + list.duplicates);
+        for (index, plugin) in list.iter().enumerate() {
+            assert_eq!(index, list.positions[list.slot(index)] as usize);
+
+            let first_index = list.iter().position(|p| p.name_matches(plugin.name()));
+            assert_eq!(first_index, list.index_of(plugin.name()));
+        }
+
+        let expected_position = list.iter()
+            .position(|p| !p.is_master_file() && !p.is_light_master_file());
+        assert_eq!(expected_position, list.first_non_master_position());
+    }
+
+    fn names(list: &PluginList) -> Vec<&str> {
+        list.iter().map(Plugin::name).collect()
+    }
+
+    fn assert_counts_are_consistent(list: &PluginList) {
+        let light_masters = list.iter()
+            .filter(|p| p.is_active() && p.is_light_master_file())
+            .count();
+        let normal_plugins = list.iter()
+            .filter(|p| p.is_active() && !p.is_light_master_file())
+            .count();
+
+        assert_eq!(light_masters, list.active_light_masters_count());
+        assert_eq!(normal_plugins, list.active_normal_plugins_count());
+    }
+
+    #[test]
+    fn index_of_should_be_case_insensitive_and_ignore_ghost_extensions() {
+        let tmp_dir = tempdir().unwrap();
+        let list = prepare(&tmp_dir.path());
+
+        assert_eq!(Some(1), list.index_of("blank.ESP"));
+        assert_eq!(Some(1), list.index_of("Blank.esp.ghost"));
+        assert_eq!(None, list.index_of("Blank.esm"));
+    }
+
+    #[test]
+    fn index_of_should_not_allocate() {
+        let tmp_dir = tempdir().unwrap();
+        let list = prepare(&tmp_dir.path());
+
+        let mut index = None;
+        let allocations = count_allocations(|| index = list.index_of("Blank.esp.ghost"));
+
+        assert_eq!(Some(1), index);
+        assert_eq!(0, allocations);
+    }
+
+    #[test]
+    fn borrowed_key_should_equal_key_and_ignore_case_and_ghost_extensions() {
+        let owned_key = key("Blàñk.esp");
+        let owned_key: &CaseInsensitiveStr = owned_key.borrow();
+        assert_eq!(owned_key, borrowed_key("Blàñk.esp"));
+        assert_eq!(borrowed_key("blàñk.ESP"), borrowed_key("Blàñk.esp.ghost"));
+        assert_ne!(borrowed_key("Blank.esp"), borrowed_key("Blank.esm"));
+    }
+
+    #[test]
+    fn push_should_index_the_new_plugin() {
+        let tmp_dir = tempdir().unwrap();
+        let (settings, mut list) = mock_game_files(GameId::Oblivion, &tmp_dir.path());
+
+        list.push(Plugin::new("Blank.esm", &settings).unwrap());
+
+        assert_eq!(Some(3), list.index_of("Blank.esm"));
+        assert_indices_are_consistent(&list);
+    }
+
+    #[test]
+    fn insert_should_shift_the_indices_of_later_plugins() {
+        let tmp_dir = tempdir().unwrap();
+        let (settings, mut list) = mock_game_files(GameId::Oblivion, &tmp_dir.path());
+
+        list.insert(1, Plugin::new("Blank.esm", &settings).unwrap());
+
+        assert_eq!(Some(1), list.index_of("Blank.esm"));
+        assert_eq!(Some(2), list.index_of("Blank.esp"));
+        assert_indices_are_consistent(&list);
+    }
+
+    #[test]
+    fn remove_should_unindex_the_plugin_and_shift_the_indices_of_later_plugins() {
+        let tmp_dir = tempdir().unwrap();
+        let mut list = prepare(&tmp_dir.path());
+
+        let plugin = list.remove(1);
+
+        assert_eq!("Blank.esp", plugin.name());
+        assert_eq!(None, list.index_of("Blank.esp"));
+        assert_eq!(Some(1), list.index_of("Blank - Different.esp"));
+        assert_indices_are_consistent(&list);
+    }
+
+    #[test]
+    fn insert_of_a_master_should_shift_the_first_non_master_position() {
+        let tmp_dir = tempdir().unwrap();
+        let (settings, mut list) = mock_game_files(GameId::Oblivion, &tmp_dir.path());
+        assert_eq!(Some(1), list.first_non_master_position());
+
+        list.insert(1, Plugin::new("Blank.esm", &settings).unwrap());
+
+        assert_eq!(Some(2), list.first_non_master_position());
+        assert_indices_are_consistent(&list);
+    }
+
+    #[test]
+    fn remove_of_the_first_non_master_should_find_the_next_non_master() {
+        let tmp_dir = tempdir().unwrap();
+        let mut list = prepare(&tmp_dir.path());
+
+        list.remove(1);
+        assert_eq!(Some(1), list.first_non_master_position());
+
+        list.remove(1);
+        assert_eq!(None, list.first_non_master_position());
+        assert_indices_are_consistent(&list);
+    }
+
+    #[test]
+    fn move_plugin_should_move_the_plugin_and_update_the_indices_of_plugins_in_between() {
+        let tmp_dir = tempdir().unwrap();
+        let (settings, mut list) = mock_game_files(GameId::Oblivion, &tmp_dir.path());
+        list.push(Plugin::new("Blank - Master Dependent.esp", &settings).unwrap());
+
+        list.move_plugin(1, 3);
+
+        assert_eq!(
+            vec![
+                "Oblivion.esm",
+                "Blank - Different.esp",
+                "Blank - Master Dependent.esp",
+                "Blank.esp",
+            ],
+            names(&list)
+        );
+        assert_indices_are_consistent(&list);
+
+        list.move_plugin(3, 0);
+
+        assert_eq!(
+            vec![
+                "Blank.esp",
+                "Oblivion.esm",
+                "Blank - Different.esp",
+                "Blank - Master Dependent.esp",
+            ],
+            names(&list)
+        );
+        assert_eq!(Some(0), list.first_non_master_position());
+        assert_indices_are_consistent(&list);
+
+        list.move_plugin(1, 0);
+        list.move_plugin(1, 3);
+        list.move_plugin(2, 1);
+
+        assert_eq!(Some(1), list.first_non_master_position());
+        assert_indices_are_consistent(&list);
+    }
+
+    #[test]
+    fn a_sequence_of_operations_should_keep_the_list_consistent() {
+        let tmp_dir = tempdir().unwrap();
+        let (settings, mut list) = mock_game_files(GameId::Oblivion, &tmp_dir.path());
+        list.push(Plugin::new("Blank - Master Dependent.esp", &settings).unwrap());
+        list.insert(1, Plugin::new("Blank.esm", &settings).unwrap());
+
+        let moves = [(0, 4), (4, 1), (2, 3), (1, 2), (3, 0), (0, 2), (4, 0)];
+        for &(from, to) in &moves {
+            list.move_plugin(from, to);
+            assert_indices_are_consistent(&list);
+        }
+
+        for index in &[2, 0, 1] {
+            list.remove(*index);
+            assert_indices_are_consistent(&list);
+            assert_counts_are_consistent(&list);
+        }
+    }
+
+    #[test]
+    fn a_duplicate_plugin_should_be_indexed_once_it_is_the_first_with_its_name() {
+        let tmp_dir = tempdir().unwrap();
+        let (settings, mut list) = mock_game_files(GameId::Oblivion, &tmp_dir.path());
+        list.push(Plugin::new("Blank.esp", &settings).unwrap());
+        assert_eq!(Some(1), list.index_of("Blank.esp"));
+        assert_indices_are_consistent(&list);
+
+        list.move_plugin(3, 1);
+        assert_eq!(Some(1), list.index_of("Blank.esp"));
+        assert!(!list[1].is_active());
+        assert_indices_are_consistent(&list);
+
+        list.remove(1);
+        assert_eq!(Some(1), list.index_of("Blank.esp"));
+        assert!(list[1].is_active());
+        assert_indices_are_consistent(&list);
+    }
+
+    #[test]
+    fn retain_should_reindex_the_remaining_plugins() {
+        let tmp_dir = tempdir().unwrap();
+        let mut list = prepare(&tmp_dir.path());
+
+        list.retain(|p| !p.is_active());
+
+        assert_eq!(None, list.index_of("Blank.esp"));
+        assert_indices_are_consistent(&list);
+    }
+
+    #[test]
+    fn clear_should_remove_all_plugins_from_the_index() {
+        let tmp_dir = tempdir().unwrap();
+        let mut list = prepare(&tmp_dir.path());
+
+        list.clear();
+
+        assert!(list.is_empty());
+        assert_eq!(None, list.index_of("Blank.esp"));
+    }
+
+    #[test]
+    fn from_should_count_active_plugins() {
+        let tmp_dir = tempdir().unwrap();
+        let list = prepare(&tmp_dir.path());
+
+        assert_eq!(1, list.active_normal_plugins_count());
+        assert_eq!(0, list.active_light_masters_count());
+    }
+
+    #[test]
+    fn insert_and_remove_should_update_active_plugin_counts() {
+        let tmp_dir = tempdir().unwrap();
+        let (settings, mut list) = mock_game_files(GameId::Oblivion, &tmp_dir.path());
+
+        list.insert(1, Plugin::with_active("Blank.esm", &settings, true).unwrap());
+        assert_eq!(2, list.active_normal_plugins_count());
+
+        list.remove(2);
+        assert_eq!(1, list.active_normal_plugins_count());
+        assert_counts_are_consistent(&list);
+    }
+
+    #[test]
+    fn activate_all_should_activate_the_plugins_at_the_given_indices_and_update_counts() {
+        let tmp_dir = tempdir().unwrap();
+        let mut list = prepare(&tmp_dir.path());
+
+        list.activate_all(&[2, 1, 2], 4).unwrap();
+
+        assert!(list[1].is_active());
+        assert!(list[2].is_active());
+        assert_counts_are_consistent(&list);
+    }
+
+    #[test]
+    fn copies_should_share_the_index_until_a_plugin_is_added_or_removed() {
+        let tmp_dir = tempdir().unwrap();
+        let list = prepare(&tmp_dir.path());
+
+        let mut copy = list.clone();
+        copy.activate(2).unwrap();
+        copy.move_plugin(1, 2);
+        assert!(Arc::ptr_eq(&list.indices, &copy.indices));
+
+        copy.remove(2);
+        assert!(!Arc::ptr_eq(&list.indices, &copy.indices));
+        assert_indices_are_consistent(&list);
+        assert_indices_are_consistent(&copy);
+    }
+
+    #[test]
+    fn activate_and_deactivate_should_update_active_plugin_counts() {
+        let tmp_dir = tempdir().unwrap();
+        let mut list = prepare(&tmp_dir.path());
+
+        list.activate(2).unwrap();
+        list.activate(2).unwrap();
+        assert_eq!(2, list.active_normal_plugins_count());
+
+        list.deactivate(1);
+        list.deactivate(1);
+        assert_eq!(1, list.active_normal_plugins_count());
+        assert_counts_are_consistent(&list);
+
+        list.deactivate_all();
+        assert_eq!(0, list.active_normal_plugins_count());
+        assert_counts_are_consistent(&list);
+    }
+
+    #[test]
+    fn active_light_masters_should_be_counted_separately() {
+        let tmp_dir = tempdir().unwrap();
+        let settings = GameSettings::with_local_path(
+            GameId::SkyrimSE,
+            &tmp_dir.path(),
+            &tmp_dir.path().join("local"),
+        ).unwrap();
+        copy_to_test_dir("Blank.esm", "Blank.esm", &settings);
+        copy_to_test_dir("Blank.esl", "Blank.esl", &settings);
+        let mut list = PluginList::from(vec![
+            Plugin::with_active("Blank.esm", &settings, true).unwrap(),
+            Plugin::new("Blank.esl", &settings).unwrap(),
+        ]);
+
+        list.activate(1).unwrap();
+
+        assert_eq!(1, list.active_normal_plugins_count());
+        assert_eq!(1, list.active_light_masters_count());
+        assert_counts_are_consistent(&list);
+    }
+
+    #[test]
+    fn activating_a_ghosted_plugin_should_update_active_plugin_counts() {
+        let tmp_dir = tempdir().unwrap();
+        let (settings, mut list) = mock_game_files(GameId::Oblivion, &tmp_dir.path());
+        copy_to_test_dir(
+            "Blank - Different.esm",
+            "Blank - Different.esm.ghost",
+            &settings,
+        );
+        list.push(Plugin::new("Blank - Different.esm.ghost", &settings).unwrap());
+
+        list.activate(3).unwrap();
+
+        assert!(list.find("Blank - Different.esm").unwrap().is_active());
+        assert_eq!(2, list.active_normal_plugins_count());
+        assert_indices_are_consistent(&list);
+        assert_counts_are_consistent(&list);
+    }
+}
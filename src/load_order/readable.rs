@@ -21,11 +21,14 @@ use std::fs::read_dir;
 
 use rayon::iter::Either;
 use rayon::prelude::*;
+use unicase::UniCase;
 
-use super::find_first_non_master_position;
-use enums::Error;
+use super::plugin_list::{borrowed_key, PluginList};
+use case_insensitive::CaseInsensitiveStr;
+use enums::{Error, LoadOrderViolation};
 use game_settings::GameSettings;
-use plugin::{trim_dot_ghost, Plugin};
+use metrics::{Counter, Phase};
+use plugin::{Plugin, PluginFile};
 
 pub const MAX_ACTIVE_NORMAL_PLUGINS: usize = 255;
 pub const MAX_ACTIVE_LIGHT_MASTERS: usize = 4096;
@@ -42,21 +45,46 @@ pub trait ReadableLoadOrder {
     fn active_plugin_names(&self) -> Vec<&str>;
 
     fn is_active(&self, plugin_name: &str) -> bool;
+
+    fn plugin_states<'a>(&'a self) -> Vec<PluginState<'a>>;
+}
+
+/// The name and status of a plugin in a load order.
+#[derive(Clone, Copy, Debug, Eq, Hash, PartialEq)]
+pub struct PluginState<'a> {
+    pub name: &'a str,
+    pub is_active: bool,
+    pub is_master: bool,
+    pub is_light_master: bool,
+    pub is_ghosted: bool,
 }
 
-pub fn plugin_names(plugins: &[Plugin]) -> Vec<&str> {
+pub fn plugin_names(plugins: &PluginList) -> Vec<&str> {
     plugins.iter().map(Plugin::name).collect()
 }
 
-pub fn index_of(plugins: &[Plugin], plugin_name: &str) -> Option<usize> {
-    plugins.iter().position(|p| p.name_matches(plugin_name))
+pub fn plugin_states<'a>(plugins: &'a PluginList) -> Vec<PluginState<'a>> {
+    plugins
+        .iter()
+        .map(|p| PluginState {
+            name: p.name(),
+            is_active: p.is_active(),
+            is_master: p.is_master_file(),
+            is_light_master: p.is_light_master_file(),
+            is_ghosted: p.is_ghosted(),
+        })
+        .collect()
+}
+
+pub fn index_of(plugins: &PluginList, plugin_name: &str) -> Option<usize> {
+    plugins.index_of(plugin_name)
 }
 
-pub fn plugin_at(plugins: &[Plugin], index: usize) -> Option<&str> {
+pub fn plugin_at(plugins: &PluginList, index: usize) -> Option<&str> {
     plugins.get(index).map(Plugin::name)
 }
 
-pub fn active_plugin_names(plugins: &[Plugin]) -> Vec<&str> {
+pub fn active_plugin_names(plugins: &PluginList) -> Vec<&str> {
     plugins
         .iter()
         .filter(|p| p.is_active())
@@ -64,55 +92,61 @@ pub fn active_plugin_names(plugins: &[Plugin]) -> Vec<&str> {
         .collect()
 }
 
-pub fn is_active(plugins: &[Plugin], plugin_name: &str) -> bool {
-    plugins
-        .iter()
-        .find(|p| p.name_matches(plugin_name))
-        .map_or(false, |p| p.is_active())
+pub fn is_active(plugins: &PluginList, plugin_name: &str) -> bool {
+    plugins.find(plugin_name).map_or(false, |p| p.is_active())
 }
 
 pub trait ReadableLoadOrderExt: ReadableLoadOrder + Sync {
-    fn plugins(&self) -> &Vec<Plugin>;
+    fn plugins(&self) -> &PluginList;
 
     fn count_active_normal_plugins(&self) -> usize {
-        self.plugins()
-            .iter()
-            .filter(|p| !p.is_light_master_file() && p.is_active())
-            .count()
+        self.plugins().active_normal_plugins_count()
     }
 
     fn count_active_light_masters(&self) -> usize {
-        self.plugins()
-            .iter()
-            .filter(|p| p.is_light_master_file() && p.is_active())
-            .count()
+        self.plugins().active_light_masters_count()
     }
 
-    fn find_plugins_in_dir(&self) -> Vec<String> {
+    fn find_plugins_in_dir(&self) -> Vec<PluginFile> {
+        let metrics = self.game_settings().metrics_recorder();
+        let _timer = metrics.start(Phase::FindPlugins);
+
+        metrics.add(Counter::FileOpens, 1);
         let entries = match read_dir(&self.game_settings().plugins_directory()) {
             Ok(x) => x,
             _ => return Vec::new(),
         };
 
-        let mut set: HashSet<String> = HashSet::new();
-
-        entries
+        let game_id = self.game_settings().id();
+        let mut files: Vec<PluginFile> = entries
             .filter_map(|e| e.ok())
-            .filter(|e| e.file_type().map(|f| f.is_file()).unwrap_or(false))
-            .filter_map(|e| e.file_name().to_str().and_then(|f| Some(f.to_owned())))
-            .filter(|ref filename| set.insert(trim_dot_ghost(&filename).to_lowercase()))
-            .collect()
+            .filter_map(|e| PluginFile::new(&e, game_id, metrics))
+            .collect();
+
+        let is_unique: Vec<bool> = {
+            let mut set: HashSet<&CaseInsensitiveStr> = HashSet::with_capacity(files.len());
+            files
+                .iter()
+                .map(|f| set.insert(borrowed_key(&f.filename)))
+                .collect()
+        };
+        let mut is_unique = is_unique.into_iter();
+        files.retain(|_| is_unique.next().unwrap_or(false));
+
+        metrics.add(Counter::PluginFilesScanned, files.len() as u64);
+
+        files
     }
 
-    fn find_plugins_in_dir_sorted(&self) -> Vec<String> {
-        let mut filenames = self.find_plugins_in_dir();
-        filenames.sort();
+    fn find_plugins_in_dir_sorted(&self) -> Vec<PluginFile> {
+        let mut files = self.find_plugins_in_dir();
+        files.sort_by(|a, b| a.filename.cmp(&b.filename));
 
-        filenames
+        files
     }
 
     fn get_excess_active_plugin_indices(&self) -> Vec<usize> {
-        let implicitly_active_plugins = self.game_settings().implicitly_active_plugins();
+        let game_settings = self.game_settings();
         let mut normal_active_count = self.count_active_normal_plugins();
         let mut light_master_active_count = self.count_active_light_masters();
 
@@ -123,10 +157,8 @@ pub trait ReadableLoadOrderExt: ReadableLoadOrder + Sync {
             {
                 break;
             }
-            let can_deactivate = plugin.is_active()
-                && !implicitly_active_plugins
-                    .iter()
-                    .any(|i| plugin.name_matches(i));
+            let can_deactivate =
+                plugin.is_active() && !game_settings.is_implicitly_active(plugin.name());
             if can_deactivate {
                 if plugin.is_light_master_file()
                     && light_master_active_count > MAX_ACTIVE_LIGHT_MASTERS
@@ -146,7 +178,7 @@ pub trait ReadableLoadOrderExt: ReadableLoadOrder + Sync {
     }
 
     fn validate_index(&self, index: usize, is_master: bool) -> Result<(), Error> {
-        match find_first_non_master_position(self.plugins()) {
+        match self.plugins().first_non_master_position() {
             None if !is_master && index < self.plugins().len() => Err(Error::NonMasterBeforeMaster),
             Some(i) if is_master && index > i || !is_master && index < i => {
                 Err(Error::NonMasterBeforeMaster)
@@ -155,35 +187,92 @@ pub trait ReadableLoadOrderExt: ReadableLoadOrder + Sync {
         }
     }
 
+    /// Checks a proposed load order against the rules that all load order
+    /// methods share, using only the plugins that are already loaded.
+    fn find_load_order_violations(&self, plugin_names: &[&str]) -> Vec<LoadOrderViolation> {
+        let supports_light_masters = self.game_settings().id().supports_light_masters();
+        let mut violations = Vec::new();
+        let mut unique_names: HashSet<UniCase<&str>> = HashSet::with_capacity(plugin_names.len());
+        let mut is_after_non_master = false;
+        let mut normal_active_count = 0;
+        let mut light_master_active_count = 0;
+
+        for (index, plugin_name) in plugin_names.iter().enumerate() {
+            if !unique_names.insert(UniCase::new(*plugin_name)) {
+                violations.push(LoadOrderViolation::DuplicatePlugin(index));
+                continue;
+            }
+
+            let plugin = match self.plugins().index_of(plugin_name) {
+                Some(x) => &self.plugins()[x],
+                None => {
+                    violations.push(LoadOrderViolation::UnknownPlugin(index));
+                    continue;
+                }
+            };
+
+            if !plugin.is_master_file() {
+                is_after_non_master = true;
+            } else if is_after_non_master {
+                violations.push(LoadOrderViolation::NonMasterBeforeMaster(index));
+            }
+
+            if plugin.is_active() {
+                let exceeds_limit = if supports_light_masters && plugin.is_light_master_file() {
+                    light_master_active_count += 1;
+                    light_master_active_count > MAX_ACTIVE_LIGHT_MASTERS
+                } else {
+                    normal_active_count += 1;
+                    normal_active_count > MAX_ACTIVE_NORMAL_PLUGINS
+                };
+                if exceeds_limit {
+                    violations.push(LoadOrderViolation::TooManyActivePlugins(index));
+                }
+            }
+        }
+
+        violations
+    }
+
     fn map_to_plugins(&self, plugin_names: &[&str]) -> Result<Vec<Plugin>, Error> {
-        plugin_names
-            .par_iter()
-            .map(|n| to_plugin(n, self.plugins(), self.game_settings()))
-            .collect()
+        let parallelism = self.game_settings().parallelism();
+        parallelism.install(|| {
+            plugin_names
+                .par_iter()
+                .with_min_len(parallelism.sequential_threshold())
+                .map(|n| to_plugin(n, self.plugins(), self.game_settings()))
+                .collect()
+        })
     }
 
     fn lookup_plugins(
         &mut self,
         active_plugin_names: &[&str],
     ) -> Result<(Vec<usize>, Vec<Plugin>), Error> {
+        let parallelism = self.game_settings().parallelism();
+        let min_len = parallelism.sequential_threshold();
+
         let (existing_plugin_indices, new_plugin_names): (Vec<usize>, Vec<&str>) =
-            active_plugin_names.into_par_iter().partition_map(|n| {
-                match self.plugins()
-                    .par_iter()
-                    .position_any(|p| p.name_matches(n))
-                {
-                    Some(x) => Either::Left(x),
-                    None => Either::Right(n),
-                }
+            parallelism.install(|| {
+                active_plugin_names
+                    .into_par_iter()
+                    .with_min_len(min_len)
+                    .partition_map(|n| match self.plugins().index_of(n) {
+                        Some(x) => Either::Left(x),
+                        None => Either::Right(n),
+                    })
             });
 
-        let new_plugins = new_plugin_names
-            .into_par_iter()
-            .map(|n| {
-                Plugin::new(n, self.game_settings())
-                    .map_err(|_| Error::InvalidPlugin(n.to_string()))
-            })
-            .collect::<Result<Vec<Plugin>, Error>>()?;
+        let new_plugins = parallelism.install(|| {
+            new_plugin_names
+                .into_par_iter()
+                .with_min_len(min_len)
+                .map(|n| {
+                    Plugin::new(n, self.game_settings())
+                        .map_err(|_| Error::InvalidPlugin(n.to_string()))
+                })
+                .collect::<Result<Vec<Plugin>, Error>>()
+        })?;
 
         Ok((existing_plugin_indices, new_plugins))
     }
@@ -211,21 +300,17 @@ pub trait ReadableLoadOrderExt: ReadableLoadOrder + Sync {
 
 fn to_plugin(
     plugin_name: &str,
-    existing_plugins: &[Plugin],
+    existing_plugins: &PluginList,
     game_settings: &GameSettings,
 ) -> Result<Plugin, Error> {
-    let existing_plugin = existing_plugins
-        .par_iter()
-        .find_any(|p| p.name_matches(plugin_name));
-
-    match existing_plugin {
+    match existing_plugins.find(plugin_name) {
         None => Plugin::new(plugin_name, game_settings),
         Some(x) => Ok(x.clone()),
     }
 }
 
 fn count_plugins(
-    existing_plugins: &[Plugin],
+    existing_plugins: &PluginList,
     existing_plugin_indices: &[usize],
     new_plugins: &[Plugin],
     count_light_masters: bool,
@@ -255,13 +340,13 @@ mod tests {
     use load_order::tests::mock_game_files;
     use tests::copy_to_test_dir;
 
-    fn prepare(game_dir: &Path) -> Vec<Plugin> {
+    fn prepare(game_dir: &Path) -> PluginList {
         let (_, plugins) = mock_game_files(GameId::Oblivion, game_dir);
 
         plugins
     }
 
-    fn prepare_with_ghosted_plugin(game_dir: &Path) -> Vec<Plugin> {
+    fn prepare_with_ghosted_plugin(game_dir: &Path) -> PluginList {
         let (settings, mut plugins) = mock_game_files(GameId::Oblivion, game_dir);
 
         copy_to_test_dir(
@@ -300,6 +385,33 @@ mod tests {
         assert_eq!(expected_plugin_names, plugin_names(&plugins));
     }
 
+    #[test]
+    fn plugin_states_should_return_the_status_of_each_plugin_in_load_order() {
+        let tmp_dir = tempdir().unwrap();
+        let plugins = prepare_with_ghosted_plugin(&tmp_dir.path());
+
+        let states = plugin_states(&plugins);
+
+        assert_eq!(4, states.len());
+        assert_eq!(
+            PluginState {
+                name: "Oblivion.esm",
+                is_active: false,
+                is_master: true,
+                is_light_master: false,
+                is_ghosted: false,
+            },
+            states[0]
+        );
+        assert_eq!("Blank - Different.esm", states[1].name);
+        assert!(states[1].is_master);
+        assert!(states[1].is_ghosted);
+        assert_eq!("Blank.esp", states[2].name);
+        assert!(states[2].is_active);
+        assert!(!states[2].is_master);
+        assert!(!states[3].is_active);
+    }
+
     #[test]
     fn index_of_should_return_none_if_the_plugin_is_not_in_the_load_order() {
         let tmp_dir = tempdir().unwrap();
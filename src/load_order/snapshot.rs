@@ -0,0 +1,167 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+use std::path::{Path, PathBuf};
+use std::time::SystemTime;
+
+use game_settings::GameSettings;
+
+/// The modification times and sizes of the files and directories that a
+/// load order's state is read from, recorded when the state is loaded so that
+/// changes to them can be detected without loading the state again.
+#[derive(Clone, Debug, Default)]
+pub struct FileSnapshot(Vec<(PathBuf, Option<FileState>)>);
+
+type FileState = (SystemTime, u64);
+
+impl FileSnapshot {
+    pub fn new(game_settings: &GameSettings) -> FileSnapshot {
+        let mut paths = vec![
+            game_settings.plugins_directory(),
+            game_settings.active_plugins_file().clone(),
+        ];
+        paths.extend(game_settings.load_order_file().cloned());
+        paths.extend(game_settings.implicitly_active_plugins_file());
+
+        FileSnapshot(
+            paths
+                .into_iter()
+                .map(|p| {
+                    let state = file_state(&p);
+                    (p, state)
+                })
+                .collect(),
+        )
+    }
+
+    /// A snapshot that has not been recorded is always stale.
+    pub fn is_stale(&self) -> bool {
+        self.0.is_empty() || self.0.iter().any(|&(ref p, ref s)| file_state(p) != *s)
+    }
+
+    /// Record the current state of the files that saving a load order writes,
+    /// so that writing them doesn't make the snapshot stale.
+    pub fn update_saved_files(&mut self, game_settings: &GameSettings) {
+        self.update(game_settings.active_plugins_file());
+
+        if let Some(path) = game_settings.load_order_file() {
+            self.update(path);
+        }
+    }
+
+    fn update(&mut self, path: &Path) {
+        for &mut (ref p, ref mut state) in &mut self.0 {
+            if p == path {
+                *state = file_state(p);
+            }
+        }
+    }
+}
+
+fn file_state(path: &Path) -> Option<FileState> {
+    path.metadata()
+        .and_then(|m| m.modified().map(|t| (t, m.len())))
+        .ok()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    use std::fs::{create_dir_all, remove_file, File};
+
+    use filetime::{set_file_times, FileTime};
+    use tempfile::tempdir;
+
+    use enums::GameId;
+    use load_order::tests::{write_active_plugins_file, write_load_order_file};
+
+    fn prepare(game_id: GameId, game_dir: &Path) -> GameSettings {
+        let settings = GameSettings::with_local_path(game_id, game_dir, game_dir).unwrap();
+        create_dir_all(settings.plugins_directory()).unwrap();
+        write_active_plugins_file(&settings, &["Blank.esp"]);
+
+        settings
+    }
+
+    #[test]
+    fn is_stale_should_be_true_for_a_default_snapshot() {
+        assert!(FileSnapshot::default().is_stale());
+    }
+
+    #[test]
+    fn is_stale_should_be_false_if_no_files_have_changed() {
+        let tmp_dir = tempdir().unwrap();
+        let settings = prepare(GameId::Oblivion, &tmp_dir.path());
+
+        assert!(!FileSnapshot::new(&settings).is_stale());
+    }
+
+    #[test]
+    fn is_stale_should_be_true_if_the_active_plugins_file_has_changed() {
+        let tmp_dir = tempdir().unwrap();
+        let settings = prepare(GameId::Oblivion, &tmp_dir.path());
+        let snapshot = FileSnapshot::new(&settings);
+
+        write_active_plugins_file(&settings, &["Blank.esp", "Blank.esm"]);
+
+        assert!(snapshot.is_stale());
+    }
+
+    #[test]
+    fn is_stale_should_be_true_if_the_load_order_file_has_been_created() {
+        let tmp_dir = tempdir().unwrap();
+        let settings = prepare(GameId::Skyrim, &tmp_dir.path());
+        let snapshot = FileSnapshot::new(&settings);
+
+        write_load_order_file(&settings, &["Skyrim.esm"]);
+
+        assert!(snapshot.is_stale());
+    }
+
+    #[test]
+    fn is_stale_should_be_true_if_a_file_has_been_added_to_the_plugins_directory() {
+        let tmp_dir = tempdir().unwrap();
+        let settings = prepare(GameId::Oblivion, &tmp_dir.path());
+        // Make sure that adding the file changes the directory's timestamp.
+        set_file_times(
+            &settings.plugins_directory(),
+            FileTime::zero(),
+            FileTime::zero(),
+        ).unwrap();
+        let snapshot = FileSnapshot::new(&settings);
+
+        let path = settings.plugins_directory().join("Blank.esp");
+        File::create(&path).unwrap();
+        remove_file(&path).unwrap();
+
+        assert!(snapshot.is_stale());
+    }
+
+    #[test]
+    fn update_saved_files_should_record_the_current_state_of_the_active_plugins_file() {
+        let tmp_dir = tempdir().unwrap();
+        let settings = prepare(GameId::Oblivion, &tmp_dir.path());
+        let mut snapshot = FileSnapshot::new(&settings);
+
+        write_active_plugins_file(&settings, &["Blank.esp", "Blank.esm"]);
+        snapshot.update_saved_files(&settings);
+
+        assert!(!snapshot.is_stale());
+    }
+}
@@ -29,6 +29,7 @@ use filetime::{set_file_times, FileTime};
 use enums::GameId;
 use enums::LoadOrderMethod;
 use game_settings::GameSettings;
+use load_order::plugin_list::PluginList;
 use plugin::Plugin;
 use tests::copy_to_test_dir;
 
@@ -75,7 +76,7 @@ pub fn set_timestamps<T: AsRef<str>>(plugins_directory: &Path, filenames: &[T])
     }
 }
 
-pub fn mock_game_files(game_id: GameId, game_dir: &Path) -> (GameSettings, Vec<Plugin>) {
+pub fn mock_game_files(game_id: GameId, game_dir: &Path) -> (GameSettings, PluginList) {
     use std::fs::create_dir;
 
     let local_path = game_dir.join("local");
@@ -93,11 +94,11 @@ pub fn mock_game_files(game_id: GameId, game_dir: &Path) -> (GameSettings, Vec<P
     );
     copy_to_test_dir("Blank.esp", "Blàñk.esp", &settings);
 
-    let plugins = vec![
+    let plugins = PluginList::from(vec![
         Plugin::new(settings.master_file(), &settings).unwrap(),
         Plugin::with_active("Blank.esp", &settings, true).unwrap(),
         Plugin::new("Blank - Different.esp", &settings).unwrap(),
-    ];
+    ]);
 
     (settings, plugins)
 }
@@ -16,9 +16,12 @@
  * You should have received a copy of the GNU General Public License
  * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
  */
-use std::fs::File;
-use std::io::{BufWriter, Read, Write};
+use std::collections::HashSet;
+use std::io;
+use std::io::Write;
 use std::path::Path;
+use std::str;
+use std::sync::Arc;
 
 use encoding::all::WINDOWS_1252;
 use encoding::{EncoderTrap, Encoding};
@@ -26,29 +29,41 @@ use unicase::eq;
 
 use super::insertable::InsertableLoadOrder;
 use super::mutable::{
-    load_active_plugins, plugin_line_mapper, read_plugin_names, MutableLoadOrder,
+    load_active_plugins, map_windows_1252_lines, plugin_line_mapper, read_plugin_names,
+    read_plugins_file, MutableLoadOrder,
 };
+use super::plugin_list::{borrowed_key, PluginList};
 use super::readable::{
-    active_plugin_names, index_of, is_active, plugin_at, plugin_names, ReadableLoadOrder,
-    ReadableLoadOrderExt,
+    active_plugin_names, index_of, is_active, plugin_at, plugin_names, plugin_states, PluginState,
+    ReadableLoadOrder, ReadableLoadOrderExt,
 };
+use super::pending::{PluginChange, SavedState};
+use super::snapshot::FileSnapshot;
 use super::writable::{activate, deactivate, set_active_plugins, WritableLoadOrder};
-use super::{create_parent_dirs, find_first_non_master_position};
-use enums::Error;
+use super::PreviousPlugins;
+use atomic_file::write_file;
+use case_insensitive::CaseInsensitiveStr;
+use enums::{Error, LoadOrderViolation};
 use game_settings::GameSettings;
-use plugin::{trim_dot_ghost, Plugin};
+use metrics::Phase;
+use plugin::Plugin;
 
 #[derive(Clone, Debug)]
 pub struct TextfileBasedLoadOrder {
     game_settings: GameSettings,
-    plugins: Vec<Plugin>,
+    // Shared between copies of the load order until one of them changes it.
+    plugins: Arc<PluginList>,
+    snapshot: FileSnapshot,
+    saved: SavedState,
 }
 
 impl TextfileBasedLoadOrder {
     pub fn new(game_settings: GameSettings) -> Self {
         Self {
             game_settings,
-            plugins: Vec::new(),
+            plugins: Arc::default(),
+            snapshot: FileSnapshot::default(),
+            saved: SavedState::default(),
         }
     }
 }
@@ -77,17 +92,21 @@ impl ReadableLoadOrder for TextfileBasedLoadOrder {
     fn is_active(&self, plugin_name: &str) -> bool {
         is_active(self.plugins(), plugin_name)
     }
+
+    fn plugin_states<'a>(&'a self) -> Vec<PluginState<'a>> {
+        plugin_states(self.plugins())
+    }
 }
 
 impl ReadableLoadOrderExt for TextfileBasedLoadOrder {
-    fn plugins(&self) -> &Vec<Plugin> {
+    fn plugins(&self) -> &PluginList {
         &self.plugins
     }
 }
 
 impl MutableLoadOrder for TextfileBasedLoadOrder {
-    fn plugins_mut(&mut self) -> &mut Vec<Plugin> {
-        &mut self.plugins
+    fn plugins_mut(&mut self) -> &mut PluginList {
+        Arc::make_mut(&mut self.plugins)
     }
 }
 
@@ -102,7 +121,7 @@ impl InsertableLoadOrder for TextfileBasedLoadOrder {
                 Some(0)
             }
         } else if plugin.is_master_file() {
-            find_first_non_master_position(self.plugins())
+            self.plugins().first_non_master_position()
         } else {
             None
         }
@@ -110,39 +129,44 @@ impl InsertableLoadOrder for TextfileBasedLoadOrder {
 }
 
 impl WritableLoadOrder for TextfileBasedLoadOrder {
+    fn boxed_clone(&self) -> Box<WritableLoadOrder> {
+        Box::new(self.clone())
+    }
+
+    fn game_settings_mut(&mut self) -> &mut GameSettings {
+        &mut self.game_settings
+    }
+
     fn load(&mut self) -> Result<(), Error> {
         self.plugins_mut().clear();
 
-        let load_order_file_exists = self.game_settings()
-            .load_order_file()
-            .map(|p| p.exists())
-            .unwrap_or(false);
+        self.load_with_previous_plugins(&PreviousPlugins::default())
+    }
 
-        let plugin_tuples = if load_order_file_exists {
-            self.read_from_load_order_file()?
-        } else {
-            self.read_from_active_plugins_file()?
-        };
+    fn refresh(&mut self) -> Result<(), Error> {
+        let previous_plugins = self.take_plugins();
 
-        let filenames = self.find_plugins_in_dir_sorted();
-        self.load_unique_plugins(plugin_tuples, filenames);
+        self.load_with_previous_plugins(&previous_plugins)
+    }
 
-        if load_order_file_exists {
-            load_active_plugins(self, plugin_line_mapper)?;
+    fn save(&mut self) -> Result<(), Error> {
+        let _timer = self.game_settings().metrics_recorder().start(Phase::Save);
+
+        // Nothing needs to be written if the load order hasn't changed since
+        // it was saved and the files it was saved to haven't changed either.
+        if self.saved.is_saved(self.plugins()) && !self.is_stale() {
+            return Ok(());
         }
 
-        self.add_implicitly_active_plugins()?;
+        self.save_load_order()?;
+        self.save_active_plugins()?;
 
-        self.deactivate_excess_plugins();
+        self.snapshot.update_saved_files(&self.game_settings);
+        self.saved = SavedState::saved(self.plugins());
 
         Ok(())
     }
 
-    fn save(&mut self) -> Result<(), Error> {
-        self.save_load_order()?;
-        self.save_active_plugins()
-    }
-
     fn set_load_order(&mut self, plugin_names: &[&str]) -> Result<(), Error> {
         if plugin_names.is_empty() || !eq(plugin_names[0], self.game_settings().master_file()) {
             return Err(Error::GameMasterMustLoadFirst);
@@ -151,6 +175,17 @@ impl WritableLoadOrder for TextfileBasedLoadOrder {
         self.replace_plugins(plugin_names)
     }
 
+    fn validate_load_order(&self, plugin_names: &[&str]) -> Vec<LoadOrderViolation> {
+        let mut violations = Vec::new();
+        if plugin_names.is_empty() || !eq(plugin_names[0], self.game_settings().master_file()) {
+            violations.push(LoadOrderViolation::GameMasterNotFirst);
+        }
+
+        violations.extend(self.find_load_order_violations(plugin_names));
+
+        violations
+    }
+
     fn set_plugin_index(&mut self, plugin_name: &str, position: usize) -> Result<(), Error> {
         if position != 0
             && !self.plugins().is_empty()
@@ -165,6 +200,14 @@ impl WritableLoadOrder for TextfileBasedLoadOrder {
         self.move_or_insert_plugin_with_index(plugin_name, position)
     }
 
+    fn pending_changes<'a>(&'a self) -> Vec<PluginChange<'a>> {
+        self.saved.changes(self.plugins())
+    }
+
+    fn is_stale(&self) -> bool {
+        self.snapshot.is_stale()
+    }
+
     fn is_self_consistent(&self) -> Result<bool, Error> {
         match self.game_settings().load_order_file() {
             None => Ok(true),
@@ -182,11 +225,17 @@ impl WritableLoadOrder for TextfileBasedLoadOrder {
                     plugin_line_mapper,
                 )?;
 
+                let active_plugin_keys: Vec<&CaseInsensitiveStr> =
+                    active_plugin_names.iter().map(|a| borrowed_key(a)).collect();
+                let active_plugin_key_set: HashSet<&CaseInsensitiveStr> =
+                    active_plugin_keys.iter().cloned().collect();
+
                 let are_equal = load_order_plugin_names
                     .iter()
-                    .filter(|l| active_plugin_names.iter().any(|a| plugin_names_match(a, l)))
-                    .zip(active_plugin_names.iter())
-                    .all(|(l, a)| plugin_names_match(&l, &a));
+                    .map(|l| borrowed_key(l))
+                    .filter(|l| active_plugin_key_set.contains(l))
+                    .zip(active_plugin_keys.iter())
+                    .all(|(l, a)| l == *a);
 
                 Ok(are_equal)
             }
@@ -207,15 +256,71 @@ impl WritableLoadOrder for TextfileBasedLoadOrder {
 }
 
 impl TextfileBasedLoadOrder {
+    fn load_with_previous_plugins(
+        &mut self,
+        previous_plugins: &PreviousPlugins,
+    ) -> Result<(), Error> {
+        let _timer = self.game_settings().metrics_recorder().start(Phase::Load);
+
+        self.game_settings_mut().refresh_implicitly_active_plugins()?;
+        self.snapshot = FileSnapshot::new(self.game_settings());
+
+        let load_order_file_exists = self.game_settings()
+            .load_order_file()
+            .map(|p| p.exists())
+            .unwrap_or(false);
+
+        let plugin_tuples = if load_order_file_exists {
+            self.read_from_load_order_file()?
+        } else {
+            self.read_from_active_plugins_file()?
+        };
+
+        let files = self.find_plugins_in_dir_sorted();
+        self.load_unique_plugins(plugin_tuples, files, previous_plugins);
+
+        if load_order_file_exists {
+            load_active_plugins(self, plugin_line_mapper)?;
+        }
+
+        self.add_implicitly_active_plugins()?;
+
+        self.deactivate_excess_plugins();
+
+        let game_settings = self.game_settings();
+        game_settings
+            .plugin_cache()
+            .flush(game_settings.metrics_recorder());
+
+        self.saved = SavedState::loaded(self.plugins());
+
+        Ok(())
+    }
+
     fn read_from_load_order_file(&self) -> Result<Vec<(String, bool)>, Error> {
+        let _timer = self.game_settings()
+            .metrics_recorder()
+            .start(Phase::ReadPluginLists);
+
         match self.game_settings().load_order_file() {
-            Some(file_path) => read_utf8_plugin_names(file_path, load_order_line_mapper)
-                .or_else(|_| read_plugin_names(file_path, load_order_line_mapper)),
+            Some(file_path) => match read_plugins_file(file_path)? {
+                // The file is usually UTF-8 encoded, but may be Windows-1252 encoded, so fall
+                // back to decoding its content as that.
+                Some(content) => match str::from_utf8(&content) {
+                    Ok(x) => Ok(x.lines().filter_map(load_order_line_mapper).collect()),
+                    Err(_) => map_windows_1252_lines(&content, load_order_line_mapper),
+                },
+                None => Ok(Vec::new()),
+            },
             None => Ok(Vec::new()),
         }
     }
 
     fn read_from_active_plugins_file(&self) -> Result<Vec<(String, bool)>, Error> {
+        let _timer = self.game_settings()
+            .metrics_recorder()
+            .start(Phase::ReadPluginLists);
+
         read_plugin_names(
             self.game_settings().active_plugins_file(),
             active_plugin_line_mapper,
@@ -224,30 +329,42 @@ impl TextfileBasedLoadOrder {
 
     fn save_load_order(&self) -> Result<(), Error> {
         if let Some(file_path) = self.game_settings().load_order_file() {
-            create_parent_dirs(file_path)?;
-
-            let file = File::create(file_path)?;
-            let mut writer = BufWriter::new(file);
+            let mut content: Vec<u8> = Vec::new();
             for plugin_name in self.plugin_names() {
-                writeln!(writer, "{}", plugin_name)?;
+                writeln!(content, "{}", plugin_name)?;
             }
+
+            let _timer = self.game_settings()
+                .metrics_recorder()
+                .start(Phase::WritePluginLists);
+            write_file(
+                file_path,
+                &content,
+                self.game_settings().write_durability(),
+                self.game_settings().metrics_recorder(),
+            )?;
         }
         Ok(())
     }
 
     fn save_active_plugins(&self) -> Result<(), Error> {
-        create_parent_dirs(self.game_settings().active_plugins_file())?;
-
-        let file = File::create(self.game_settings().active_plugins_file())?;
-        let mut writer = BufWriter::new(file);
+        let mut content: Vec<u8> = Vec::new();
         for plugin_name in self.active_plugin_names() {
-            writer.write_all(&WINDOWS_1252
+            content.write_all(&WINDOWS_1252
                 .encode(&plugin_name, EncoderTrap::Strict)
                 .map_err(Error::EncodeError)?)?;
-            writeln!(writer)?;
+            writeln!(content)?;
         }
 
-        Ok(())
+        let _timer = self.game_settings()
+            .metrics_recorder()
+            .start(Phase::WritePluginLists);
+        write_file(
+            self.game_settings().active_plugins_file(),
+            &content,
+            self.game_settings().write_durability(),
+            self.game_settings().metrics_recorder(),
+        )
     }
 }
 
@@ -256,13 +373,13 @@ where
     F: Fn(&str) -> Option<T> + Send + Sync,
     T: Send,
 {
-    if !file_path.exists() {
-        return Ok(Vec::new());
-    }
+    let content = match read_plugins_file(file_path)? {
+        Some(x) => x,
+        None => return Ok(Vec::new()),
+    };
 
-    let mut content: String = String::new();
-    let mut file = File::open(file_path)?;
-    file.read_to_string(&mut content)?;
+    let content =
+        str::from_utf8(&content).map_err(|e| io::Error::new(io::ErrorKind::InvalidData, e))?;
 
     Ok(content.lines().filter_map(line_mapper).collect())
 }
@@ -275,10 +392,6 @@ fn active_plugin_line_mapper(line: &str) -> Option<(String, bool)> {
     plugin_line_mapper(line).map(|s| (s, true))
 }
 
-fn plugin_names_match(name1: &str, name2: &str) -> bool {
-    eq(trim_dot_ghost(name1), trim_dot_ghost(name2))
-}
-
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -286,7 +399,8 @@ mod tests {
     use enums::GameId;
     use filetime::{set_file_times, FileTime};
     use load_order::tests::*;
-    use std::fs::{remove_dir_all, File};
+    use plugin_cache::PluginCache;
+    use std::fs::{remove_dir_all, remove_file, File};
     use std::io::Write;
     use std::path::Path;
     use tempfile::tempdir;
@@ -296,7 +410,9 @@ mod tests {
         let (game_settings, plugins) = mock_game_files(game_id, game_dir);
         TextfileBasedLoadOrder {
             game_settings,
-            plugins,
+            plugins: Arc::new(plugins),
+            snapshot: FileSnapshot::default(),
+            saved: SavedState::default(),
         }
     }
 
@@ -702,6 +818,140 @@ mod tests {
         assert_eq!(expected_filenames, load_order.plugin_names());
     }
 
+    #[test]
+    fn is_stale_should_be_true_if_the_load_order_file_has_changed_since_loading() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Skyrim, &tmp_dir.path());
+        load_order.load().unwrap();
+        assert!(!load_order.is_stale());
+
+        write_load_order_file(load_order.game_settings(), &["Skyrim.esm", "Blank.esp"]);
+
+        assert!(load_order.is_stale());
+    }
+
+    #[test]
+    fn is_stale_should_be_false_after_saving() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Skyrim, &tmp_dir.path());
+        load_order.load().unwrap();
+
+        load_order.activate("Blank.esp").unwrap();
+        load_order.save().unwrap();
+
+        assert!(!load_order.is_stale());
+    }
+
+    #[test]
+    fn refresh_should_reread_modified_plugins() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Skyrim, &tmp_dir.path());
+        load_order.load().unwrap();
+
+        let index = load_order.index_of("Blank.esp").unwrap();
+        assert!(!load_order.plugins()[index].is_master_file());
+        copy_to_test_dir("Blank.esm", "Blank.esp", &load_order.game_settings());
+        let plugin_path = load_order
+            .game_settings()
+            .plugins_directory()
+            .join("Blank.esp");
+        set_file_times(&plugin_path, FileTime::zero(), FileTime::zero()).unwrap();
+
+        load_order.refresh().unwrap();
+
+        let index = load_order.index_of("Blank.esp").unwrap();
+        assert!(load_order.plugins()[index].is_master_file());
+    }
+
+    #[test]
+    fn refresh_should_reuse_unmodified_plugins() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Skyrim, &tmp_dir.path());
+        load_order.load().unwrap();
+
+        let plugin_path = load_order
+            .game_settings()
+            .plugins_directory()
+            .join("Blank.esm");
+        let mtime = plugin_path.metadata().unwrap().modified().unwrap();
+        copy_to_test_dir("Blank.esp", "Blank.esm", &load_order.game_settings());
+        set_file_times(
+            &plugin_path,
+            FileTime::zero(),
+            FileTime::from_system_time(mtime),
+        ).unwrap();
+
+        load_order.refresh().unwrap();
+
+        let index = load_order.index_of("Blank.esm").unwrap();
+        assert!(load_order.plugins()[index].is_master_file());
+    }
+
+    #[test]
+    fn copies_should_share_plugins_until_one_of_them_changes_them() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Skyrim, &tmp_dir.path());
+        load_order.load().unwrap();
+
+        let mut copy = load_order.clone();
+        copy.game_settings_mut().set_io_concurrency(1);
+        assert!(Arc::ptr_eq(&load_order.plugins, &copy.plugins));
+
+        copy.activate("Blank.esp").unwrap();
+        assert!(!Arc::ptr_eq(&load_order.plugins, &copy.plugins));
+        assert!(!load_order.is_active("Blank.esp"));
+    }
+
+    #[test]
+    fn refresh_should_keep_unmodified_plugins_in_the_plugin_cache() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Skyrim, &tmp_dir.path());
+        let cache_path = tmp_dir.path().join("cache");
+        load_order
+            .game_settings_mut()
+            .set_plugin_cache_path(Some(&cache_path))
+            .unwrap();
+        load_order.load().unwrap();
+
+        load_order.refresh().unwrap();
+
+        let cache = PluginCache::load(GameId::Skyrim, &cache_path).unwrap();
+        let plugin_path = load_order
+            .game_settings()
+            .plugins_directory()
+            .join("Blank.esm");
+        assert!(
+            cache
+                .get(&plugin_path, &plugin_path.metadata().unwrap())
+                .is_some()
+        );
+    }
+
+    #[test]
+    fn refresh_should_add_new_plugins_and_remove_deleted_plugins() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Skyrim, &tmp_dir.path());
+        load_order.load().unwrap();
+
+        assert!(load_order.index_of("Blank - Different.esm").is_none());
+        copy_to_test_dir(
+            "Blank - Different.esm",
+            "Blank - Different.esm",
+            &load_order.game_settings(),
+        );
+        remove_file(
+            load_order
+                .game_settings()
+                .plugins_directory()
+                .join("Blank - Different.esp"),
+        ).unwrap();
+
+        load_order.refresh().unwrap();
+
+        assert!(load_order.index_of("Blank - Different.esm").is_some());
+        assert!(load_order.index_of("Blank - Different.esp").is_none());
+    }
+
     #[test]
     fn save_should_write_all_plugins_to_load_order_file() {
         let tmp_dir = tempdir().unwrap();
@@ -756,6 +1006,25 @@ mod tests {
         );
     }
 
+    #[test]
+    fn save_should_not_write_files_if_nothing_has_changed_since_saving() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Skyrim, &tmp_dir.path());
+
+        load_order.load().unwrap();
+        load_order.save().unwrap();
+        load_order.game_settings_mut().set_metrics_enabled(true);
+        load_order.save().unwrap();
+
+        assert_eq!(0, load_order.game_settings().metrics().write_plugin_lists.calls);
+
+        remove_file(load_order.game_settings().active_plugins_file()).unwrap();
+        load_order.save().unwrap();
+
+        assert_eq!(2, load_order.game_settings().metrics().write_plugin_lists.calls);
+        assert!(load_order.game_settings().active_plugins_file().exists());
+    }
+
     #[test]
     fn set_load_order_should_error_if_given_an_empty_list() {
         let tmp_dir = tempdir().unwrap();
@@ -856,6 +1125,57 @@ mod tests {
         assert!(load_order.is_active("Blank.esp"));
     }
 
+    #[test]
+    fn validate_load_order_should_return_no_violations_for_a_valid_load_order() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Skyrim, &tmp_dir.path());
+        load_order.load().unwrap();
+
+        let filenames = vec![
+            "Skyrim.esm",
+            "Blank.esm",
+            "Blank.esp",
+            "Blank - Master Dependent.esp",
+        ];
+
+        assert!(load_order.validate_load_order(&filenames).is_empty());
+    }
+
+    #[test]
+    fn validate_load_order_should_return_all_violations() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Skyrim, &tmp_dir.path());
+        load_order.load().unwrap();
+
+        let filenames = vec!["Blank.esp", "Blank.esm", "blank.esp", "missing.esp"];
+
+        assert_eq!(
+            vec![
+                LoadOrderViolation::GameMasterNotFirst,
+                LoadOrderViolation::NonMasterBeforeMaster(1),
+                LoadOrderViolation::DuplicatePlugin(2),
+                LoadOrderViolation::UnknownPlugin(3),
+            ],
+            load_order.validate_load_order(&filenames)
+        );
+    }
+
+    #[test]
+    fn validate_load_order_should_not_read_plugins_that_are_not_loaded() {
+        let tmp_dir = tempdir().unwrap();
+        let load_order = prepare(GameId::Skyrim, &tmp_dir.path());
+
+        copy_to_test_dir("Blank.esm", "New.esm", &load_order.game_settings());
+
+        let filenames = vec!["Skyrim.esm", "New.esm"];
+
+        assert_eq!(
+            vec![LoadOrderViolation::UnknownPlugin(1)],
+            load_order.validate_load_order(&filenames)
+        );
+        assert!(load_order.index_of("New.esm").is_none());
+    }
+
     #[test]
     fn set_plugin_index_should_error_if_setting_the_game_master_index_to_non_zero_in_bounds() {
         let tmp_dir = tempdir().unwrap();
@@ -938,4 +1258,20 @@ mod tests {
 
         assert!(load_order.is_self_consistent().unwrap());
     }
+
+    #[test]
+    fn is_self_consistent_should_ignore_case_and_ghost_extensions() {
+        let tmp_dir = tempdir().unwrap();
+        let load_order = prepare(GameId::Skyrim, &tmp_dir.path());
+
+        write_active_plugins_file(
+            load_order.game_settings(),
+            &["BLÀÑK.ESP", "Blank.esm.ghost", "missing.esp"],
+        );
+
+        let expected_filenames = vec!["Skyrim.esm", "blàñk.esp", "Blank.esm", "Missing.esp.ghost"];
+        write_load_order_file(load_order.game_settings(), &expected_filenames);
+
+        assert!(load_order.is_self_consistent().unwrap());
+    }
 }
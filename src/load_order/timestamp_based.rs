@@ -18,7 +18,8 @@
  */
 use std::cmp::Ordering;
 use std::fs::File;
-use std::io::{BufRead, BufReader, BufWriter, Write};
+use std::io::{BufRead, BufReader, Write};
+use std::sync::{Arc, OnceLock};
 use std::time::{Duration, SystemTime, UNIX_EPOCH};
 
 use encoding::all::WINDOWS_1252;
@@ -28,14 +29,19 @@ use regex::Regex;
 
 use super::insertable::InsertableLoadOrder;
 use super::mutable::{load_active_plugins, MutableLoadOrder};
+use super::plugin_list::PluginList;
 use super::readable::{
-    active_plugin_names, index_of, is_active, plugin_at, plugin_names, ReadableLoadOrder,
-    ReadableLoadOrderExt,
+    active_plugin_names, index_of, is_active, plugin_at, plugin_names, plugin_states, PluginState,
+    ReadableLoadOrder, ReadableLoadOrderExt,
 };
+use super::pending::{PluginChange, SavedState};
+use super::snapshot::FileSnapshot;
 use super::writable::{activate, deactivate, set_active_plugins, WritableLoadOrder};
-use super::{create_parent_dirs, find_first_non_master_position};
-use enums::{Error, GameId};
+use super::PreviousPlugins;
+use atomic_file::write_file;
+use enums::{Error, GameId, LoadOrderViolation};
 use game_settings::GameSettings;
+use metrics::{Counter, Phase};
 use plugin::Plugin;
 
 const GAME_FILES_HEADER: &[u8] = b"[Game Files]";
@@ -43,14 +49,19 @@ const GAME_FILES_HEADER: &[u8] = b"[Game Files]";
 #[derive(Clone, Debug)]
 pub struct TimestampBasedLoadOrder {
     game_settings: GameSettings,
-    plugins: Vec<Plugin>,
+    // Shared between copies of the load order until one of them changes it.
+    plugins: Arc<PluginList>,
+    snapshot: FileSnapshot,
+    saved: SavedState,
 }
 
 impl TimestampBasedLoadOrder {
     pub fn new(game_settings: GameSettings) -> Self {
         Self {
             game_settings,
-            plugins: Vec::new(),
+            plugins: Arc::default(),
+            snapshot: FileSnapshot::default(),
+            saved: SavedState::default(),
         }
     }
 }
@@ -79,24 +90,28 @@ impl ReadableLoadOrder for TimestampBasedLoadOrder {
     fn is_active(&self, plugin_name: &str) -> bool {
         is_active(self.plugins(), plugin_name)
     }
+
+    fn plugin_states<'a>(&'a self) -> Vec<PluginState<'a>> {
+        plugin_states(self.plugins())
+    }
 }
 
 impl ReadableLoadOrderExt for TimestampBasedLoadOrder {
-    fn plugins(&self) -> &Vec<Plugin> {
+    fn plugins(&self) -> &PluginList {
         &self.plugins
     }
 }
 
 impl MutableLoadOrder for TimestampBasedLoadOrder {
-    fn plugins_mut(&mut self) -> &mut Vec<Plugin> {
-        &mut self.plugins
+    fn plugins_mut(&mut self) -> &mut PluginList {
+        Arc::make_mut(&mut self.plugins)
     }
 }
 
 impl InsertableLoadOrder for TimestampBasedLoadOrder {
     fn insert_position(&self, plugin: &Plugin) -> Option<usize> {
         if plugin.is_master_file() {
-            find_first_non_master_position(self.plugins())
+            self.plugins().first_non_master_position()
         } else {
             None
         }
@@ -104,44 +119,62 @@ impl InsertableLoadOrder for TimestampBasedLoadOrder {
 }
 
 impl WritableLoadOrder for TimestampBasedLoadOrder {
-    fn load(&mut self) -> Result<(), Error> {
-        self.plugins_mut().clear();
-
-        self.plugins = load_plugins_from_dir(self);
-        self.plugins.par_sort_by(plugin_sorter);
+    fn boxed_clone(&self) -> Box<WritableLoadOrder> {
+        Box::new(self.clone())
+    }
 
-        let regex = Regex::new(r"(?i)GameFile[0-9]{1,3}=(.+\.es(?:m|p))")?;
-        let game_id = self.game_settings().id();
-        let line_mapper = |line: &str| plugin_line_mapper(line, &regex, game_id);
+    fn game_settings_mut(&mut self) -> &mut GameSettings {
+        &mut self.game_settings
+    }
 
-        load_active_plugins(self, line_mapper)?;
+    fn load(&mut self) -> Result<(), Error> {
+        self.plugins_mut().clear();
 
-        self.add_implicitly_active_plugins()?;
+        self.load_with_previous_plugins(&PreviousPlugins::default())
+    }
 
-        self.deactivate_excess_plugins();
+    fn refresh(&mut self) -> Result<(), Error> {
+        let previous_plugins = self.take_plugins();
 
-        Ok(())
+        self.load_with_previous_plugins(&previous_plugins)
     }
 
     fn save(&mut self) -> Result<(), Error> {
-        let timestamps = padded_unique_timestamps(self.plugins());
+        let metrics = self.game_settings().metrics_recorder().clone();
+        let _timer = metrics.start(Phase::Save);
 
-        let result: Result<Vec<()>, Error> = self.plugins_mut()
-            .par_iter_mut()
-            .zip(timestamps.into_par_iter())
-            .map(|(ref mut plugin, timestamp)| plugin.set_modification_time(timestamp))
-            .collect();
+        // Nothing needs to be written if the load order hasn't changed since
+        // it was saved and the files it was saved to haven't changed either.
+        if self.saved.is_saved(self.plugins()) && !self.is_stale() {
+            return Ok(());
+        }
+
+        let timestamps = padded_unique_timestamps(self.plugins());
 
-        match result {
-            Ok(_) => save_active_plugins(self),
-            Err(e) => Err(e),
+        {
+            let _timer = metrics.start(Phase::SetFileTimes);
+            let parallelism = self.game_settings().parallelism().clone();
+            let written_count = self.plugins_mut()
+                .set_modification_times(timestamps, &parallelism)?;
+            metrics.add(Counter::FileTimesSet, written_count as u64);
         }
+
+        save_active_plugins(self)?;
+
+        self.snapshot.update_saved_files(&self.game_settings);
+        self.saved = SavedState::saved(self.plugins());
+
+        Ok(())
     }
 
     fn set_load_order(&mut self, plugin_names: &[&str]) -> Result<(), Error> {
         self.replace_plugins(plugin_names)
     }
 
+    fn validate_load_order(&self, plugin_names: &[&str]) -> Vec<LoadOrderViolation> {
+        self.find_load_order_violations(plugin_names)
+    }
+
     fn set_plugin_index(&mut self, plugin_name: &str, position: usize) -> Result<(), Error> {
         self.move_or_insert_plugin_with_index(plugin_name, position)
     }
@@ -150,6 +183,23 @@ impl WritableLoadOrder for TimestampBasedLoadOrder {
         Ok(true)
     }
 
+    fn pending_changes<'a>(&'a self) -> Vec<PluginChange<'a>> {
+        self.saved.changes(self.plugins())
+    }
+
+    // Plugin timestamps define the load order, but changing them doesn't
+    // change the plugins directory's timestamp, so check them too.
+    fn is_stale(&self) -> bool {
+        let parallelism = self.game_settings().parallelism();
+
+        self.snapshot.is_stale() || parallelism.install(|| {
+            self.plugins()
+                .par_iter_unordered()
+                .with_min_len(parallelism.sequential_threshold())
+                .any(|p| p.has_modification_time_changed())
+        })
+    }
+
     fn activate(&mut self, plugin_name: &str) -> Result<(), Error> {
         activate(self, plugin_name)
     }
@@ -163,14 +213,70 @@ impl WritableLoadOrder for TimestampBasedLoadOrder {
     }
 }
 
-fn load_plugins_from_dir<T: ReadableLoadOrderExt>(load_order: &T) -> Vec<Plugin> {
-    let filenames = load_order.find_plugins_in_dir();
-    let game_settings = load_order.game_settings();
+impl TimestampBasedLoadOrder {
+    fn load_with_previous_plugins(
+        &mut self,
+        previous_plugins: &PreviousPlugins,
+    ) -> Result<(), Error> {
+        let _timer = self.game_settings().metrics_recorder().start(Phase::Load);
 
-    filenames
-        .par_iter()
-        .filter_map(|f| Plugin::new(&f, game_settings).ok())
-        .collect()
+        self.game_settings_mut().refresh_implicitly_active_plugins()?;
+        self.snapshot = FileSnapshot::new(self.game_settings());
+
+        let mut plugins = load_plugins_from_dir(self, previous_plugins);
+        {
+            let parallelism = self.game_settings().parallelism();
+            if parallelism.is_sequential(plugins.len()) {
+                plugins.sort_by(plugin_sorter);
+            } else {
+                parallelism.install(|| plugins.par_sort_by(plugin_sorter));
+            }
+        }
+        self.plugins = Arc::new(PluginList::from(plugins));
+
+        let regex = if self.game_settings().id() == GameId::Morrowind {
+            Some(morrowind_game_file_regex()?)
+        } else {
+            None
+        };
+        let line_mapper = |line: &str| plugin_line_mapper(line, regex);
+
+        load_active_plugins(self, line_mapper)?;
+
+        self.add_implicitly_active_plugins()?;
+
+        self.deactivate_excess_plugins();
+
+        let game_settings = self.game_settings();
+        game_settings
+            .plugin_cache()
+            .flush(game_settings.metrics_recorder());
+
+        self.saved = SavedState::loaded(self.plugins());
+
+        Ok(())
+    }
+}
+
+fn load_plugins_from_dir<T: ReadableLoadOrderExt>(
+    load_order: &T,
+    previous_plugins: &PreviousPlugins,
+) -> Vec<Plugin> {
+    let files = load_order.find_plugins_in_dir();
+    let game_settings = load_order.game_settings();
+    let _timer = game_settings.metrics_recorder().start(Phase::LoadPlugins);
+
+    let parallelism = game_settings.parallelism();
+    parallelism.install(|| {
+        files
+            .par_iter()
+            .with_min_len(parallelism.sequential_threshold())
+            .filter_map(|f| {
+                let previous = previous_plugins.get(&f.filename);
+                Plugin::from_file(&f.filename, f, game_settings, false, previous).ok()
+            })
+            .collect()
+    })
 }
 
 fn plugin_sorter(a: &Plugin, b: &Plugin) -> Ordering {
@@ -186,8 +292,21 @@ fn plugin_sorter(a: &Plugin, b: &Plugin) -> Ordering {
     }
 }
 
-fn plugin_line_mapper(mut line: &str, regex: &Regex, game_id: GameId) -> Option<String> {
-    if game_id == GameId::Morrowind {
+/// Gets the regex that matches the plugin entries in `Morrowind.ini`, which is
+/// only compiled the first time it is needed.
+fn morrowind_game_file_regex() -> Result<&'static Regex, Error> {
+    static REGEX: OnceLock<Regex> = OnceLock::new();
+
+    if let Some(regex) = REGEX.get() {
+        return Ok(regex);
+    }
+
+    let regex = Regex::new(r"(?i)GameFile[0-9]{1,3}=(.+\.es(?:m|p))")?;
+    Ok(REGEX.get_or_init(|| regex))
+}
+
+fn plugin_line_mapper(mut line: &str, regex: Option<&Regex>) -> Option<String> {
+    if let Some(regex) = regex {
         line = regex
             .captures(&line)
             .and_then(|c| c.get(1))
@@ -201,7 +320,7 @@ fn plugin_line_mapper(mut line: &str, regex: &Regex, game_id: GameId) -> Option<
     }
 }
 
-fn padded_unique_timestamps(plugins: &[Plugin]) -> Vec<SystemTime> {
+fn padded_unique_timestamps(plugins: &PluginList) -> Vec<SystemTime> {
     let mut timestamps: Vec<SystemTime> = plugins.iter().map(Plugin::modification_time).collect();
 
     timestamps.sort();
@@ -216,24 +335,28 @@ fn padded_unique_timestamps(plugins: &[Plugin]) -> Vec<SystemTime> {
 }
 
 fn save_active_plugins<T: ReadableLoadOrderExt>(load_order: &mut T) -> Result<(), Error> {
-    create_parent_dirs(load_order.game_settings().active_plugins_file())?;
-
-    let prelude = get_file_prelude(load_order.game_settings())?;
+    let mut content = get_file_prelude(load_order.game_settings())?;
 
-    let file = File::create(&load_order.game_settings().active_plugins_file())?;
-    let mut writer = BufWriter::new(file);
-    writer.write_all(&prelude)?;
     for (index, plugin_name) in load_order.active_plugin_names().iter().enumerate() {
         if load_order.game_settings().id() == GameId::Morrowind {
-            write!(writer, "GameFile{}=", index)?;
+            write!(content, "GameFile{}=", index)?;
         }
-        writer.write_all(&WINDOWS_1252
+        content.write_all(&WINDOWS_1252
             .encode(plugin_name, EncoderTrap::Strict)
             .map_err(Error::EncodeError)?)?;
-        writeln!(writer)?;
+        writeln!(content)?;
     }
 
-    Ok(())
+    let _timer = load_order
+        .game_settings()
+        .metrics_recorder()
+        .start(Phase::WritePluginLists);
+    write_file(
+        load_order.game_settings().active_plugins_file(),
+        &content,
+        load_order.game_settings().write_durability(),
+        load_order.game_settings().metrics_recorder(),
+    )
 }
 
 fn get_file_prelude(game_settings: &GameSettings) -> Result<Vec<u8>, Error> {
@@ -263,7 +386,9 @@ mod tests {
     use enums::GameId;
     use filetime::{set_file_times, FileTime};
     use load_order::tests::*;
-    use std::fs::{remove_dir_all, File};
+    use load_order::readable::MAX_ACTIVE_NORMAL_PLUGINS;
+    use metrics::Metrics;
+    use std::fs::{remove_dir_all, remove_file, File};
     use std::io::{Read, Write};
     use std::path::Path;
     use tempfile::tempdir;
@@ -273,7 +398,9 @@ mod tests {
         let (game_settings, plugins) = mock_game_files(game_id, game_dir);
         TimestampBasedLoadOrder {
             game_settings,
-            plugins,
+            plugins: Arc::new(plugins),
+            snapshot: FileSnapshot::default(),
+            saved: SavedState::default(),
         }
     }
 
@@ -337,6 +464,96 @@ mod tests {
         assert!(load_order.plugins()[1].is_master_file());
     }
 
+    #[test]
+    fn load_and_save_should_give_the_same_results_in_parallel_and_sequentially() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, &tmp_dir.path());
+
+        load_order.load().unwrap();
+        let sequential_names = to_owned(load_order.plugin_names());
+
+        load_order.game_settings_mut().set_thread_count(2).unwrap();
+        load_order.game_settings_mut().set_sequential_threshold(1);
+        load_order.load().unwrap();
+
+        assert_eq!(sequential_names, load_order.plugin_names());
+
+        let last = sequential_names.len() - 1;
+        load_order
+            .set_plugin_index(&sequential_names[last], last - 1)
+            .unwrap();
+        let names = to_owned(load_order.plugin_names());
+        assert_ne!(sequential_names, names);
+        load_order.save().unwrap();
+        load_order.load().unwrap();
+
+        assert_eq!(names, load_order.plugin_names());
+    }
+
+    #[test]
+    fn load_should_write_the_plugin_cache_if_a_cache_path_is_set() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, &tmp_dir.path());
+        let cache_path = tmp_dir.path().join("local").join("plugins.cache");
+
+        load_order
+            .game_settings_mut()
+            .set_plugin_cache_path(Some(&cache_path))
+            .unwrap();
+        load_order.load().unwrap();
+
+        assert!(cache_path.exists());
+
+        let plugin_names = to_owned(load_order.plugin_names());
+        load_order.load().unwrap();
+
+        assert_eq!(plugin_names, load_order.plugin_names());
+        assert!(load_order.plugins()[0].is_master_file());
+    }
+
+    #[test]
+    fn load_and_refresh_should_record_metrics_if_they_are_enabled() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, &tmp_dir.path());
+
+        load_order.game_settings_mut().set_metrics_enabled(true);
+        load_order.load().unwrap();
+
+        let metrics = load_order.game_settings().metrics();
+        assert_eq!(1, metrics.load.calls);
+        assert_eq!(1, metrics.find_plugins.calls);
+        assert_eq!(1, metrics.load_plugins.calls);
+        assert_eq!(1, metrics.read_plugin_lists.calls);
+        assert_eq!(0, metrics.save.calls);
+        assert_eq!(6, metrics.plugin_files_scanned);
+        assert_eq!(6, metrics.plugin_headers_parsed);
+        assert_eq!(0, metrics.plugin_headers_reused);
+        assert_eq!(7, metrics.file_opens);
+        assert!(metrics.file_reads >= 6);
+        assert_eq!(12, metrics.file_stats);
+        assert_eq!(0, metrics.file_renames);
+        assert!(metrics.load.total_time >= metrics.find_plugins.total_time);
+
+        load_order.refresh().unwrap();
+
+        let metrics = load_order.game_settings().metrics();
+        assert_eq!(2, metrics.load.calls);
+        assert_eq!(6, metrics.plugin_headers_parsed);
+        assert_eq!(6, metrics.plugin_headers_reused);
+        assert_eq!(8, metrics.file_opens);
+        assert_eq!(18, metrics.file_stats);
+    }
+
+    #[test]
+    fn load_should_not_record_metrics_if_they_are_disabled() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, &tmp_dir.path());
+
+        load_order.load().unwrap();
+
+        assert_eq!(Metrics::default(), load_order.game_settings().metrics());
+    }
+
     #[test]
     fn load_should_remove_plugins_that_fail_to_load() {
         let tmp_dir = tempdir().unwrap();
@@ -535,6 +752,121 @@ mod tests {
         assert_eq!(plugins, active_plugin_names);
     }
 
+    #[test]
+    fn is_stale_should_be_true_if_the_load_order_has_not_been_loaded() {
+        let tmp_dir = tempdir().unwrap();
+        let load_order = prepare(GameId::Oblivion, &tmp_dir.path());
+
+        assert!(load_order.is_stale());
+    }
+
+    #[test]
+    fn is_stale_should_be_false_if_nothing_has_changed_since_loading() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, &tmp_dir.path());
+        load_order.load().unwrap();
+
+        assert!(!load_order.is_stale());
+    }
+
+    #[test]
+    fn is_stale_should_be_true_if_a_plugin_timestamp_has_changed_since_loading() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, &tmp_dir.path());
+        load_order.load().unwrap();
+
+        let plugin_path = load_order
+            .game_settings()
+            .plugins_directory()
+            .join("Blank.esp");
+        set_file_times(&plugin_path, FileTime::zero(), FileTime::zero()).unwrap();
+
+        assert!(load_order.is_stale());
+    }
+
+    #[test]
+    fn is_stale_should_be_false_after_saving() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, &tmp_dir.path());
+        load_order.load().unwrap();
+
+        load_order.set_plugin_index("Blank.esp", 2).unwrap();
+        load_order.activate("Blank.esp").unwrap();
+        load_order.save().unwrap();
+
+        assert!(!load_order.is_stale());
+    }
+
+    #[test]
+    fn refresh_should_reread_modified_plugins() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, &tmp_dir.path());
+        load_order.load().unwrap();
+
+        let index = load_order.index_of("Blank.esp").unwrap();
+        assert!(!load_order.plugins()[index].is_master_file());
+        copy_to_test_dir("Blank.esm", "Blank.esp", &load_order.game_settings());
+        let plugin_path = load_order
+            .game_settings()
+            .plugins_directory()
+            .join("Blank.esp");
+        set_file_times(&plugin_path, FileTime::zero(), FileTime::zero()).unwrap();
+
+        load_order.refresh().unwrap();
+
+        let index = load_order.index_of("Blank.esp").unwrap();
+        assert!(load_order.plugins()[index].is_master_file());
+    }
+
+    #[test]
+    fn refresh_should_reuse_unmodified_plugins() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, &tmp_dir.path());
+        load_order.load().unwrap();
+
+        let plugin_path = load_order
+            .game_settings()
+            .plugins_directory()
+            .join("Blank.esm");
+        let mtime = plugin_path.metadata().unwrap().modified().unwrap();
+        copy_to_test_dir("Blank.esp", "Blank.esm", &load_order.game_settings());
+        set_file_times(
+            &plugin_path,
+            FileTime::zero(),
+            FileTime::from_system_time(mtime),
+        ).unwrap();
+
+        load_order.refresh().unwrap();
+
+        let index = load_order.index_of("Blank.esm").unwrap();
+        assert!(load_order.plugins()[index].is_master_file());
+    }
+
+    #[test]
+    fn refresh_should_add_new_plugins_and_remove_deleted_plugins() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, &tmp_dir.path());
+        load_order.load().unwrap();
+
+        assert!(load_order.index_of("Blank - Different.esm").is_none());
+        copy_to_test_dir(
+            "Blank - Different.esm",
+            "Blank - Different.esm",
+            &load_order.game_settings(),
+        );
+        remove_file(
+            load_order
+                .game_settings()
+                .plugins_directory()
+                .join("Blank - Different.esp"),
+        ).unwrap();
+
+        load_order.refresh().unwrap();
+
+        assert!(load_order.index_of("Blank - Different.esm").is_some());
+        assert!(load_order.index_of("Blank - Different.esp").is_none());
+    }
+
     #[test]
     fn save_should_preserve_the_existing_set_of_timestamps() {
         let tmp_dir = tempdir().unwrap();
@@ -594,9 +926,11 @@ mod tests {
         );
 
         // Give two files the same timestamp.
-        load_order.plugins_mut()[1]
-            .set_modification_time(UNIX_EPOCH + Duration::new(2, 0))
-            .unwrap();
+        let plugin_path = load_order
+            .game_settings()
+            .plugins_directory()
+            .join(load_order.plugins()[1].name());
+        set_file_times(&plugin_path, FileTime::zero(), FileTime::from_unix_time(2, 0)).unwrap();
 
         load_order.load().unwrap();
 
@@ -641,6 +975,77 @@ mod tests {
         );
     }
 
+    #[test]
+    fn save_should_record_the_number_of_timestamps_written_if_metrics_are_enabled() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, &tmp_dir.path());
+
+        for plugin in load_order.plugins() {
+            let path = load_order.game_settings().plugins_directory().join(plugin.name());
+            set_file_times(&path, FileTime::zero(), FileTime::zero()).unwrap();
+        }
+        load_order.load().unwrap();
+
+        load_order.game_settings_mut().set_metrics_enabled(true);
+        load_order.save().unwrap();
+
+        let metrics = load_order.game_settings().metrics();
+        let written_count = metrics.file_times_set;
+        assert!(written_count > 0);
+
+        // Nothing has changed since the first save, so nothing is written.
+        load_order.save().unwrap();
+
+        let metrics = load_order.game_settings().metrics();
+        assert_eq!(2, metrics.save.calls);
+        assert_eq!(1, metrics.set_file_times.calls);
+        assert_eq!(1, metrics.write_plugin_lists.calls);
+        assert_eq!(written_count, metrics.file_times_set);
+    }
+
+    #[test]
+    fn save_should_write_timestamps_again_if_one_has_changed_since_saving() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, &tmp_dir.path());
+        load_order.load().unwrap();
+        load_order.save().unwrap();
+
+        let path = load_order
+            .game_settings()
+            .plugins_directory()
+            .join(load_order.plugins()[1].name());
+        set_file_times(&path, FileTime::zero(), FileTime::zero()).unwrap();
+
+        load_order.game_settings_mut().set_metrics_enabled(true);
+        load_order.save().unwrap();
+
+        assert_eq!(1, load_order.game_settings().metrics().file_times_set);
+    }
+
+    #[test]
+    fn pending_changes_should_report_plugins_changed_since_saving() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Oblivion, &tmp_dir.path());
+        load_order.load().unwrap();
+        load_order.save().unwrap();
+        assert!(load_order.pending_changes().is_empty());
+
+        let last = load_order.plugins().len() - 1;
+        load_order
+            .set_plugin_index("Blank - Different.esp", last)
+            .unwrap();
+        load_order.activate("Blank - Different.esp").unwrap();
+
+        let changes = load_order.pending_changes();
+        assert_eq!(1, changes.len());
+        assert_eq!("Blank - Different.esp", changes[0].name);
+        assert!(changes[0].is_moved);
+        assert!(changes[0].is_activated);
+
+        load_order.save().unwrap();
+        assert!(load_order.pending_changes().is_empty());
+    }
+
     #[test]
     fn save_should_write_active_plugins_file_for_oblivion() {
         let tmp_dir = tempdir().unwrap();
@@ -761,6 +1166,51 @@ mod tests {
         assert!(load_order.is_active("Blank.esp"));
     }
 
+    #[test]
+    fn validate_load_order_should_return_all_violations() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Morrowind, &tmp_dir.path());
+        load_order.load().unwrap();
+
+        let existing_filenames = to_owned(load_order.plugin_names());
+        let filenames = vec!["Blank.esp", "Blank.esm", "blank.esp", "missing.esp"];
+
+        assert_eq!(
+            vec![
+                LoadOrderViolation::NonMasterBeforeMaster(1),
+                LoadOrderViolation::DuplicatePlugin(2),
+                LoadOrderViolation::UnknownPlugin(3),
+            ],
+            load_order.validate_load_order(&filenames)
+        );
+        assert_eq!(existing_filenames, load_order.plugin_names());
+    }
+
+    #[test]
+    fn validate_load_order_should_report_active_plugins_over_the_limit() {
+        let tmp_dir = tempdir().unwrap();
+        let mut load_order = prepare(GameId::Morrowind, &tmp_dir.path());
+
+        for i in 0..MAX_ACTIVE_NORMAL_PLUGINS {
+            let filename = format!("{}.esp", i);
+            copy_to_test_dir("Blank.esp", &filename, &load_order.game_settings());
+        }
+        load_order.load().unwrap();
+
+        let filenames = to_owned(load_order.plugin_names());
+        for index in 0..filenames.len() {
+            load_order.plugins_mut().activate(index).unwrap();
+        }
+
+        let filenames: Vec<&str> = filenames.iter().map(|s| s.as_str()).collect();
+        let expected: Vec<LoadOrderViolation> = (MAX_ACTIVE_NORMAL_PLUGINS..filenames.len())
+            .map(LoadOrderViolation::TooManyActivePlugins)
+            .collect();
+
+        assert!(!expected.is_empty());
+        assert_eq!(expected, load_order.validate_load_order(&filenames));
+    }
+
     #[test]
     fn set_plugin_index_should_error_if_inserting_a_non_master_before_a_master() {
         let tmp_dir = tempdir().unwrap();
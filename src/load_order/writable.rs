@@ -17,25 +17,41 @@
  * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
  */
 
-use unicase::eq;
+use std::collections::HashSet;
+
+use unicase::UniCase;
 
 use super::insertable::InsertableLoadOrder;
 use super::mutable::MutableLoadOrder;
+use super::pending::PluginChange;
 use super::readable::{ReadableLoadOrder, MAX_ACTIVE_LIGHT_MASTERS, MAX_ACTIVE_NORMAL_PLUGINS};
-use enums::Error;
-use plugin::Plugin;
+use enums::{Error, LoadOrderViolation};
+use game_settings::GameSettings;
+use plugin::{activate_plugins, Plugin};
 
 pub trait WritableLoadOrder: ReadableLoadOrder {
+    fn boxed_clone(&self) -> Box<WritableLoadOrder>;
+
+    fn game_settings_mut(&mut self) -> &mut GameSettings;
+
     fn load(&mut self) -> Result<(), Error>;
 
+    fn refresh(&mut self) -> Result<(), Error>;
+
     fn save(&mut self) -> Result<(), Error>;
 
     fn set_load_order(&mut self, plugin_names: &[&str]) -> Result<(), Error>;
 
+    fn validate_load_order(&self, plugin_names: &[&str]) -> Vec<LoadOrderViolation>;
+
     fn set_plugin_index(&mut self, plugin_name: &str, position: usize) -> Result<(), Error>;
 
     fn is_self_consistent(&self) -> Result<bool, Error>;
 
+    fn is_stale(&self) -> bool;
+
+    fn pending_changes<'a>(&'a self) -> Vec<PluginChange<'a>>;
+
     fn activate(&mut self, plugin_name: &str) -> Result<(), Error>;
 
     fn deactivate(&mut self, plugin_name: &str) -> Result<(), Error>;
@@ -43,6 +59,12 @@ pub trait WritableLoadOrder: ReadableLoadOrder {
     fn set_active_plugins(&mut self, active_plugin_names: &[&str]) -> Result<(), Error>;
 }
 
+impl Clone for Box<WritableLoadOrder> {
+    fn clone(&self) -> Self {
+        self.boxed_clone()
+    }
+}
+
 pub fn activate<T: InsertableLoadOrder>(
     load_order: &mut T,
     plugin_name: &str,
@@ -54,14 +76,17 @@ pub fn activate<T: InsertableLoadOrder>(
     let at_max_active_light_masters =
         load_order.count_active_light_masters() == MAX_ACTIVE_LIGHT_MASTERS;
 
-    let plugin = &mut load_order.plugins_mut()[index];
-    if !plugin.is_active()
-        && ((!plugin.is_light_master_file() && at_max_active_normal_plugins)
-            || (plugin.is_light_master_file() && at_max_active_light_masters))
-    {
+    let exceeds_limit = {
+        let plugin = &load_order.plugins()[index];
+        !plugin.is_active()
+            && ((!plugin.is_light_master_file() && at_max_active_normal_plugins)
+                || (plugin.is_light_master_file() && at_max_active_light_masters))
+    };
+
+    if exceeds_limit {
         Err(Error::TooManyActivePlugins)
     } else {
-        plugin.activate()
+        load_order.plugins_mut().activate(index)
     }
 }
 
@@ -71,18 +96,17 @@ pub fn deactivate<T: MutableLoadOrder>(load_order: &mut T, plugin_name: &str) ->
     }
 
     load_order
-        .plugins_mut()
-        .iter_mut()
-        .find(|p| p.name_matches(plugin_name))
+        .index_of(plugin_name)
         .ok_or_else(|| Error::PluginNotFound(plugin_name.to_string()))
-        .map(|p| p.deactivate())
+        .map(|i| load_order.plugins_mut().deactivate(i))
 }
 
 pub fn set_active_plugins<T: InsertableLoadOrder>(
     load_order: &mut T,
     active_plugin_names: &[&str],
 ) -> Result<(), Error> {
-    let (existing_plugin_indices, new_plugins) = load_order.lookup_plugins(active_plugin_names)?;
+    let (existing_plugin_indices, mut new_plugins) =
+        load_order.lookup_plugins(active_plugin_names)?;
 
     if load_order.count_normal_plugins(&existing_plugin_indices, &new_plugins)
         > MAX_ACTIVE_NORMAL_PLUGINS
@@ -92,28 +116,43 @@ pub fn set_active_plugins<T: InsertableLoadOrder>(
         return Err(Error::TooManyActivePlugins);
     }
 
-    for plugin_name in load_order.game_settings().implicitly_active_plugins() {
-        if !Plugin::is_valid(plugin_name, load_order.game_settings()) {
-            continue;
-        }
-
-        if !active_plugin_names.iter().any(|p| eq(*p, plugin_name)) {
-            return Err(Error::ImplicitlyActivePlugin(plugin_name.to_string()));
+    let implicitly_active_plugins = load_order.game_settings().implicitly_active_plugins();
+    if !implicitly_active_plugins.is_empty() {
+        let active_plugin_names: HashSet<UniCase<&str>> =
+            active_plugin_names.iter().map(|n| UniCase::new(*n)).collect();
+
+        // Only plugins that aren't being activated need to be checked for
+        // existence, which avoids reading the headers of all the others.
+        for plugin_name in implicitly_active_plugins {
+            if !active_plugin_names.contains(&UniCase::new(plugin_name.as_str()))
+                && Plugin::is_valid(plugin_name, load_order.game_settings())
+            {
+                return Err(Error::ImplicitlyActivePlugin(plugin_name.to_string()));
+            }
         }
     }
 
     load_order.deactivate_all();
 
-    for index in existing_plugin_indices {
-        load_order.plugins_mut()[index].activate()?;
-    }
+    let io_concurrency = load_order.game_settings().io_concurrency();
+    let existing_result = load_order
+        .plugins_mut()
+        .activate_all(&existing_plugin_indices, io_concurrency);
+
+    let new_result = activate_plugins(new_plugins.iter_mut().collect(), io_concurrency);
 
-    for mut plugin in new_plugins {
-        plugin.activate()?;
+    for plugin in new_plugins.into_iter().filter(|p| p.is_active()) {
         load_order.insert(plugin);
     }
 
-    Ok(())
+    match (existing_result, new_result) {
+        (Err(Error::ActivationFailed(mut x)), Err(Error::ActivationFailed(y))) => {
+            x.extend(y);
+            Err(Error::ActivationFailed(x))
+        }
+        (Err(x), _) | (Ok(_), Err(x)) => Err(x),
+        (Ok(_), Ok(_)) => Ok(()),
+    }
 }
 
 #[cfg(test)]
@@ -125,17 +164,17 @@ mod tests {
     use tempfile::tempdir;
 
     use enums::GameId;
-    use game_settings::GameSettings;
     use load_order::readable::{
-        active_plugin_names, index_of, is_active, plugin_at, plugin_names, ReadableLoadOrder,
-        ReadableLoadOrderExt,
+        active_plugin_names, index_of, is_active, plugin_at, plugin_names, plugin_states,
+        PluginState, ReadableLoadOrder, ReadableLoadOrderExt,
     };
+    use load_order::plugin_list::PluginList;
     use load_order::tests::mock_game_files;
     use tests::copy_to_test_dir;
 
     struct TestLoadOrder {
         game_settings: GameSettings,
-        plugins: Vec<Plugin>,
+        plugins: PluginList,
     }
 
     impl ReadableLoadOrder for TestLoadOrder {
@@ -162,16 +201,20 @@ mod tests {
         fn is_active(&self, plugin_name: &str) -> bool {
             is_active(&self.plugins, plugin_name)
         }
+
+        fn plugin_states<'a>(&'a self) -> Vec<PluginState<'a>> {
+            plugin_states(&self.plugins)
+        }
     }
 
     impl ReadableLoadOrderExt for TestLoadOrder {
-        fn plugins(&self) -> &Vec<Plugin> {
+        fn plugins(&self) -> &PluginList {
             &self.plugins
         }
     }
 
     impl MutableLoadOrder for TestLoadOrder {
-        fn plugins_mut(&mut self) -> &mut Vec<Plugin> {
+        fn plugins_mut(&mut self) -> &mut PluginList {
             &mut self.plugins
         }
     }
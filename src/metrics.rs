@@ -0,0 +1,289 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+use std::hash::{Hash, Hasher};
+use std::io;
+use std::io::Read;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+
+/// The number of calls made to a phase of loading or saving, and the total
+/// time spent in them.
+#[derive(Clone, Copy, Debug, Default, Eq, PartialEq)]
+pub struct PhaseMetrics {
+    pub calls: u64,
+    pub total_time: Duration,
+}
+
+/// Counters and timings recorded while loading and saving load order state.
+///
+/// Phases may be nested in other phases: `load` includes the time spent in
+/// `find_plugins`, `load_plugins`, `read_plugin_lists` and
+/// `load_active_plugins`, and `save` includes the time spent in
+/// `write_plugin_lists` and `set_file_times`.
+///
+/// File system calls are counted when scanning the plugins directory,
+/// reading plugin headers and writing the active plugins, load order and
+/// plugin cache files. Reads of the plugins directory's entries, the timestamp checks made
+/// when saving a timestamp-based load order and the renames made to unghost
+/// plugins are not counted.
+#[derive(Clone, Copy, Debug, Default, Eq, PartialEq)]
+pub struct Metrics {
+    /// Loading or refreshing the load order state.
+    pub load: PhaseMetrics,
+    /// Saving the load order state.
+    pub save: PhaseMetrics,
+    /// Scanning the plugins directory for plugin files.
+    pub find_plugins: PhaseMetrics,
+    /// Creating plugins from the scanned files, which includes reading their
+    /// headers.
+    pub load_plugins: PhaseMetrics,
+    /// Reading and decoding the active plugins and load order files.
+    pub read_plugin_lists: PhaseMetrics,
+    /// Reading which plugins are active and activating them, for games that
+    /// don't read it along with the load order.
+    pub load_active_plugins: PhaseMetrics,
+    /// Writing the active plugins and load order files.
+    pub write_plugin_lists: PhaseMetrics,
+    /// Writing plugin timestamps to save a timestamp-based load order.
+    pub set_file_times: PhaseMetrics,
+    /// The number of plugin files found by scanning the plugins directory.
+    pub plugin_files_scanned: u64,
+    /// The number of plugin files whose headers were read.
+    pub plugin_headers_parsed: u64,
+    /// The number of plugins whose header data was reused from a previous
+    /// load or the plugin cache instead of being read.
+    pub plugin_headers_reused: u64,
+    /// The number of plugin files whose timestamps were written.
+    pub file_times_set: u64,
+    /// The number of files and directories opened or created.
+    pub file_opens: u64,
+    /// The number of reads made from opened files.
+    pub file_reads: u64,
+    /// The number of times file metadata was read.
+    pub file_stats: u64,
+    /// The number of files renamed.
+    pub file_renames: u64,
+}
+
+#[derive(Clone, Copy, Debug)]
+pub enum Phase {
+    Load,
+    Save,
+    FindPlugins,
+    LoadPlugins,
+    ReadPluginLists,
+    LoadActivePlugins,
+    WritePluginLists,
+    SetFileTimes,
+}
+
+const PHASE_COUNT: usize = 8;
+
+#[derive(Clone, Copy, Debug)]
+pub enum Counter {
+    PluginFilesScanned,
+    PluginHeadersParsed,
+    PluginHeadersReused,
+    FileTimesSet,
+    FileOpens,
+    FileReads,
+    FileStats,
+    FileRenames,
+}
+
+const COUNTER_COUNT: usize = 8;
+
+#[derive(Debug, Default)]
+struct Counters {
+    phase_calls: [AtomicU64; PHASE_COUNT],
+    phase_nanoseconds: [AtomicU64; PHASE_COUNT],
+    counters: [AtomicU64; COUNTER_COUNT],
+}
+
+impl Counters {
+    fn phase(&self, phase: Phase) -> PhaseMetrics {
+        PhaseMetrics {
+            calls: self.phase_calls[phase as usize].load(Ordering::Relaxed),
+            total_time: Duration::from_nanos(
+                self.phase_nanoseconds[phase as usize].load(Ordering::Relaxed),
+            ),
+        }
+    }
+
+    fn counter(&self, counter: Counter) -> u64 {
+        self.counters[counter as usize].load(Ordering::Relaxed)
+    }
+}
+
+/// Records metrics if enabled, and does nothing otherwise.
+///
+/// Clones share the same counters, so metrics recorded through any copy of
+/// the `GameSettings` that owns the recorder are included.
+#[derive(Clone, Debug, Default)]
+pub struct MetricsRecorder(Option<Arc<Counters>>);
+
+impl MetricsRecorder {
+    pub fn enabled() -> MetricsRecorder {
+        MetricsRecorder(Some(Arc::new(Counters::default())))
+    }
+
+    pub fn is_enabled(&self) -> bool {
+        self.0.is_some()
+    }
+
+    /// Starts timing a phase, which ends when the returned timer is dropped.
+    pub fn start(&self, phase: Phase) -> PhaseTimer {
+        PhaseTimer(self.0.as_ref().map(|c| (Arc::clone(c), phase, Instant::now())))
+    }
+
+    pub fn add(&self, counter: Counter, value: u64) {
+        if let Some(ref counters) = self.0 {
+            counters.counters[counter as usize].fetch_add(value, Ordering::Relaxed);
+        }
+    }
+
+    pub fn metrics(&self) -> Metrics {
+        let counters = match self.0 {
+            Some(ref x) => x,
+            None => return Metrics::default(),
+        };
+
+        Metrics {
+            load: counters.phase(Phase::Load),
+            save: counters.phase(Phase::Save),
+            find_plugins: counters.phase(Phase::FindPlugins),
+            load_plugins: counters.phase(Phase::LoadPlugins),
+            read_plugin_lists: counters.phase(Phase::ReadPluginLists),
+            load_active_plugins: counters.phase(Phase::LoadActivePlugins),
+            write_plugin_lists: counters.phase(Phase::WritePluginLists),
+            set_file_times: counters.phase(Phase::SetFileTimes),
+            plugin_files_scanned: counters.counter(Counter::PluginFilesScanned),
+            plugin_headers_parsed: counters.counter(Counter::PluginHeadersParsed),
+            plugin_headers_reused: counters.counter(Counter::PluginHeadersReused),
+            file_times_set: counters.counter(Counter::FileTimesSet),
+            file_opens: counters.counter(Counter::FileOpens),
+            file_reads: counters.counter(Counter::FileReads),
+            file_stats: counters.counter(Counter::FileStats),
+            file_renames: counters.counter(Counter::FileRenames),
+        }
+    }
+}
+
+// Recorded metrics are not part of the settings' identity.
+impl PartialEq for MetricsRecorder {
+    fn eq(&self, _: &MetricsRecorder) -> bool {
+        true
+    }
+}
+
+impl Eq for MetricsRecorder {}
+
+impl Hash for MetricsRecorder {
+    fn hash<H: Hasher>(&self, _: &mut H) {}
+}
+
+/// Counts the reads made through the wrapped reader, which for an unbuffered
+/// file is the number of read system calls made.
+pub struct CountingReader<R> {
+    reader: R,
+    reads: u64,
+}
+
+impl<R: Read> CountingReader<R> {
+    pub fn new(reader: R) -> CountingReader<R> {
+        CountingReader { reader, reads: 0 }
+    }
+
+    pub fn reads(&self) -> u64 {
+        self.reads
+    }
+}
+
+impl<R: Read> Read for CountingReader<R> {
+    fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
+        self.reads += 1;
+        self.reader.read(buf)
+    }
+}
+
+pub struct PhaseTimer(Option<(Arc<Counters>, Phase, Instant)>);
+
+impl Drop for PhaseTimer {
+    fn drop(&mut self) {
+        if let Some((ref counters, phase, start)) = self.0 {
+            let nanoseconds = start.elapsed().as_nanos() as u64;
+            counters.phase_calls[phase as usize].fetch_add(1, Ordering::Relaxed);
+            counters.phase_nanoseconds[phase as usize].fetch_add(nanoseconds, Ordering::Relaxed);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn a_disabled_recorder_should_record_nothing() {
+        let recorder = MetricsRecorder::default();
+
+        drop(recorder.start(Phase::Load));
+        recorder.add(Counter::PluginHeadersParsed, 2);
+
+        assert!(!recorder.is_enabled());
+        assert_eq!(Metrics::default(), recorder.metrics());
+    }
+
+    #[test]
+    fn an_enabled_recorder_should_record_phases_and_counters() {
+        let recorder = MetricsRecorder::enabled();
+
+        {
+            let _timer = recorder.start(Phase::Save);
+            ::std::thread::sleep(Duration::from_millis(1));
+        }
+        recorder.add(Counter::FileTimesSet, 2);
+        recorder.add(Counter::FileTimesSet, 1);
+
+        let metrics = recorder.metrics();
+        assert_eq!(1, metrics.save.calls);
+        assert!(metrics.save.total_time >= Duration::from_millis(1));
+        assert_eq!(0, metrics.load.calls);
+        assert_eq!(3, metrics.file_times_set);
+    }
+
+    #[test]
+    fn clones_should_share_recorded_metrics() {
+        let recorder = MetricsRecorder::enabled();
+        recorder.clone().add(Counter::PluginFilesScanned, 5);
+
+        assert_eq!(5, recorder.metrics().plugin_files_scanned);
+    }
+
+    #[test]
+    fn counting_reader_should_count_each_read() {
+        let mut reader = CountingReader::new(&b"abcdef"[..]);
+        let mut buffer = [0; 4];
+
+        assert_eq!(4, reader.read(&mut buffer).unwrap());
+        assert_eq!(2, reader.read(&mut buffer).unwrap());
+        assert_eq!(0, reader.read(&mut buffer).unwrap());
+        assert_eq!(3, reader.reads());
+    }
+}
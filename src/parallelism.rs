@@ -0,0 +1,191 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+use std::fmt;
+use std::hash::{Hash, Hasher};
+use std::sync::Arc;
+
+use rayon::{ThreadPool, ThreadPoolBuilder};
+
+use enums::Error;
+
+/// Collections with fewer items than this are processed sequentially by
+/// default.
+const DEFAULT_SEQUENTIAL_THRESHOLD: usize = 64;
+
+/// How parallel work is done when loading and saving: which rayon thread pool
+/// it runs in, and how small a collection must be for it to be processed
+/// sequentially instead.
+///
+/// By default, rayon's global thread pool is used. Clones share the same
+/// thread pool.
+#[derive(Clone)]
+pub struct Parallelism {
+    pool: Option<Arc<ThreadPool>>,
+    sequential_threshold: usize,
+}
+
+impl Parallelism {
+    /// The number of threads in the thread pool, or zero if rayon's global
+    /// thread pool is used.
+    pub fn thread_count(&self) -> usize {
+        self.pool
+            .as_ref()
+            .map(|p| p.current_num_threads())
+            .unwrap_or(0)
+    }
+
+    /// Creates a thread pool with the given number of threads, or uses
+    /// rayon's global thread pool if the number is zero.
+    pub fn set_thread_count(&mut self, count: usize) -> Result<(), Error> {
+        self.pool = if count == 0 {
+            None
+        } else {
+            let pool = ThreadPoolBuilder::new()
+                .num_threads(count)
+                .thread_name(|i| format!("libloadorder-{}", i))
+                .build()
+                .map_err(|e| Error::ThreadPoolError(e.to_string()))?;
+            Some(Arc::new(pool))
+        };
+
+        Ok(())
+    }
+
+    /// Sets a thread pool to use, which may be shared with other code.
+    pub fn set_thread_pool(&mut self, pool: Arc<ThreadPool>) {
+        self.pool = Some(pool);
+    }
+
+    pub fn sequential_threshold(&self) -> usize {
+        self.sequential_threshold
+    }
+
+    /// Sets the number of items below which collections are processed
+    /// sequentially. A value of zero is treated as one.
+    pub fn set_sequential_threshold(&mut self, threshold: usize) {
+        self.sequential_threshold = threshold.max(1);
+    }
+
+    pub fn is_sequential(&self, len: usize) -> bool {
+        len < self.sequential_threshold
+    }
+
+    /// Runs parallel work in the thread pool, if one is set.
+    ///
+    /// Work is run in the pool even if it is small enough to be processed
+    /// sequentially, as rayon's parallel iterators otherwise initialise
+    /// rayon's global thread pool. Parallel iterators used by the work should
+    /// be limited using `with_min_len(self.sequential_threshold())`, so that
+    /// they are not split into pieces smaller than the threshold, which also
+    /// stops small collections from being split at all.
+    pub fn install<OP, R>(&self, op: OP) -> R
+    where
+        OP: FnOnce() -> R + Send,
+        R: Send,
+    {
+        match self.pool {
+            Some(ref pool) => pool.install(op),
+            None => op(),
+        }
+    }
+}
+
+impl Default for Parallelism {
+    fn default() -> Parallelism {
+        Parallelism {
+            pool: None,
+            sequential_threshold: DEFAULT_SEQUENTIAL_THRESHOLD,
+        }
+    }
+}
+
+impl fmt::Debug for Parallelism {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("Parallelism")
+            .field("thread_count", &self.thread_count())
+            .field("sequential_threshold", &self.sequential_threshold)
+            .finish()
+    }
+}
+
+// How work is parallelised is not part of the settings' identity.
+impl PartialEq for Parallelism {
+    fn eq(&self, _: &Parallelism) -> bool {
+        true
+    }
+}
+
+impl Eq for Parallelism {}
+
+impl Hash for Parallelism {
+    fn hash<H: Hasher>(&self, _: &mut H) {}
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn default_should_use_the_global_thread_pool() {
+        let parallelism = Parallelism::default();
+
+        assert_eq!(0, parallelism.thread_count());
+        assert_eq!(DEFAULT_SEQUENTIAL_THRESHOLD, parallelism.sequential_threshold());
+    }
+
+    #[test]
+    fn set_thread_count_should_create_a_pool_unless_the_count_is_zero() {
+        let mut parallelism = Parallelism::default();
+
+        parallelism.set_thread_count(2).unwrap();
+        assert_eq!(2, parallelism.thread_count());
+        assert_eq!(2, parallelism.clone().thread_count());
+
+        parallelism.set_thread_count(0).unwrap();
+        assert_eq!(0, parallelism.thread_count());
+    }
+
+    #[test]
+    fn set_sequential_threshold_should_treat_zero_as_one() {
+        let mut parallelism = Parallelism::default();
+
+        parallelism.set_sequential_threshold(0);
+        assert_eq!(1, parallelism.sequential_threshold());
+        assert!(parallelism.is_sequential(0));
+        assert!(!parallelism.is_sequential(1));
+    }
+
+    #[test]
+    fn install_should_return_the_result_of_the_work() {
+        let mut parallelism = Parallelism::default();
+        parallelism.set_thread_count(2).unwrap();
+
+        assert_eq!(3, parallelism.install(|| 1 + 2));
+    }
+
+    #[test]
+    fn install_should_run_work_in_the_thread_pool_if_one_is_set() {
+        let mut parallelism = Parallelism::default();
+        assert!(parallelism.install(|| ::rayon::current_thread_index()).is_none());
+
+        parallelism.set_thread_count(1).unwrap();
+        parallelism.set_sequential_threshold(100);
+        assert_eq!(Some(0), parallelism.install(|| ::rayon::current_thread_index()));
+    }
+}
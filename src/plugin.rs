@@ -16,7 +16,13 @@
  * You should have received a copy of the GNU General Public License
  * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
  */
-use std::fs::File;
+use std::cell::RefCell;
+use std::fs::{DirEntry, File, Metadata};
+use std::io::{self, Read};
+use std::path::{Path, PathBuf};
+use std::cmp::min;
+use std::sync::{Arc, Mutex};
+use std::thread::scope;
 use std::time::SystemTime;
 
 use esplugin;
@@ -26,6 +32,8 @@ use unicase::eq;
 use enums::{Error, GameId};
 use game_settings::GameSettings;
 use ghostable_path::GhostablePath;
+use metrics::{Counter, CountingReader, MetricsRecorder};
+use plugin_cache::PluginFlags;
 
 const VALID_EXTENSIONS: &[&str] = &[".esp", ".esm", ".esp.ghost", ".esm.ghost"];
 
@@ -38,13 +46,61 @@ const VALID_EXTENSIONS_WITH_ESL: &[&str] = &[
     ".esl.ghost",
 ];
 
+/// The number of bytes read from the start of a plugin file when reading its
+/// header record, which is enough to hold all of most plugins' headers, so
+/// that they can be read in one go.
+const HEADER_READ_SIZE: usize = 4096;
+
+/// Header buffers that have grown larger than this are freed after use
+/// instead of being kept for the next plugin.
+const MAX_RETAINED_HEADER_BUFFER_SIZE: usize = 64 * 1024;
+
+thread_local!(static HEADER_BUFFER: RefCell<Vec<u8>> = RefCell::new(Vec::new()));
+
+/// A plugin file found by scanning the plugins directory, with the metadata
+/// read by the scan, so that it doesn't need to be read again.
+#[derive(Clone, Debug)]
+pub struct PluginFile {
+    pub filename: String,
+    pub path: PathBuf,
+    pub metadata: Metadata,
+}
+
+impl PluginFile {
+    /// Returns `None` if the directory entry is not a file with a valid
+    /// plugin file extension for the given game.
+    pub fn new(entry: &DirEntry, game_id: GameId, metrics: &MetricsRecorder) -> Option<PluginFile> {
+        let filename = entry.file_name().into_string().ok()?;
+        if !has_valid_extension(&filename, game_id) {
+            return None;
+        }
+
+        metrics.add(Counter::FileStats, 1);
+        let metadata = entry.metadata().ok()?;
+        if !metadata.is_file() {
+            return None;
+        }
+
+        Some(PluginFile {
+            filename,
+            path: entry.path(),
+            metadata,
+        })
+    }
+}
+
+/// The name and path are shared, as they don't change when a plugin's state
+/// does, and plugins are cloned when load orders are copied or replaced.
 #[derive(Clone, Debug)]
 pub struct Plugin {
-    game: GameId,
     active: bool,
     modification_time: SystemTime,
-    data: esplugin::Plugin,
-    name: String,
+    path: Arc<Path>,
+    // Flags are read when the plugin is created, rather than when first
+    // needed, because reading them is what rejects invalid plugin files, and
+    // loading needs them for every plugin to position masters correctly.
+    flags: PluginFlags,
+    name: Arc<str>,
 }
 
 impl Plugin {
@@ -56,6 +112,18 @@ impl Plugin {
         filename: &str,
         game_settings: &GameSettings,
         active: bool,
+    ) -> Result<Plugin, Error> {
+        Plugin::with_previous(filename, game_settings, active, None)
+    }
+
+    /// Creates a plugin in the same way as `with_active()`, but reuses the
+    /// header data of `previous` if its file has not changed since it was
+    /// read.
+    pub fn with_previous(
+        filename: &str,
+        game_settings: &GameSettings,
+        active: bool,
+        previous: Option<&Plugin>,
     ) -> Result<Plugin, Error> {
         if !has_valid_extension(filename, game_settings.id()) {
             return Err(Error::InvalidPlugin(filename.to_owned()));
@@ -69,18 +137,57 @@ impl Plugin {
             filepath.resolve_path()?
         };
 
-        let file = File::open(&filepath)?;
-        let modification_time = file.metadata()?.modified()?;
+        Plugin::with_path(filename, filepath, None, game_settings, active, previous)
+    }
+
+    /// Creates a plugin in the same way as `with_previous()`, but for a file
+    /// found by scanning the plugins directory, so the filesystem doesn't need
+    /// to be checked for the file's path and metadata again.
+    pub fn from_file(
+        filename: &str,
+        file: &PluginFile,
+        game_settings: &GameSettings,
+        active: bool,
+        previous: Option<&Plugin>,
+    ) -> Result<Plugin, Error> {
+        if !has_valid_extension(filename, game_settings.id()) {
+            return Err(Error::InvalidPlugin(filename.to_owned()));
+        }
+
+        // Unghosting renames the file, which doesn't change its metadata.
+        let filepath = if active {
+            file.path.unghost()?
+        } else {
+            file.path.clone()
+        };
+
+        Plugin::with_path(
+            filename,
+            filepath,
+            Some(&file.metadata),
+            game_settings,
+            active,
+            previous,
+        )
+    }
 
-        let mut data = esplugin::Plugin::new(game_settings.id().to_esplugin_id(), &filepath);
-        data.parse_open_file(file, true)?;
+    fn with_path(
+        filename: &str,
+        filepath: PathBuf,
+        metadata: Option<&Metadata>,
+        game_settings: &GameSettings,
+        active: bool,
+        previous: Option<&Plugin>,
+    ) -> Result<Plugin, Error> {
+        let (path, modification_time, flags) =
+            read_plugin_data(filepath, metadata, game_settings, previous)?;
 
         Ok(Plugin {
-            game: game_settings.id(),
             active,
             modification_time,
-            data,
-            name: trim_dot_ghost(filename).to_string(),
+            path,
+            flags,
+            name: Arc::from(trim_dot_ghost(filename)),
         })
     }
 
@@ -88,6 +195,11 @@ impl Plugin {
         &self.name
     }
 
+    /// Gets the plugin's name without copying it.
+    pub fn shared_name(&self) -> Arc<str> {
+        Arc::clone(&self.name)
+    }
+
     pub fn name_matches(&self, string: &str) -> bool {
         eq(self.name(), trim_dot_ghost(string))
     }
@@ -101,36 +213,59 @@ impl Plugin {
     }
 
     pub fn is_master_file(&self) -> bool {
-        self.data.is_master_file()
+        self.flags.is_master
     }
 
     pub fn is_light_master_file(&self) -> bool {
-        self.data.is_light_master_file()
+        self.flags.is_light_master
     }
 
-    pub fn set_modification_time(&mut self, time: SystemTime) -> Result<(), Error> {
-        // Always write the file time. This has a huge performance impact, but
-        // is important for correctness, as otherwise external changes to plugin
-        // timestamps between calls to WritableLoadOrder::load() and
-        // WritableLoadOrder::save() could lead to libloadorder not setting all
-        // the timestamps it needs to and producing an incorrect load order.
-        set_file_times(
-            &self.data.path(),
-            FileTime::from_system_time(SystemTime::now()),
-            FileTime::from_system_time(time),
-        )?;
+    pub fn is_ghosted(&self) -> bool {
+        self.path.is_ghosted()
+    }
+
+    /// Check whether the plugin file's modification time differs from the
+    /// one that is held for it, e.g. because it was changed externally.
+    pub fn has_modification_time_changed(&self) -> bool {
+        self.path
+            .metadata()
+            .and_then(|m| m.modified())
+            .map(|t| t != self.modification_time)
+            .unwrap_or(true)
+    }
+
+    /// Sets the plugin's modification time, returning whether its file's
+    /// timestamp had to be written.
+    pub fn set_modification_time(&mut self, time: SystemTime) -> Result<bool, Error> {
+        // Check the file's current timestamp instead of relying on the stored
+        // one, as otherwise external changes to plugin timestamps between calls
+        // to WritableLoadOrder::load() and WritableLoadOrder::save() could lead
+        // to libloadorder not setting all the timestamps it needs to and
+        // producing an incorrect load order. Writing the timestamp is much more
+        // expensive than reading it, so only do so if it differs.
+        let file_time = FileTime::from_system_time(time);
+        let metadata = self.path.metadata()?;
+        let is_changed = FileTime::from_last_modification_time(&metadata) != file_time;
+        if is_changed {
+            set_file_times(
+                &self.path,
+                FileTime::from_system_time(SystemTime::now()),
+                file_time,
+            )?;
+        }
 
         self.modification_time = time;
-        Ok(())
+        Ok(is_changed)
     }
 
     pub fn activate(&mut self) -> Result<(), Error> {
         if !self.is_active() {
-            if self.data.path().is_ghosted() {
-                let new_path = self.data.path().unghost()?;
+            if self.path.is_ghosted() {
+                // Renaming the file doesn't change its content, so the flags
+                // that were read from the ghosted file are still correct.
+                let new_path = self.path.unghost()?;
 
-                self.data = esplugin::Plugin::new(*self.data.game_id(), &new_path);
-                self.data.parse_file(true)?;
+                self.path = Arc::from(new_path);
                 let modification_time = self.modification_time();
                 self.set_modification_time(modification_time)?;
             }
@@ -155,8 +290,213 @@ impl Plugin {
             .resolve_path()
         {
             Err(_) => false,
-            Ok(ref x) => esplugin::Plugin::is_valid(game_settings.id().to_esplugin_id(), x, true),
+            Ok(ref x) => {
+                let metrics = game_settings.metrics_recorder();
+                metrics.add(Counter::FileOpens, 1);
+                File::open(x)
+                    .map_err(Error::from)
+                    .and_then(|f| parse_header(game_settings.id(), x, f, metrics))
+                    .is_ok()
+            }
+        }
+    }
+}
+
+/// Activates the given plugins, unghosting ghosted plugins using up to
+/// `max_threads` threads at a time, as unghosting is limited by filesystem
+/// latency rather than CPU time. Plugins that fail to activate are left
+/// inactive, and the errors encountered are returned together, in the order
+/// the plugins were given.
+pub fn activate_plugins(plugins: Vec<&mut Plugin>, max_threads: usize) -> Result<(), Error> {
+    let (ghosted, unghosted): (Vec<_>, Vec<_>) = plugins
+        .into_iter()
+        .filter(|p| !p.is_active())
+        .enumerate()
+        .partition(|&(_, ref p)| p.is_ghosted());
+
+    for (_, plugin) in unghosted {
+        plugin.activate()?;
+    }
+
+    let threads = min(max_threads, ghosted.len());
+    let queue = Mutex::new(ghosted.into_iter());
+    let failures = Mutex::new(Vec::new());
+
+    let activate_queued = || loop {
+        let (index, plugin) = match queue.lock().ok().and_then(|mut q| q.next()) {
+            Some(x) => x,
+            None => break,
+        };
+
+        if let Err(e) = plugin.activate() {
+            if let Ok(mut failures) = failures.lock() {
+                failures.push((index, plugin.name().to_string(), e));
+            }
+        }
+    };
+
+    if threads > 1 {
+        scope(|s| {
+            for _ in 0..threads {
+                s.spawn(&activate_queued);
+            }
+        });
+    } else {
+        activate_queued();
+    }
+
+    let mut failures = failures.into_inner().unwrap_or_default();
+    if failures.is_empty() {
+        Ok(())
+    } else {
+        failures.sort_by_key(|f| f.0);
+        Err(Error::ActivationFailed(
+            failures.into_iter().map(|(_, n, e)| (n, e)).collect(),
+        ))
+    }
+}
+
+/// Reads the modification time and flags of the plugin at the given path,
+/// reusing the plugin path buffer of `previous` or of a cache entry where
+/// possible.
+fn read_plugin_data(
+    path: PathBuf,
+    metadata: Option<&Metadata>,
+    game_settings: &GameSettings,
+    previous: Option<&Plugin>,
+) -> Result<(Arc<Path>, SystemTime, PluginFlags), Error> {
+    let cache = game_settings.plugin_cache();
+    let metrics = game_settings.metrics_recorder();
+    if cache.is_enabled() || previous.is_some() {
+        let path_metadata;
+        let metadata = match metadata {
+            Some(x) => x,
+            None => {
+                metrics.add(Counter::FileStats, 1);
+                path_metadata = path.metadata()?;
+                &path_metadata
+            }
+        };
+        let modification_time = metadata.modified()?;
+
+        if let Some(plugin) = previous {
+            if *plugin.path == *path && plugin.modification_time == modification_time {
+                metrics.add(Counter::PluginHeadersReused, 1);
+                // Saving the cache drops entries that weren't used, so keep
+                // the entry for a plugin that didn't need to be looked up.
+                cache.touch(&path, metadata);
+                return Ok((Arc::clone(&plugin.path), modification_time, plugin.flags));
+            }
+        }
+
+        if let Some((flags, cached_path)) = cache.get(&path, metadata) {
+            metrics.add(Counter::PluginHeadersReused, 1);
+            let path = if *cached_path == *path {
+                cached_path
+            } else {
+                Arc::from(path)
+            };
+            return Ok((path, modification_time, flags));
+        }
+    }
+
+    // Key any new cache entry on the metadata of the file that is actually
+    // parsed, in case it was replaced after the path was first stat'ed.
+    metrics.add(Counter::FileOpens, 1);
+    let file = File::open(&path)?;
+    metrics.add(Counter::FileStats, 1);
+    let metadata = file.metadata()?;
+
+    let data = parse_header(game_settings.id(), &path, file, metrics)?;
+    metrics.add(Counter::PluginHeadersParsed, 1);
+
+    let flags = to_flags(&data);
+    let path = Arc::from(path);
+    cache.insert(&path, &metadata, flags);
+
+    Ok((path, metadata.modified()?, flags))
+}
+
+/// Parses the header record of the given plugin file, which is read into a
+/// buffer that is reused by the thread for each plugin it parses.
+fn parse_header(
+    game: GameId,
+    path: &Path,
+    file: File,
+    metrics: &MetricsRecorder,
+) -> Result<esplugin::Plugin, Error> {
+    let mut data = esplugin::Plugin::new(game.to_esplugin_id(), path);
+
+    HEADER_BUFFER.with(|buffer| {
+        let mut buffer = buffer.borrow_mut();
+
+        let mut reader = CountingReader::new(file);
+        let read_result = read_header_record(&mut reader, record_header_length(game), &mut buffer);
+        metrics.add(Counter::FileReads, reader.reads());
+
+        let result = read_result
+            .map_err(Error::from)
+            .and_then(|_| data.parse(&buffer, true).map_err(Error::from));
+
+        if buffer.capacity() > MAX_RETAINED_HEADER_BUFFER_SIZE {
+            *buffer = Vec::new();
         }
+
+        result
+    })?;
+
+    Ok(data)
+}
+
+/// The length of the fixed-size part of a record that precedes its data.
+fn record_header_length(game: GameId) -> usize {
+    match game {
+        GameId::Morrowind => 16,
+        GameId::Oblivion => 20,
+        _ => 24,
+    }
+}
+
+/// Reads the first record of a plugin file into the given buffer, which is
+/// cleared first. The start of the file is read in one go, and the rest of
+/// the record is only read if it didn't fit. If the file ends before the
+/// record does, the buffer holds what was read, so parsing it fails.
+fn read_header_record<R: Read>(
+    reader: &mut R,
+    record_header_length: usize,
+    buffer: &mut Vec<u8>,
+) -> io::Result<()> {
+    buffer.clear();
+    reader
+        .by_ref()
+        .take(HEADER_READ_SIZE as u64)
+        .read_to_end(buffer)?;
+
+    if buffer.len() < record_header_length {
+        return Ok(());
+    }
+
+    // All the supported games store the size of a record's data after its
+    // four-byte type.
+    let mut data_size_bytes = [0; 4];
+    data_size_bytes.copy_from_slice(&buffer[4..8]);
+    let data_size = u32::from_le_bytes(data_size_bytes);
+    let record_length = record_header_length as u64 + u64::from(data_size);
+
+    if record_length > buffer.len() as u64 {
+        let remaining = record_length - buffer.len() as u64;
+        reader.take(remaining).read_to_end(buffer)?;
+    } else {
+        buffer.truncate(record_length as usize);
+    }
+
+    Ok(())
+}
+
+fn to_flags(data: &esplugin::Plugin) -> PluginFlags {
+    PluginFlags {
+        is_master: data.is_master_file(),
+        is_light_master: data.is_light_master_file(),
     }
 }
 
@@ -195,11 +535,58 @@ pub fn trim_dot_ghost(string: &str) -> &str {
 mod tests {
     use super::*;
 
+    use std::fs::{create_dir_all, remove_file};
     use std::path::PathBuf;
     use std::time::{Duration, UNIX_EPOCH};
     use tempfile::tempdir;
     use tests::copy_to_test_dir;
 
+    fn record(header_length: usize, data_size: u32, total_length: usize) -> Vec<u8> {
+        let mut bytes = b"TES4".to_vec();
+        bytes.extend_from_slice(&[
+            data_size as u8,
+            (data_size >> 8) as u8,
+            (data_size >> 16) as u8,
+            (data_size >> 24) as u8,
+        ]);
+        bytes.resize(header_length, 0);
+        bytes.resize(total_length, 1);
+        bytes
+    }
+
+    #[test]
+    fn read_header_record_should_read_only_the_first_record() {
+        let mut buffer = Vec::new();
+        let bytes = record(24, 10, 100);
+
+        read_header_record(&mut &bytes[..], 24, &mut buffer).unwrap();
+
+        assert_eq!(&bytes[..34], &buffer[..]);
+    }
+
+    #[test]
+    fn read_header_record_should_read_a_record_larger_than_the_initial_read_size() {
+        let mut buffer = vec![1, 2, 3];
+        let data_size = HEADER_READ_SIZE as u32 * 2;
+        let bytes = record(20, data_size, HEADER_READ_SIZE * 4);
+
+        read_header_record(&mut &bytes[..], 20, &mut buffer).unwrap();
+
+        assert_eq!(&bytes[..20 + data_size as usize], &buffer[..]);
+    }
+
+    #[test]
+    fn read_header_record_should_read_what_it_can_if_the_file_ends_before_the_record() {
+        let mut buffer = Vec::new();
+        let bytes = record(16, 100, 50);
+
+        read_header_record(&mut &bytes[..], 16, &mut buffer).unwrap();
+        assert_eq!(bytes, buffer);
+
+        read_header_record(&mut &bytes[..10], 16, &mut buffer).unwrap();
+        assert_eq!(&bytes[..10], &buffer[..]);
+    }
+
     #[test]
     fn name_should_return_the_plugin_filename_without_any_ghost_extension() {
         let tmp_dir = tempdir().unwrap();
@@ -338,6 +725,200 @@ mod tests {
         assert!(plugin.is_light_master_file());
     }
 
+    #[test]
+    fn new_should_use_cached_flags_if_the_plugin_file_is_unchanged() {
+        let tmp_dir = tempdir().unwrap();
+        let game_dir = tmp_dir.path();
+
+        let mut settings =
+            GameSettings::with_local_path(GameId::Oblivion, &game_dir, &PathBuf::default())
+                .unwrap();
+        settings
+            .set_plugin_cache_path(Some(&game_dir.join("cache")))
+            .unwrap();
+
+        copy_to_test_dir("Blank.esp", "Blank.esp", &settings);
+        let plugin_path = Arc::from(settings.plugins_directory().join("Blank.esp"));
+        let flags = PluginFlags {
+            is_master: true,
+            is_light_master: false,
+        };
+        settings
+            .plugin_cache()
+            .insert(&plugin_path, &plugin_path.metadata().unwrap(), flags);
+
+        let plugin = Plugin::new("Blank.esp", &settings).unwrap();
+
+        assert!(plugin.is_master_file());
+    }
+
+    #[test]
+    fn new_should_add_parsed_flags_to_the_plugin_cache() {
+        let tmp_dir = tempdir().unwrap();
+        let game_dir = tmp_dir.path();
+
+        let mut settings =
+            GameSettings::with_local_path(GameId::Oblivion, &game_dir, &PathBuf::default())
+                .unwrap();
+        settings
+            .set_plugin_cache_path(Some(&game_dir.join("cache")))
+            .unwrap();
+
+        copy_to_test_dir("Blank.esm", "Blank.esm", &settings);
+        let plugin_path = settings.plugins_directory().join("Blank.esm");
+        Plugin::new("Blank.esm", &settings).unwrap();
+
+        let (flags, _) = settings
+            .plugin_cache()
+            .get(&plugin_path, &plugin_path.metadata().unwrap())
+            .unwrap();
+
+        assert!(flags.is_master);
+        assert!(!flags.is_light_master);
+    }
+
+    #[test]
+    fn new_should_share_plugin_data_between_settings_that_share_a_plugin_cache() {
+        let tmp_dir = tempdir().unwrap();
+        let game_dir = tmp_dir.path();
+
+        let mut settings =
+            GameSettings::with_local_path(GameId::Fallout3, &game_dir, &PathBuf::default())
+                .unwrap();
+        settings.set_plugin_cache_shared(true);
+        let mut other_settings =
+            GameSettings::with_local_path(GameId::Fallout3, &game_dir, &PathBuf::default())
+                .unwrap();
+        other_settings.set_plugin_cache_shared(true);
+
+        copy_to_test_dir("Blank.esm", "Blank.esm", &settings);
+        let plugin = Plugin::new("Blank.esm", &settings).unwrap();
+        let other_plugin = Plugin::new("Blank.esm", &other_settings).unwrap();
+
+        assert!(other_plugin.is_master_file());
+        assert!(Arc::ptr_eq(&plugin.path, &other_plugin.path));
+    }
+
+    #[test]
+    fn with_previous_should_reuse_the_previous_plugin_data_if_the_file_is_unchanged() {
+        let tmp_dir = tempdir().unwrap();
+        let game_dir = tmp_dir.path();
+
+        let settings =
+            GameSettings::with_local_path(GameId::Oblivion, &game_dir, &PathBuf::default())
+                .unwrap();
+
+        copy_to_test_dir("Blank.esm", "Blank.esm", &settings);
+        let previous = Plugin::new("Blank.esm", &settings).unwrap();
+        let plugin_path = settings.plugins_directory().join("Blank.esm");
+
+        // Overwrite the plugin with an invalid file that has the same timestamp.
+        copy_to_test_dir("Blank.bsa", "Blank.esm", &settings);
+        set_file_times(
+            &plugin_path,
+            FileTime::zero(),
+            FileTime::from_system_time(previous.modification_time()),
+        ).unwrap();
+
+        let plugin = Plugin::with_previous("Blank.esm", &settings, true, Some(&previous)).unwrap();
+
+        assert!(plugin.is_active());
+        assert!(plugin.is_master_file());
+    }
+
+    #[test]
+    fn with_previous_should_reread_the_plugin_if_its_file_has_been_modified() {
+        let tmp_dir = tempdir().unwrap();
+        let game_dir = tmp_dir.path();
+
+        let settings =
+            GameSettings::with_local_path(GameId::Oblivion, &game_dir, &PathBuf::default())
+                .unwrap();
+
+        copy_to_test_dir("Blank.esm", "Blank.esm", &settings);
+        let previous = Plugin::new("Blank.esm", &settings).unwrap();
+        let plugin_path = settings.plugins_directory().join("Blank.esm");
+
+        copy_to_test_dir("Blank.esp", "Blank.esm", &settings);
+        set_file_times(&plugin_path, FileTime::zero(), FileTime::zero()).unwrap();
+
+        let plugin = Plugin::with_previous("Blank.esm", &settings, false, Some(&previous)).unwrap();
+
+        assert!(!plugin.is_master_file());
+    }
+
+    fn scan_plugins_directory(settings: &GameSettings) -> Vec<PluginFile> {
+        let metrics = settings.metrics_recorder();
+        settings
+            .plugins_directory()
+            .read_dir()
+            .unwrap()
+            .filter_map(|e| PluginFile::new(&e.unwrap(), settings.id(), metrics))
+            .collect()
+    }
+
+    #[test]
+    fn plugin_file_new_should_skip_entries_that_are_not_plugin_files() {
+        let tmp_dir = tempdir().unwrap();
+        let game_dir = tmp_dir.path();
+
+        let settings =
+            GameSettings::with_local_path(GameId::Oblivion, &game_dir, &PathBuf::default())
+                .unwrap();
+
+        copy_to_test_dir("Blank.esp", "Blank.esp", &settings);
+        copy_to_test_dir("Blank.esp", "Blank.pse", &settings);
+        create_dir_all(settings.plugins_directory().join("Directory.esp")).unwrap();
+
+        let files = scan_plugins_directory(&settings);
+
+        assert_eq!(1, files.len());
+        assert_eq!("Blank.esp", files[0].filename);
+        assert_eq!(settings.plugins_directory().join("Blank.esp"), files[0].path);
+    }
+
+    #[test]
+    fn from_file_should_use_the_scanned_path_of_a_ghosted_plugin() {
+        let tmp_dir = tempdir().unwrap();
+        let game_dir = tmp_dir.path();
+
+        let settings =
+            GameSettings::with_local_path(GameId::Oblivion, &game_dir, &PathBuf::default())
+                .unwrap();
+
+        copy_to_test_dir("Blank.esm", "Blank.esm.ghost", &settings);
+        let files = scan_plugins_directory(&settings);
+
+        let plugin = Plugin::from_file("Blank.esm", &files[0], &settings, false, None).unwrap();
+
+        assert_eq!("Blank.esm", plugin.name());
+        assert!(!plugin.is_active());
+        assert!(plugin.is_master_file());
+        assert_eq!(
+            files[0].metadata.modified().unwrap(),
+            plugin.modification_time()
+        );
+    }
+
+    #[test]
+    fn from_file_should_unghost_the_plugin_if_it_is_active() {
+        let tmp_dir = tempdir().unwrap();
+        let game_dir = tmp_dir.path();
+
+        let settings =
+            GameSettings::with_local_path(GameId::Oblivion, &game_dir, &PathBuf::default())
+                .unwrap();
+
+        copy_to_test_dir("Blank.esp", "Blank.esp.ghost", &settings);
+        let files = scan_plugins_directory(&settings);
+
+        let plugin = Plugin::from_file("Blank.esp", &files[0], &settings, true, None).unwrap();
+
+        assert!(plugin.is_active());
+        assert!(settings.plugins_directory().join("Blank.esp").exists());
+        assert!(!settings.plugins_directory().join("Blank.esp.ghost").exists());
+    }
+
     #[test]
     fn set_modification_time_should_update_the_file_modification_time() {
         let tmp_dir = tempdir().unwrap();
@@ -364,6 +945,57 @@ mod tests {
         assert_eq!(UNIX_EPOCH, new_mtime);
     }
 
+    #[test]
+    fn set_modification_time_should_not_write_the_file_time_if_it_is_unchanged() {
+        let tmp_dir = tempdir().unwrap();
+        let game_dir = tmp_dir.path();
+
+        let settings =
+            GameSettings::with_local_path(GameId::Oblivion, &game_dir, &PathBuf::default())
+                .unwrap();
+
+        copy_to_test_dir("Blank.esp", "Blank.esp", &settings);
+        let plugin_path = game_dir.join("Data").join("Blank.esp");
+        let mut plugin = Plugin::new("Blank.esp", &settings).unwrap();
+        let mtime = UNIX_EPOCH + Duration::from_secs(60);
+        set_file_times(
+            &plugin_path,
+            FileTime::zero(),
+            FileTime::from_system_time(mtime),
+        ).unwrap();
+
+        plugin.set_modification_time(mtime).unwrap();
+
+        // The access time is only updated if the file time is written.
+        let metadata = plugin_path.metadata().unwrap();
+        assert_eq!(
+            FileTime::zero(),
+            FileTime::from_last_access_time(&metadata)
+        );
+        assert_eq!(mtime, metadata.modified().unwrap());
+    }
+
+    #[test]
+    fn set_modification_time_should_write_the_file_time_if_it_was_changed_externally() {
+        let tmp_dir = tempdir().unwrap();
+        let game_dir = tmp_dir.path();
+
+        let settings =
+            GameSettings::with_local_path(GameId::Oblivion, &game_dir, &PathBuf::default())
+                .unwrap();
+
+        copy_to_test_dir("Blank.esp", "Blank.esp", &settings);
+        let plugin_path = game_dir.join("Data").join("Blank.esp");
+        let mut plugin = Plugin::new("Blank.esp", &settings).unwrap();
+        let mtime = plugin.modification_time();
+
+        set_file_times(&plugin_path, FileTime::zero(), FileTime::zero()).unwrap();
+        plugin.set_modification_time(mtime).unwrap();
+
+        let new_mtime = plugin_path.metadata().unwrap().modified().unwrap();
+        assert_eq!(mtime, new_mtime);
+    }
+
     #[test]
     fn set_modification_time_should_be_able_to_handle_pre_unix_timestamps() {
         let tmp_dir = tempdir().unwrap();
@@ -410,6 +1042,91 @@ mod tests {
         assert!(game_dir.join("Data").join("Blank.esp").exists());
     }
 
+    #[test]
+    fn activate_plugins_should_unghost_ghosted_plugins_using_multiple_threads() {
+        let tmp_dir = tempdir().unwrap();
+        let game_dir = tmp_dir.path();
+
+        let settings =
+            GameSettings::with_local_path(GameId::Oblivion, &game_dir, &PathBuf::default())
+                .unwrap();
+
+        let filenames: Vec<String> = (0..20).map(|i| format!("Blank{}.esp", i)).collect();
+        let mut plugins: Vec<Plugin> = filenames
+            .iter()
+            .map(|f| {
+                copy_to_test_dir("Blank.esp", &(f.clone() + ".ghost"), &settings);
+                Plugin::new(f, &settings).unwrap()
+            })
+            .collect();
+
+        activate_plugins(plugins.iter_mut().collect(), 4).unwrap();
+
+        for (plugin, filename) in plugins.iter().zip(&filenames) {
+            assert!(plugin.is_active());
+            assert!(!plugin.is_ghosted());
+            assert!(settings.plugins_directory().join(filename).exists());
+        }
+    }
+
+    #[test]
+    fn activate_should_not_read_the_header_of_a_ghosted_plugin_again() {
+        let tmp_dir = tempdir().unwrap();
+        let game_dir = tmp_dir.path();
+
+        let settings =
+            GameSettings::with_local_path(GameId::Oblivion, &game_dir, &PathBuf::default())
+                .unwrap();
+
+        copy_to_test_dir("Blank.esm", "Blank.esm.ghost", &settings);
+        let mut plugin = Plugin::new("Blank.esm", &settings).unwrap();
+
+        // Reading the unghosted file would fail, as it's no longer a plugin.
+        copy_to_test_dir("Blank.bsa", "Blank.esm.ghost", &settings);
+        plugin.activate().unwrap();
+
+        assert!(plugin.is_active());
+        assert!(!plugin.is_ghosted());
+        assert!(plugin.is_master_file());
+    }
+
+    #[test]
+    fn activate_plugins_should_activate_all_valid_plugins_and_return_all_errors_in_order() {
+        let tmp_dir = tempdir().unwrap();
+        let game_dir = tmp_dir.path();
+
+        let settings =
+            GameSettings::with_local_path(GameId::Oblivion, &game_dir, &PathBuf::default())
+                .unwrap();
+
+        let filenames = ["Blank0.esp", "Blank1.esp", "Blank2.esp", "Blank3.esp"];
+        let mut plugins: Vec<Plugin> = filenames
+            .iter()
+            .map(|f| {
+                copy_to_test_dir("Blank.esp", &(f.to_string() + ".ghost"), &settings);
+                Plugin::new(f, &settings).unwrap()
+            })
+            .collect();
+
+        // Remove some plugins so that unghosting them fails.
+        for filename in &["Blank3.esp.ghost", "Blank1.esp.ghost"] {
+            remove_file(settings.plugins_directory().join(filename)).unwrap();
+        }
+
+        match activate_plugins(plugins.iter_mut().collect(), 2) {
+            Err(Error::ActivationFailed(x)) => {
+                let names: Vec<&str> = x.iter().map(|f| f.0.as_str()).collect();
+                assert_eq!(vec!["Blank1.esp", "Blank3.esp"], names);
+            }
+            x => panic!("Unexpected result: {:?}", x),
+        }
+
+        assert!(plugins[0].is_active());
+        assert!(!plugins[1].is_active());
+        assert!(plugins[2].is_active());
+        assert!(!plugins[3].is_active());
+    }
+
     #[test]
     fn deactivate_should_not_ghost_a_plugin() {
         let tmp_dir = tempdir().unwrap();
@@ -0,0 +1,647 @@
+/*
+ * This file is part of libloadorder
+ *
+ * Copyright (C) 2017 Oliver Hamlet
+ *
+ * libloadorder is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libloadorder is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
+ */
+use std::cmp::min;
+use std::collections::HashMap;
+use std::fs::{canonicalize, File, Metadata};
+use std::hash::{Hash, Hasher};
+use std::io::{ErrorKind, Read};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{Arc, Mutex, RwLock, Weak};
+
+use filetime::FileTime;
+
+use atomic_file::write_file;
+use enums::{Error, GameId, WriteDurability};
+use ghostable_path::GhostablePath;
+use metrics::MetricsRecorder;
+
+const CACHE_MAGIC: &[u8] = b"LOPC";
+const CACHE_VERSION: u8 = 1;
+
+const MASTER_FLAG: u8 = 0b01;
+const LIGHT_MASTER_FLAG: u8 = 0b10;
+
+/// The length of the smallest possible cache record, which has an empty path.
+const MIN_RECORD_LEN: usize = 2 + 8 + 8 + 4 + 1;
+
+#[derive(Clone, Copy, Debug, Default, Eq, PartialEq)]
+pub struct PluginFlags {
+    pub is_master: bool,
+    pub is_light_master: bool,
+}
+
+impl PluginFlags {
+    fn to_byte(&self) -> u8 {
+        let mut byte = 0;
+        if self.is_master {
+            byte |= MASTER_FLAG;
+        }
+        if self.is_light_master {
+            byte |= LIGHT_MASTER_FLAG;
+        }
+        byte
+    }
+
+    fn from_byte(byte: u8) -> PluginFlags {
+        PluginFlags {
+            is_master: byte & MASTER_FLAG != 0,
+            is_light_master: byte & LIGHT_MASTER_FLAG != 0,
+        }
+    }
+}
+
+type Entries = HashMap<PathBuf, CacheEntry>;
+
+/// The entries of the shared caches that are currently in use, for each game.
+/// They are only referenced weakly, so that they are freed once the last
+/// cache using them is dropped.
+static SHARED_ENTRIES: Mutex<Vec<(GameId, Weak<RwLock<Entries>>)>> = Mutex::new(Vec::new());
+
+#[derive(Debug)]
+struct CacheEntry {
+    size: u64,
+    modification_time: FileTime,
+    flags: PluginFlags,
+    path: Arc<Path>,
+    used: AtomicBool,
+}
+
+impl CacheEntry {
+    fn matches(&self, metadata: &Metadata) -> bool {
+        self.size == metadata.len()
+            && self.modification_time == FileTime::from_last_modification_time(metadata)
+    }
+}
+
+/// A persistent cache of the plugin header data that libloadorder uses, keyed
+/// by plugin path, file size and modification time.
+///
+/// Clones share the same entries, so a cache can be read and updated through
+/// any copy of the `GameSettings` that owns it.
+///
+/// A cache can also be shared by all the caches for the same game in the
+/// process. Shared caches are not persisted, and key their entries on
+/// canonical paths, so that different game paths that refer to the same
+/// plugins directory share the same entries. Each entry holds the plugin's
+/// path, which is reused by plugins created from the entry so that its buffer
+/// is also shared.
+#[derive(Clone, Debug)]
+pub struct PluginCache {
+    game_id: GameId,
+    path: Option<PathBuf>,
+    // The plugins directory and its canonical path, if the cache is shared.
+    shared_root: Option<(PathBuf, PathBuf)>,
+    entries: Arc<RwLock<Entries>>,
+    is_dirty: Arc<AtomicBool>,
+}
+
+impl PluginCache {
+    pub fn new(game_id: GameId) -> PluginCache {
+        PluginCache {
+            game_id,
+            path: None,
+            shared_root: None,
+            entries: Arc::new(RwLock::new(HashMap::new())),
+            is_dirty: Arc::new(AtomicBool::new(false)),
+        }
+    }
+
+    /// Creates a cache that shares its entries with every other shared cache
+    /// for the same game that currently exists.
+    pub fn shared(game_id: GameId, plugins_directory: &Path) -> PluginCache {
+        let canonical_directory =
+            canonicalize(plugins_directory).unwrap_or_else(|_| plugins_directory.to_path_buf());
+
+        PluginCache {
+            game_id,
+            path: None,
+            shared_root: Some((plugins_directory.to_path_buf(), canonical_directory)),
+            entries: shared_entries(game_id),
+            is_dirty: Arc::new(AtomicBool::new(false)),
+        }
+    }
+
+    pub fn load(game_id: GameId, path: &Path) -> Result<PluginCache, Error> {
+        let mut content = Vec::new();
+        match File::open(path) {
+            Ok(mut file) => {
+                file.read_to_end(&mut content)?;
+            }
+            Err(ref e) if e.kind() == ErrorKind::NotFound => {}
+            Err(e) => return Err(Error::IoError(e)),
+        }
+
+        // An unreadable cache is treated as an empty one, it will be rebuilt
+        // and overwritten on the next save.
+        let entries = parse_entries(&content, game_id).unwrap_or_default();
+
+        Ok(PluginCache {
+            game_id,
+            path: Some(path.to_path_buf()),
+            shared_root: None,
+            entries: Arc::new(RwLock::new(entries)),
+            is_dirty: Arc::new(AtomicBool::new(false)),
+        })
+    }
+
+    pub fn path(&self) -> Option<&Path> {
+        self.path.as_ref().map(PathBuf::as_path)
+    }
+
+    pub fn is_enabled(&self) -> bool {
+        self.path.is_some() || self.is_shared()
+    }
+
+    pub fn is_shared(&self) -> bool {
+        self.shared_root.is_some()
+    }
+
+    /// Gets the cached flags for the plugin at the given path, and the path
+    /// that the entry was inserted with.
+    pub fn get(&self, plugin_path: &Path, metadata: &Metadata) -> Option<(PluginFlags, Arc<Path>)> {
+        if !self.is_enabled() {
+            return None;
+        }
+
+        let entries = self.entries.read().ok()?;
+        entries
+            .get(&self.key(plugin_path))
+            .filter(|e| e.matches(metadata))
+            .map(|e| {
+                e.used.store(true, Ordering::Relaxed);
+                (e.flags, Arc::clone(&e.path))
+            })
+    }
+
+    /// Marks the entry for the plugin at the given path as used if it is
+    /// still valid, so that it is kept the next time the cache is saved.
+    pub fn touch(&self, plugin_path: &Path, metadata: &Metadata) {
+        self.get(plugin_path, metadata);
+    }
+
+    pub fn insert(&self, plugin_path: &Arc<Path>, metadata: &Metadata, flags: PluginFlags) {
+        if !self.is_enabled() {
+            return;
+        }
+
+        if let Ok(mut entries) = self.entries.write() {
+            entries.insert(
+                self.key(plugin_path),
+                CacheEntry {
+                    size: metadata.len(),
+                    modification_time: FileTime::from_last_modification_time(metadata),
+                    flags,
+                    path: Arc::clone(plugin_path),
+                    used: AtomicBool::new(true),
+                },
+            );
+            self.is_dirty.store(true, Ordering::Relaxed);
+        }
+    }
+
+    /// Writes the cache file, dropping any entries that have not been used
+    /// since the cache was loaded or last saved.
+    pub fn save(&self, metrics: &MetricsRecorder) -> Result<(), Error> {
+        let path = match self.path {
+            Some(ref x) => x,
+            None => return Ok(()),
+        };
+
+        let entries = match self.entries.write() {
+            Ok(mut entries) => {
+                let previous_len = entries.len();
+                entries.retain(|_, e| e.used.swap(false, Ordering::Relaxed));
+
+                if !self.is_dirty.swap(false, Ordering::Relaxed) && entries.len() == previous_len
+                {
+                    return Ok(());
+                }
+                serialise_entries(&entries, self.game_id)
+            }
+            Err(_) => return Ok(()),
+        };
+
+        write_file(path, &entries, WriteDurability::Buffered, metrics)
+    }
+
+    /// Saves the cache, ignoring any errors. The cache is only an
+    /// optimisation, so failing to persist it shouldn't cause the operation
+    /// that populated it to fail.
+    pub fn flush(&self, metrics: &MetricsRecorder) {
+        let _ = self.save(metrics);
+    }
+
+    fn key(&self, plugin_path: &Path) -> PathBuf {
+        let key = cache_key(plugin_path);
+
+        if let Some((ref directory, ref canonical_directory)) = self.shared_root {
+            if let Ok(relative_path) = key.strip_prefix(directory) {
+                return canonical_directory.join(relative_path);
+            }
+        }
+
+        key
+    }
+}
+
+impl PartialEq for PluginCache {
+    fn eq(&self, other: &PluginCache) -> bool {
+        self.game_id == other.game_id && self.path == other.path
+            && self.shared_root == other.shared_root
+    }
+}
+
+impl Eq for PluginCache {}
+
+impl Hash for PluginCache {
+    fn hash<H: Hasher>(&self, state: &mut H) {
+        self.game_id.hash(state);
+        self.path.hash(state);
+        self.shared_root.hash(state);
+    }
+}
+
+fn shared_entries(game_id: GameId) -> Arc<RwLock<Entries>> {
+    let mut shared_entries = match SHARED_ENTRIES.lock() {
+        Ok(x) => x,
+        Err(e) => e.into_inner(),
+    };
+
+    shared_entries.retain(|&(_, ref entries)| entries.strong_count() > 0);
+
+    let existing = shared_entries
+        .iter()
+        .filter(|&&(id, _)| id == game_id)
+        .filter_map(|&(_, ref entries)| entries.upgrade())
+        .next();
+
+    existing.unwrap_or_else(|| {
+        let entries = Arc::new(RwLock::new(HashMap::new()));
+        shared_entries.push((game_id, Arc::downgrade(&entries)));
+        entries
+    })
+}
+
+fn cache_key(plugin_path: &Path) -> PathBuf {
+    // Ghosting a plugin doesn't change its content, so share entries between
+    // both states.
+    plugin_path
+        .as_unghosted_path()
+        .unwrap_or_else(|_| plugin_path.to_path_buf())
+}
+
+fn serialise_entries(entries: &Entries, game_id: GameId) -> Vec<u8> {
+    let mut buffer = Vec::with_capacity(CACHE_MAGIC.len() + 6 + entries.len() * 64);
+    buffer.extend_from_slice(CACHE_MAGIC);
+    buffer.push(CACHE_VERSION);
+    buffer.push(game_id as u8);
+    // Paths that can't be stored are skipped, so the record count is only
+    // known once every entry has been serialised.
+    let count_offset = buffer.len();
+    buffer.extend_from_slice(&0u32.to_le_bytes());
+
+    let mut count: u32 = 0;
+    for (path, entry) in entries {
+        let path = match path.to_str() {
+            Some(x) if x.len() <= u16::max_value() as usize => x.as_bytes(),
+            _ => continue,
+        };
+        count += 1;
+        buffer.extend_from_slice(&(path.len() as u16).to_le_bytes());
+        buffer.extend_from_slice(path);
+        buffer.extend_from_slice(&entry.size.to_le_bytes());
+        buffer.extend_from_slice(&entry.modification_time.unix_seconds().to_le_bytes());
+        buffer.extend_from_slice(&entry.modification_time.nanoseconds().to_le_bytes());
+        buffer.push(entry.flags.to_byte());
+    }
+
+    buffer[count_offset..count_offset + 4].copy_from_slice(&count.to_le_bytes());
+
+    buffer
+}
+
+fn parse_entries(content: &[u8], game_id: GameId) -> Option<Entries> {
+    let mut reader = ByteReader(content);
+
+    if reader.take(CACHE_MAGIC.len())? != CACHE_MAGIC
+        || reader.u8()? != CACHE_VERSION
+        || reader.u8()? != game_id as u8
+    {
+        return None;
+    }
+
+    let count = reader.u32()? as usize;
+    // Don't trust the count to size the map, a corrupt cache could claim
+    // more records than its content could possibly hold.
+    let mut entries = HashMap::with_capacity(min(count, reader.0.len() / MIN_RECORD_LEN));
+    for _ in 0..count {
+        let path_len = reader.u16()? as usize;
+        let path = ::std::str::from_utf8(reader.take(path_len)?).ok()?;
+        let size = reader.u64()?;
+        let seconds = reader.u64()? as i64;
+        let nanoseconds = reader.u32()?;
+        let flags = PluginFlags::from_byte(reader.u8()?);
+
+        let path = PathBuf::from(path);
+        entries.insert(
+            path.clone(),
+            CacheEntry {
+                size,
+                modification_time: FileTime::from_unix_time(seconds, nanoseconds),
+                flags,
+                path: Arc::from(path),
+                used: AtomicBool::new(false),
+            },
+        );
+    }
+
+    Some(entries)
+}
+
+struct ByteReader<'a>(&'a [u8]);
+
+impl<'a> ByteReader<'a> {
+    fn take(&mut self, count: usize) -> Option<&'a [u8]> {
+        if self.0.len() < count {
+            None
+        } else {
+            let (bytes, remainder) = self.0.split_at(count);
+            self.0 = remainder;
+            Some(bytes)
+        }
+    }
+
+    fn u8(&mut self) -> Option<u8> {
+        self.take(1).map(|b| b[0])
+    }
+
+    fn u16(&mut self) -> Option<u16> {
+        let mut bytes = [0; 2];
+        bytes.copy_from_slice(self.take(2)?);
+        Some(u16::from_le_bytes(bytes))
+    }
+
+    fn u32(&mut self) -> Option<u32> {
+        let mut bytes = [0; 4];
+        bytes.copy_from_slice(self.take(4)?);
+        Some(u32::from_le_bytes(bytes))
+    }
+
+    fn u64(&mut self) -> Option<u64> {
+        let mut bytes = [0; 8];
+        bytes.copy_from_slice(self.take(8)?);
+        Some(u64::from_le_bytes(bytes))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    use std::fs::{create_dir_all, metadata};
+    use std::io::Write;
+    use std::time::{Duration, UNIX_EPOCH};
+
+    use filetime::set_file_times;
+    use tempfile::tempdir;
+
+    use game_settings::GameSettings;
+    use tests::copy_to_test_dir;
+
+    const MASTER: PluginFlags = PluginFlags {
+        is_master: true,
+        is_light_master: false,
+    };
+
+    fn prepare(game_dir: &Path) -> (GameSettings, Arc<Path>) {
+        let settings =
+            GameSettings::with_local_path(GameId::Oblivion, game_dir, &game_dir.join("local"))
+                .unwrap();
+        copy_to_test_dir("Blank.esm", "Blank.esm", &settings);
+        let plugin_path = Arc::from(settings.plugins_directory().join("Blank.esm"));
+
+        (settings, plugin_path)
+    }
+
+    fn flags(entry: Option<(PluginFlags, Arc<Path>)>) -> Option<PluginFlags> {
+        entry.map(|(flags, _)| flags)
+    }
+
+    #[test]
+    fn get_should_return_none_if_the_cache_is_disabled() {
+        let tmp_dir = tempdir().unwrap();
+        let (_, plugin_path) = prepare(&tmp_dir.path());
+
+        let cache = PluginCache::new(GameId::Oblivion);
+        let metadata = metadata(&plugin_path).unwrap();
+        cache.insert(&plugin_path, &metadata, MASTER);
+
+        assert!(!cache.is_enabled());
+        assert!(cache.get(&plugin_path, &metadata).is_none());
+    }
+
+    #[test]
+    fn get_should_return_inserted_flags_if_the_file_is_unchanged() {
+        let tmp_dir = tempdir().unwrap();
+        let (_, plugin_path) = prepare(&tmp_dir.path());
+
+        let cache = PluginCache::load(GameId::Oblivion, &tmp_dir.path().join("cache")).unwrap();
+        let metadata = metadata(&plugin_path).unwrap();
+        cache.insert(&plugin_path, &metadata, MASTER);
+
+        assert_eq!(Some(MASTER), flags(cache.get(&plugin_path, &metadata)));
+    }
+
+    #[test]
+    fn get_should_share_entries_between_ghosted_and_unghosted_paths() {
+        let tmp_dir = tempdir().unwrap();
+        let (_, plugin_path) = prepare(&tmp_dir.path());
+
+        let cache = PluginCache::load(GameId::Oblivion, &tmp_dir.path().join("cache")).unwrap();
+        let metadata = metadata(&plugin_path).unwrap();
+        cache.insert(&plugin_path, &metadata, MASTER);
+
+        let ghosted_path = plugin_path.as_ghosted_path().unwrap();
+        assert_eq!(Some(MASTER), flags(cache.get(&ghosted_path, &metadata)));
+    }
+
+    #[test]
+    fn get_should_return_none_if_the_file_has_been_modified() {
+        let tmp_dir = tempdir().unwrap();
+        let (_, plugin_path) = prepare(&tmp_dir.path());
+
+        let cache = PluginCache::load(GameId::Oblivion, &tmp_dir.path().join("cache")).unwrap();
+        cache.insert(&plugin_path, &metadata(&plugin_path).unwrap(), MASTER);
+
+        set_file_times(&plugin_path, FileTime::zero(), FileTime::zero()).unwrap();
+
+        assert!(cache.get(&plugin_path, &metadata(&plugin_path).unwrap()).is_none());
+    }
+
+    #[test]
+    fn shared_caches_should_share_entries_for_the_same_game() {
+        let tmp_dir = tempdir().unwrap();
+        let (settings, plugin_path) = prepare(&tmp_dir.path());
+
+        let cache = PluginCache::shared(GameId::Oblivion, &settings.plugins_directory());
+        let metadata = metadata(&plugin_path).unwrap();
+        cache.insert(&plugin_path, &metadata, MASTER);
+
+        let other_cache = PluginCache::shared(GameId::Oblivion, &settings.plugins_directory());
+        let (flags, path) = other_cache.get(&plugin_path, &metadata).unwrap();
+        assert_eq!(MASTER, flags);
+        assert!(Arc::ptr_eq(&plugin_path, &path));
+
+        let other_game_cache = PluginCache::shared(GameId::FalloutNV, &settings.plugins_directory());
+        assert!(other_game_cache.get(&plugin_path, &metadata).is_none());
+    }
+
+    #[test]
+    fn shared_caches_should_key_entries_on_canonical_paths() {
+        let tmp_dir = tempdir().unwrap();
+        let (settings, plugin_path) = prepare(&tmp_dir.path());
+
+        let cache = PluginCache::shared(GameId::Oblivion, &settings.plugins_directory());
+        let metadata = metadata(&plugin_path).unwrap();
+        cache.insert(&plugin_path, &metadata, MASTER);
+
+        create_dir_all(tmp_dir.path().join("local")).unwrap();
+        let other_directory = tmp_dir.path().join("local").join("..").join("Data");
+        let other_path = other_directory.join("Blank.esm");
+        let other_cache = PluginCache::shared(GameId::Oblivion, &other_directory);
+
+        assert_eq!(Some(MASTER), flags(other_cache.get(&other_path, &metadata)));
+    }
+
+    #[test]
+    fn shared_cache_entries_should_be_freed_when_no_caches_use_them() {
+        let tmp_dir = tempdir().unwrap();
+        let (settings, plugin_path) = prepare(&tmp_dir.path());
+
+        let cache = PluginCache::shared(GameId::Morrowind, &settings.plugins_directory());
+        let metadata = metadata(&plugin_path).unwrap();
+        cache.insert(&plugin_path, &metadata, MASTER);
+        drop(cache);
+
+        let cache = PluginCache::shared(GameId::Morrowind, &settings.plugins_directory());
+        assert!(cache.get(&plugin_path, &metadata).is_none());
+    }
+
+    #[test]
+    fn save_and_load_should_round_trip_entries() {
+        let tmp_dir = tempdir().unwrap();
+        let (_, plugin_path) = prepare(&tmp_dir.path());
+        let cache_path = tmp_dir.path().join("local").join("cache");
+
+        let mtime = UNIX_EPOCH - Duration::from_millis(1500);
+        set_file_times(
+            &plugin_path,
+            FileTime::zero(),
+            FileTime::from_system_time(mtime),
+        ).unwrap();
+
+        let cache = PluginCache::load(GameId::Oblivion, &cache_path).unwrap();
+        let metadata = metadata(&plugin_path).unwrap();
+        cache.insert(&plugin_path, &metadata, MASTER);
+        cache.save(&MetricsRecorder::default()).unwrap();
+
+        let cache = PluginCache::load(GameId::Oblivion, &cache_path).unwrap();
+        assert_eq!(Some(MASTER), flags(cache.get(&plugin_path, &metadata)));
+    }
+
+    #[test]
+    fn save_should_drop_entries_that_have_not_been_used_since_the_last_load() {
+        let tmp_dir = tempdir().unwrap();
+        let (_, plugin_path) = prepare(&tmp_dir.path());
+        let cache_path = tmp_dir.path().join("cache");
+
+        let cache = PluginCache::load(GameId::Oblivion, &cache_path).unwrap();
+        let metadata = metadata(&plugin_path).unwrap();
+        cache.insert(&plugin_path, &metadata, MASTER);
+        cache.save(&MetricsRecorder::default()).unwrap();
+
+        PluginCache::load(GameId::Oblivion, &cache_path)
+            .unwrap()
+            .save(&MetricsRecorder::default())
+            .unwrap();
+
+        let cache = PluginCache::load(GameId::Oblivion, &cache_path).unwrap();
+        assert!(cache.get(&plugin_path, &metadata).is_none());
+    }
+
+    #[test]
+    fn load_should_discard_a_cache_written_for_a_different_game() {
+        let tmp_dir = tempdir().unwrap();
+        let (_, plugin_path) = prepare(&tmp_dir.path());
+        let cache_path = tmp_dir.path().join("cache");
+
+        let cache = PluginCache::load(GameId::Oblivion, &cache_path).unwrap();
+        let metadata = metadata(&plugin_path).unwrap();
+        cache.insert(&plugin_path, &metadata, MASTER);
+        cache.save(&MetricsRecorder::default()).unwrap();
+
+        let cache = PluginCache::load(GameId::FalloutNV, &cache_path).unwrap();
+        assert!(cache.get(&plugin_path, &metadata).is_none());
+    }
+
+    #[test]
+    fn load_should_treat_an_invalid_cache_file_as_empty() {
+        let tmp_dir = tempdir().unwrap();
+        let cache_path = tmp_dir.path().join("cache");
+        File::create(&cache_path)
+            .unwrap()
+            .write_all(b"LOPC\x01\x02\xff\xff")
+            .unwrap();
+
+        let cache = PluginCache::load(GameId::Oblivion, &cache_path).unwrap();
+        assert!(cache.entries.read().unwrap().is_empty());
+    }
+
+    #[test]
+    fn load_should_treat_a_cache_with_too_large_a_record_count_as_empty() {
+        let tmp_dir = tempdir().unwrap();
+        let cache_path = tmp_dir.path().join("cache");
+        File::create(&cache_path)
+            .unwrap()
+            .write_all(b"LOPC\x01\x02\xff\xff\xff\xff\x00\x00")
+            .unwrap();
+
+        let cache = PluginCache::load(GameId::Oblivion, &cache_path).unwrap();
+        assert!(cache.entries.read().unwrap().is_empty());
+    }
+
+    #[test]
+    fn save_should_skip_entries_with_paths_that_cannot_be_stored() {
+        let tmp_dir = tempdir().unwrap();
+        let (_, plugin_path) = prepare(&tmp_dir.path());
+        let cache_path = tmp_dir.path().join("cache");
+
+        let cache = PluginCache::load(GameId::Oblivion, &cache_path).unwrap();
+        let metadata = metadata(&plugin_path).unwrap();
+        cache.insert(&plugin_path, &metadata, MASTER);
+        let long_path: Arc<Path> = Arc::from(PathBuf::from("a".repeat(70000)));
+        cache.insert(&long_path, &metadata, MASTER);
+        cache.save(&MetricsRecorder::default()).unwrap();
+
+        let cache = PluginCache::load(GameId::Oblivion, &cache_path).unwrap();
+        assert_eq!(Some(MASTER), flags(cache.get(&plugin_path, &metadata)));
+        assert_eq!(1, cache.entries.read().unwrap().len());
+    }
+}
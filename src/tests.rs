@@ -17,12 +17,45 @@
  * along with libloadorder. If not, see <http://www.gnu.org/licenses/>.
  */
 
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::cell::Cell;
 use std::fs::{copy, create_dir};
 use std::path::{Path, PathBuf};
 
 use enums::GameId;
 use game_settings::GameSettings;
 
+/// Counts the heap allocations made by each thread, so that tests can check
+/// that an operation doesn't allocate. Allocations made by other concurrently
+/// running tests aren't counted.
+struct CountingAllocator;
+
+thread_local! {
+    static ALLOCATIONS: Cell<usize> = const { Cell::new(0) };
+}
+
+unsafe impl GlobalAlloc for CountingAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        let _ = ALLOCATIONS.try_with(|a| a.set(a.get() + 1));
+        System.alloc(layout)
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        System.dealloc(ptr, layout)
+    }
+}
+
+#[global_allocator]
+static ALLOCATOR: CountingAllocator = CountingAllocator;
+
+/// Gets the number of heap allocations made by the current thread while
+/// running the given function.
+pub fn count_allocations<F: FnOnce()>(f: F) -> usize {
+    let before = ALLOCATIONS.with(Cell::get);
+    f();
+    ALLOCATIONS.with(Cell::get) - before
+}
+
 pub fn copy_to_test_dir(from_path: &str, to_file: &str, game_settings: &GameSettings) {
     let testing_plugins_dir = testing_plugins_dir(game_settings.id());
     let data_dir = game_settings.plugins_directory();